@@ -0,0 +1,21 @@
+#ifndef ISP_PIPELINE_ALLOC_COUNTER_HPP
+#define ISP_PIPELINE_ALLOC_COUNTER_HPP
+
+#include <cstdint>
+
+namespace isp {
+
+// Number of operator new calls made by the process so far (every C++
+// container allocation). Compare it before and after a frame to check that
+// steady-state processing allocates nothing. Memory taken directly with
+// malloc, e.g. inside stb_image_write or zlib, is not counted.
+//
+// Defined in src/alloc_counter.cpp together with counting replacements of
+// the global operator new/delete. That file is not part of isp_core; only
+// programs that report the count (isp_main) link it, so library users keep
+// their own allocator.
+std::uint64_t heap_allocation_count();
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ISP_PIPELINE_BATCH_HPP
+#define ISP_PIPELINE_BATCH_HPP
+
+#include "io.hpp"
+#include "pipeline.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace isp {
+
+struct BatchConfig {
+    // Frames to process; .png files go through load_png_as_raw, anything
+    // else is read as RAW with `raw` geometry
+    std::vector<std::string> inputs;
+    RawFileConfig raw{640, 480};
+
+    // Each input is written as <output_dir>/<input stem>.<png|ppm>; inputs
+    // that share a stem get their index appended (<stem>_<index>). For
+    // the 8-bit formats the worker's last stage also writes the 8-bit
+    // image, so the writer only encodes.
+    std::string output_dir = "data";
+    OutputFormat output_format = OutputFormat::Png;
+
+    // Frames processed at once. 0 picks from the frame size: small frames
+    // run one per core, each single-threaded; large frames run one at a
+    // time with every core on it. Other values split the cores evenly.
+    int jobs = 0;
+
+    // Cores to split between the jobs; 0: ExecContext::default_threads()
+    int threads = 0;
+
+    PipelineConfig pipeline;
+};
+
+struct BatchStats {
+    std::size_t frames = 0;   // written successfully
+    std::size_t failed = 0;
+    double seconds = 0.0;     // wall time, first read to last write
+    double megapixels = 0.0;  // input pixels of the written frames
+    int jobs = 0;
+    int threads_per_job = 0;
+};
+
+// Input list for `path`: the regular files of a directory in name order,
+// or the lines of a list file (blank lines and '#' comments skipped)
+std::vector<std::string> list_batch_inputs(const std::string& path);
+
+// Runs every input through its own copy of the pipeline. One reader thread
+// loads frames into pooled buffers, `jobs` workers process them, and as
+// many writers save the results, so reading, processing and writing of
+// different frames overlap. Bounded queues between the steps cap the
+// frames in flight. Failed frames are reported on stderr and counted.
+// Throws std::invalid_argument, before any frame is read, if
+// make_default_pipeline rejects `config.pipeline`.
+BatchStats run_batch(const BatchConfig& config);
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef ISP_PIPELINE_BOUNDED_QUEUE_HPP
+#define ISP_PIPELINE_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace isp {
+
+// Fixed-capacity FIFO between producer and consumer threads. push() blocks
+// while the queue is full, which is what keeps a fast stage from running
+// ahead of a slow one; pop() blocks while it is empty. After close(),
+// pushes are refused and pop() drains what is left, then returns nullopt.
+// The ring is allocated once, so steady-state traffic allocates nothing.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : slots_(capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Queue capacity must be positive");
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false if the queue was closed
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || count_ < slots_.size(); });
+        if (closed_) return false;
+        slots_[(head_ + count_) % slots_.size()] = std::move(value);
+        ++count_;
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || count_ > 0; });
+        if (count_ == 0) return std::nullopt;
+        std::optional<T> value(std::move(slots_[head_]));
+        head_ = (head_ + 1) % slots_.size();
+        --count_;
+        lock.unlock();
+        not_full_.notify_one();
+        return value;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    std::size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<T> slots_;
+    std::size_t head_{0};
+    std::size_t count_{0};
+    bool closed_{false};
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+} // namespace isp
+
+#endif
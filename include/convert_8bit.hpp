@@ -0,0 +1,52 @@
+#ifndef ISP_PIPELINE_CONVERT_8BIT_HPP
+#define ISP_PIPELINE_CONVERT_8BIT_HPP
+
+#include "rgb_image.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace isp {
+
+// Maps samples of one bit depth to 8 bits as v * 255 / max_value, the
+// rounding the writers have always used. Set up once per depth: a
+// multiply-high constant when one reproduces the division for every code
+// (checked exhaustively), otherwise a byte table. Codes above max_value
+// convert as max_value.
+class To8Bit {
+public:
+    // Throws std::invalid_argument unless 1 <= bit_depth <= 16
+    explicit To8Bit(int bit_depth = 12);
+
+    int bit_depth() const { return bit_depth_; }
+
+    // SSE4.1/AVX2 when available (see simd.hpp)
+    void convert(const uint16_t* src, std::size_t count, uint8_t* dst) const;
+
+    // Interleaved pixels to 3 * count bytes
+    void convert(const Pixel* src, std::size_t count, uint8_t* dst) const;
+
+private:
+    int bit_depth_;
+    uint16_t max_value_;
+    // y = mulhi(v << pre_shift_, multiplier_) >> post_shift_, if multiplier_ != 0
+    int pre_shift_{0};
+    uint16_t multiplier_{0};
+    int post_shift_{0};
+    std::vector<uint8_t> lut_;  // otherwise
+};
+
+// Built on first use for each bit depth and shared afterwards. The
+// reference stays valid for the program's lifetime.
+const To8Bit& cached_to_8bit(int bit_depth);
+
+// Whole image to width * height * 3 interleaved bytes in `dst`, rows in
+// parallel. `dst` is only resized, so a reused buffer allocates nothing.
+void convert_to_8bit(const RgbImage& img, std::vector<uint8_t>& dst);
+
+// Same, into width * height * 3 bytes at `dst`
+void convert_to_8bit(const RgbImage& img, uint8_t* dst);
+
+} // namespace isp
+
+#endif
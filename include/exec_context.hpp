@@ -0,0 +1,161 @@
+#ifndef ISP_PIPELINE_EXEC_CONTEXT_HPP
+#define ISP_PIPELINE_EXEC_CONTEXT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace isp {
+
+// Persistent worker threads that run isp_core's parallel loops.
+//
+// A loop over [0, count) is cut into tasks of `grain` indices (row strips
+// or tiles), and the tasks are dealt out statically: worker w starts on
+// the w-th contiguous block of them. A worker that runs out steals single
+// tasks from the far end of the other blocks, which evens out uneven
+// strips without per-row scheduling. The static blocks mean a worker
+// touches the same part of a frame in every loop, the part first_touch()
+// placed on its NUMA node.
+//
+// The calling thread works as worker 0 and the others sleep between
+// loops. A loop started from inside a task runs inline on that worker.
+// Each context has a fixed thread budget; give every pipeline that runs
+// concurrently its own so that together they do not oversubscribe the
+// cores.
+class ExecContext {
+public:
+    // `threads` <= 0 takes default_threads(). Workers are not bound to
+    // CPUs; placing them is left to the OS scheduler.
+    explicit ExecContext(int threads = 0);
+    ~ExecContext();
+
+    ExecContext(const ExecContext&) = delete;
+    ExecContext& operator=(const ExecContext&) = delete;
+
+    int threads() const { return threads_; }
+
+    // ISP_NUM_THREADS if set to a positive count, else the hardware threads
+    static int default_threads();
+
+    // Run fn(begin, end, worker) over tasks covering [0, count), worker in
+    // [0, threads()). Returns when every task is done. Tasks that share a
+    // worker index never run at the same time, so per-worker scratch
+    // needs no locking.
+    template <typename Fn>
+    void run(int count, int grain, Fn&& fn) {
+        using F = std::remove_reference_t<Fn>;
+        run_tasks(count, grain, true, [](void* f, int begin, int end, int worker) {
+            (*static_cast<F*>(f))(begin, end, worker);
+        }, const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    // Tasks of about a quarter of each worker's share: enough to steal,
+    // few enough that scheduling costs nothing next to the rows
+    int default_grain(int count) const {
+        return std::max(1, count / (4 * threads_));
+    }
+
+    // Zero `bytes` at `data`, worker w writing the w-th of threads() equal
+    // slices: the part of the buffer an evenly split loop gives it. On a
+    // NUMA machine the pages then start on the node of the worker that
+    // processes them. On Linux the pages are released first so they are
+    // placed anew even if something touched them already. For freshly
+    // allocated buffers; the contents are lost.
+    void first_touch(void* data, std::size_t bytes);
+
+    // The context parallel loops on this thread use: the innermost
+    // ExecScope's, else shared()
+    static ExecContext& current();
+
+    // For threads without an ExecScope, created on first use with the
+    // default thread count
+    static ExecContext& shared();
+
+private:
+    using TaskFn = void (*)(void*, int begin, int end, int worker);
+
+    // Owned tasks [begin, end) of one worker, packed so the owner (taking
+    // from the front) and thieves (from the back) agree with one CAS
+    struct alignas(64) Block {
+        std::atomic<uint64_t> range{0};
+    };
+
+    void run_tasks(int count, int grain, bool steal, TaskFn fn, void* state);
+    void work(int worker);
+    void worker_main(int worker);
+    bool take_own(int worker, int& task);
+    bool steal_from(int victim, int& task);
+
+    int threads_;
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Block[]> blocks_;
+
+    // The current loop, published under mutex_ by bumping generation_
+    TaskFn fn_{nullptr};
+    void* state_{nullptr};
+    int count_{0};
+    int grain_{1};
+    bool steal_{true};
+    std::exception_ptr error_;  // first exception a task threw, rethrown by run()
+
+    std::mutex run_mutex_;  // one loop at a time when threads share a context
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_{0};
+    int pending_{0};        // workers still in the current loop
+    bool stop_{false};
+};
+
+// Makes `context` the one parallel loops on this thread use until the
+// scope ends
+class ExecScope {
+public:
+    explicit ExecScope(ExecContext& context);
+    ~ExecScope();
+
+    ExecScope(const ExecScope&) = delete;
+    ExecScope& operator=(const ExecScope&) = delete;
+
+private:
+    ExecContext* previous_;
+};
+
+// fn(begin, end) over [0, count) on the current context
+template <typename Fn>
+void parallel_for(int count, Fn&& fn) {
+    ExecContext& context = ExecContext::current();
+    context.run(count, context.default_grain(count), [&](int begin, int end, int) { fn(begin, end); });
+}
+
+// Same with explicit task size, and the worker index for per-worker scratch
+template <typename Fn>
+void parallel_for_workers(int count, int grain, Fn&& fn) {
+    ExecContext::current().run(count, grain, std::forward<Fn>(fn));
+}
+
+// `init` plus fn(begin, end) of every task, added with +=. Tasks finish in
+// any order, so the sum must not depend on grouping (integers).
+template <typename T, typename Fn>
+T parallel_sum(int count, T init, Fn&& fn) {
+    std::mutex mutex;
+    parallel_for(count, [&](int begin, int end) {
+        const T part = fn(begin, end);
+        std::lock_guard<std::mutex> lock(mutex);
+        init += part;
+    });
+    return init;
+}
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef ISP_PIPELINE_FRAME_ARENA_HPP
+#define ISP_PIPELINE_FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace isp {
+
+// Bump allocator for per-frame scratch memory. allocate() hands out
+// 64-byte-aligned, uninitialized storage; Scope gives it back when the stage
+// that took it returns. A request that does not fit opens an extra block;
+// the next reset() folds all blocks into one, so once the largest frame has
+// run, frames of that size allocate nothing.
+//
+// Not thread-safe: take the memory before entering a parallel region and
+// give each thread its own slice.
+class FrameArena {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    explicit FrameArena(std::size_t capacity = 0);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena(FrameArena&&) = default;
+    FrameArena& operator=(FrameArena&&) = default;
+
+    // Make sure `bytes` can be taken after the next reset() without a new block
+    void reserve(std::size_t bytes);
+
+    // Release everything; call between frames
+    void reset();
+
+    template <typename T>
+    T* allocate(std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "FrameArena holds trivial types only");
+        static_assert(alignof(T) <= kAlignment, "over-aligned type");
+        return static_cast<T*>(allocate_bytes(count * sizeof(T)));
+    }
+
+    std::size_t capacity() const;
+
+    // Bytes one allocate() of `bytes` takes from the arena, for sizing reserve()
+    static constexpr std::size_t footprint(std::size_t bytes) {
+        return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // Releases everything allocated after its construction
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) : arena_(arena), block_(arena.block_), offset_(arena.offset_) {}
+        ~Scope() {
+            arena_.block_ = block_;
+            arena_.offset_ = offset_;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameArena& arena_;
+        std::size_t block_;
+        std::size_t offset_;
+    };
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> storage;
+        std::byte* base;  // first kAlignment boundary in storage
+        std::size_t size;
+    };
+
+    void* allocate_bytes(std::size_t bytes);
+    void add_block(std::size_t bytes);
+
+    std::vector<Block> blocks_;
+    std::size_t block_{0};   // block currently bumped
+    std::size_t offset_{0};  // bytes used in it
+};
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ISP_PIPELINE_FRAME_POOL_HPP
+#define ISP_PIPELINE_FRAME_POOL_HPP
+
+#include "image.hpp"
+#include "pipeline.hpp"
+#include "rgb_image.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace isp {
+
+// Input and output buffers of one frame in flight: the RAW frame, the
+// pipeline output, and a byte buffer for packed input and the 8-bit
+// output (see unpack_raw in raw_unpack.hpp and Pipeline::process).
+struct FrameBuffers {
+    Image raw;
+    RgbImage rgb;
+    std::vector<uint8_t> bytes;
+};
+
+// A fixed set of FrameBuffers, all allocated up front for one frame format.
+// acquire() hands out a free set and blocks while every set is in use, so
+// the number of frames in flight (and the memory they hold) stays bounded.
+class FramePool {
+public:
+    FramePool(const FrameFormat& format, std::size_t count);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    FrameBuffers& acquire();
+    void release(FrameBuffers& buffers);
+
+    std::size_t size() const { return buffers_.size(); }
+
+private:
+    std::vector<std::unique_ptr<FrameBuffers>> buffers_;
+    std::vector<FrameBuffers*> free_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+};
+
+} // namespace isp
+
+#endif
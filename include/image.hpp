@@ -4,11 +4,33 @@
 #include <vector>
 #include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace isp {
 
 enum class BayerPattern { RGGB, BGGR, GRBG, GBRG };
 
+// Channel (0 = R, 1 = G, 2 = B) of the sample at (x, y)
+int bayer_channel(BayerPattern pattern, int x, int y);
+
+// "rggb", "bggr", "grbg" or "gbrg"; false for anything else
+bool parse_bayer_pattern(const std::string& name, BayerPattern& pattern);
+
+// Calls fn(std::integral_constant<BayerPattern, P>{}) for `pattern` and
+// returns its result, so kernels templated on the pattern are picked once
+// per frame instead of testing the pattern per pixel
+template <typename Fn>
+decltype(auto) dispatch_bayer_pattern(BayerPattern pattern, Fn&& fn) {
+    switch (pattern) {
+    case BayerPattern::BGGR: return fn(std::integral_constant<BayerPattern, BayerPattern::BGGR>{});
+    case BayerPattern::GRBG: return fn(std::integral_constant<BayerPattern, BayerPattern::GRBG>{});
+    case BayerPattern::GBRG: return fn(std::integral_constant<BayerPattern, BayerPattern::GBRG>{});
+    case BayerPattern::RGGB: break;
+    }
+    return fn(std::integral_constant<BayerPattern, BayerPattern::RGGB>{});
+}
+
 class Image {
 public:
     Image() = default;
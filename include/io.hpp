@@ -3,30 +3,83 @@
 
 #include "image.hpp"
 #include "rgb_image.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <optional>
+#include <vector>
 
 namespace isp {
 
+// How samples are laid out in a RAW file or buffer
+enum class RawPacking {
+    Unpacked16,  // one 16-bit word per sample, byte order from `little_endian`
+    Mipi10,      // MIPI CSI-2 RAW10: 4 samples in 5 bytes
+    Mipi12,      // MIPI CSI-2 RAW12: 2 samples in 3 bytes
+};
+
 struct RawFileConfig {
     int width;
     int height;
     int bit_depth = 12;
     BayerPattern pattern = BayerPattern::RGGB;
     bool little_endian = true;
+    RawPacking packing = RawPacking::Unpacked16;
+    // Bytes between the starts of consecutive rows; 0 = rows are packed
+    // back to back (see raw_row_bytes)
+    std::size_t row_stride = 0;
 };
 
+// Memory-maps the file and unpacks it (see unpack_raw in raw_unpack.hpp).
+// Fails if the file is shorter than one frame.
 std::optional<Image> load_raw(const std::string& path, const RawFileConfig& config);
 
+// Same, into an existing frame: `img` is reused when its format already
+// matches `config`, so repeated loads allocate nothing
+bool load_raw(const std::string& path, const RawFileConfig& config, Image& img);
+
 std::optional<Image> load_png_as_raw(const std::string& path, BayerPattern pattern = BayerPattern::RGGB);
 
+// The full-colour image load_png_as_raw samples, on the same 12-bit scale:
+// the ground truth for judging a demosaic of that mosaic
+std::optional<RgbImage> load_png(const std::string& path);
+
+enum class OutputFormat {
+    Png,
+    Ppm,   // 16-bit when the image is deeper than 8 bits
+    Ppm8,  // 8-bit, uncompressed: the cheapest to write
+};
+
+// "png", "ppm" or "ppm8", as taken by the command-line tools
+bool parse_output_format(const std::string& name, OutputFormat& format);
+
+// ".png" or ".ppm"
+const char* output_extension(OutputFormat format);
+
+// The writers serialize the whole frame into one buffer and write it in a
+// single call. Overloads taking `staging` use it for that buffer instead
+// of a temporary.
+
 // Grayscale output
 bool save_ppm(const std::string& path, const Image& img);
+bool save_ppm(const std::string& path, const Image& img, std::vector<uint8_t>& staging);
 
 // RGB output
 bool save_ppm(const std::string& path, const RgbImage& img);
+bool save_ppm(const std::string& path, const RgbImage& img, std::vector<uint8_t>& staging);
 
+// 8-bit interleaved RGB, e.g. from convert_to_8bit or
+// Pipeline::process(raw, out, rgb8)
+bool save_ppm(const std::string& path, const uint8_t* rgb, int width, int height);
+
+// PNG output is always 8-bit. With zlib available the rows are filtered
+// and deflated in parallel strips; otherwise stb_image_write encodes them.
 bool save_png(const std::string& path, const RgbImage& img);
+bool save_png(const std::string& path, const RgbImage& img, std::vector<uint8_t>& staging);
+bool save_png(const std::string& path, const uint8_t* rgb, int width, int height);
+
+// Dispatch on `format`
+bool save_image(const std::string& path, const RgbImage& img, OutputFormat format, std::vector<uint8_t>& staging);
 
 } // namespace isp
 
@@ -0,0 +1,159 @@
+#ifndef ISP_PIPELINE_LINE_BUFFER_HPP
+#define ISP_PIPELINE_LINE_BUFFER_HPP
+
+#include "exec_context.hpp"
+#include "frame_arena.hpp"
+#include "region.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace isp {
+
+// Run a (2*radius+1)-row neighbourhood filter over N row-major planes in
+// place. Rows of every plane start `stride` samples apart.
+//
+// The frame is cut into horizontal strips that workers of the current
+// ExecContext take whole. Before any strip is written, the `radius` rows
+// just outside each strip are snapshotted, because the neighbouring strip
+// will overwrite them. Each worker then walks its strip top to bottom
+// with a ring of 2*radius+1 original rows per plane: row y is filtered
+// from the ring straight into the image, and row y+radius+1 is pulled
+// into the slot row y-radius just vacated.
+//
+// Peak extra memory is the ring plus 2*radius halo rows per strip instead
+// of a full-frame copy, all taken from `arena`. `kernel(windows, out_rows, y)`
+// must produce row y of every plane from `windows` alone (columns of each
+// row start at frame column 0); filters that mix channels see all planes at
+// once.
+template <typename T, std::size_t N, typename Kernel>
+void filter_planes_in_place(const std::array<T*, N>& planes, int width, int height, std::size_t stride,
+                            int radius, FrameArena& arena, Kernel&& kernel) {
+    if (width <= 0 || height <= 0 || radius < 0) return;
+
+    const std::size_t row_len = static_cast<std::size_t>(width);
+    const int ring_rows = 2 * radius + 1;
+
+    // Strips: a few per worker for load balance, but tall enough that the
+    // halo snapshot stays small next to the strip itself
+    const int min_strip = std::max(16, 2 * ring_rows);
+    const int max_strips = std::max(1, height / min_strip);
+    ExecContext& context = ExecContext::current();
+    const int num_strips = std::min(max_strips, context.threads() * 4);
+    const int strip_height = (height + num_strips - 1) / num_strips;
+
+    auto row_ptr = [&](std::size_t c, int y) { return planes[c] + static_cast<std::size_t>(y) * stride; };
+    auto strip_begin = [&](int s) { return std::min(height, s * strip_height); };
+    auto strip_end = [&](int s) { return std::min(height, (s + 1) * strip_height); };
+
+    // Halo snapshot per strip and plane: rows [begin - radius, begin) then
+    // [end, end + radius), both clipped to the frame
+    FrameArena::Scope scope(arena);
+    const std::size_t halo_size = 2 * static_cast<std::size_t>(radius) * row_len;
+    T* halos = arena.allocate<T>(static_cast<std::size_t>(num_strips) * N * halo_size);
+    auto halo = [&](int s, std::size_t c) { return halos + (static_cast<std::size_t>(s) * N + c) * halo_size; };
+
+    // Ring and window row pointers, one slice per worker
+    const std::size_t ring_size = static_cast<std::size_t>(ring_rows) * row_len;
+    const std::size_t workers = static_cast<std::size_t>(context.threads());
+    T* rings = arena.allocate<T>(workers * N * ring_size);
+    const T** all_window_rows = arena.allocate<const T*>(workers * N * static_cast<std::size_t>(ring_rows));
+
+    const auto trace_frame = ISP_TRACE_CURRENT_FRAME;
+    context.run(num_strips, 1, [&](int first, int last, int) {
+        for (int s = first; s < last; ++s) {
+            ISP_TRACE_SCOPE_IN_FRAME("Strip halo", "rows", trace_frame);
+            const int top = std::max(0, strip_begin(s) - radius);
+            const int bottom = std::min(height, strip_end(s) + radius);
+            for (std::size_t c = 0; c < N; ++c) {
+                T* dst = halo(s, c);
+                for (int y = top; y < strip_begin(s); ++y, dst += row_len) {
+                    std::copy(row_ptr(c, y), row_ptr(c, y) + row_len, dst);
+                }
+                for (int y = strip_end(s); y < bottom; ++y, dst += row_len) {
+                    std::copy(row_ptr(c, y), row_ptr(c, y) + row_len, dst);
+                }
+            }
+        }
+    });
+    // run() returns once every halo is captured, before any row is written
+
+    context.run(num_strips, 1, [&](int first, int last, int worker) {
+        T* ring = rings + static_cast<std::size_t>(worker) * N * ring_size;
+        const T** window_rows = all_window_rows + static_cast<std::size_t>(worker) * N * static_cast<std::size_t>(ring_rows);
+        std::array<RowWindow<T>, N> windows;
+        std::array<T*, N> out_rows;
+        for (std::size_t c = 0; c < N; ++c) {
+            windows[c] = RowWindow<T>{window_rows + c * static_cast<std::size_t>(ring_rows), 0, width};
+        }
+
+        for (int s = first; s < last; ++s) {
+            ISP_TRACE_SCOPE_IN_FRAME("Strip", "rows", trace_frame);
+            const int begin = strip_begin(s);
+            const int end = strip_end(s);
+            const int top = std::max(0, begin - radius);
+
+            // Original contents of row y, which must lie within [begin - radius, end + radius)
+            auto original = [&](std::size_t c, int y) -> const T* {
+                if (y < begin) return halo(s, c) + static_cast<std::size_t>(y - top) * row_len;
+                if (y >= end) return halo(s, c) + static_cast<std::size_t>((begin - top) + (y - end)) * row_len;
+                return row_ptr(c, y);
+            };
+            auto slot = [&](std::size_t c, int y) {
+                return ring + c * ring_size + static_cast<std::size_t>(y % ring_rows) * row_len;
+            };
+            auto load = [&](int y) {
+                for (std::size_t c = 0; c < N; ++c) {
+                    const T* src = original(c, y);
+                    std::copy(src, src + row_len, slot(c, y));
+                }
+            };
+
+            for (int y = std::max(0, begin - radius); y < std::min(height, begin + radius + 1); ++y) {
+                load(y);
+            }
+
+            for (int y = begin; y < end; ++y) {
+                for (std::size_t c = 0; c < N; ++c) {
+                    for (int k = 0; k < ring_rows; ++k) {
+                        window_rows[c * static_cast<std::size_t>(ring_rows) + static_cast<std::size_t>(k)] =
+                            slot(c, std::clamp(y - radius + k, 0, height - 1));
+                    }
+                    out_rows[c] = row_ptr(c, y);
+                }
+                kernel(std::as_const(windows), std::as_const(out_rows), y);
+
+                const int next = y + radius + 1;
+                if (next < height && y + 1 < end) load(next);
+            }
+        }
+    });
+}
+
+// Same, with scratch memory allocated for this call
+template <typename T, std::size_t N, typename Kernel>
+void filter_planes_in_place(const std::array<T*, N>& planes, int width, int height, std::size_t stride,
+                            int radius, Kernel&& kernel) {
+    FrameArena arena;
+    filter_planes_in_place(planes, width, height, stride, radius, arena, std::forward<Kernel>(kernel));
+}
+
+// Single-plane form with contiguous rows. `kernel(window, out_row, y)`.
+template <typename T, typename Kernel>
+void filter_rows_in_place(T* data, int width, int height, int radius, FrameArena& arena, Kernel&& kernel) {
+    filter_planes_in_place(std::array<T*, 1>{data}, width, height, static_cast<std::size_t>(width), radius, arena,
+        [&](const std::array<RowWindow<T>, 1>& windows, const std::array<T*, 1>& out_rows, int y) {
+            kernel(windows[0], out_rows[0], y);
+        });
+}
+
+template <typename T, typename Kernel>
+void filter_rows_in_place(T* data, int width, int height, int radius, Kernel&& kernel) {
+    FrameArena arena;
+    filter_rows_in_place(data, width, height, radius, arena, std::forward<Kernel>(kernel));
+}
+
+} // namespace isp
+
+#endif
\ No newline at end of file
@@ -1,11 +1,93 @@
 #ifndef ISP_PIPELINE_MODULES_AWB_HPP
 #define ISP_PIPELINE_MODULES_AWB_HPP
 
+#include "planar_image.hpp"
 #include "rgb_image.hpp"
+#include "sample_format.hpp"
+#include <cstddef>
+#include <cstdint>
 
 namespace isp {
 
+struct AwbGains {
+    double r{1.0};
+    double g{1.0};
+    double b{1.0};
+};
+
+// Per-channel sample sums over `count` pixels
+struct ChannelSums {
+    uint64_t r = 0;
+    uint64_t g = 0;
+    uint64_t b = 0;
+    uint64_t count = 0;
+
+    ChannelSums& operator+=(const ChannelSums& other) {
+        r += other.r;
+        g += other.g;
+        b += other.b;
+        count += other.count;
+        return *this;
+    }
+};
+
+void add_channel_sums(const Pixel* data, std::size_t count, ChannelSums& sums);
+
+// Whole image, rows in parallel
+void add_channel_sums(const RgbImage& img, ChannelSums& sums);
+
+// Gray World gains from channel sums; unity when they are empty
+AwbGains gray_world_gains(const ChannelSums& sums);
+
+struct TemporalAwbConfig {
+    // Weight of the newest frame's gains in the running average, in
+    // (0, 1]; 1 follows every frame without smoothing
+    double smoothing = 0.25;
+};
+
+// White balance state for a video stream. Frame N is corrected with the
+// gains measured on frames before it, so no frame waits for a reduction
+// over itself, and an exponential moving average of those gains keeps
+// them from flickering. The first frame has no history and is measured
+// on its own.
+class TemporalAwb {
+public:
+    // Throws std::invalid_argument if smoothing is outside (0, 1]
+    explicit TemporalAwb(const TemporalAwbConfig& config = {});
+
+    bool has_gains() const { return frames_ > 0; }
+
+    // Gains for the next frame; unity before the first update()
+    const AwbGains& gains() const { return gains_; }
+
+    // Fold in one frame's measured gains. The first is taken as is.
+    void update(const AwbGains& measured);
+
+    void reset();
+
+private:
+    TemporalAwbConfig config_;
+    AwbGains gains_;
+    uint64_t frames_{0};
+};
+
 void apply_awb(RgbImage& img);
+void apply_awb(PlanarRgbImage& img);
+void apply_awb(PlanarRgbImage8& img);
+
+// Gray World gains from per-channel sums over `count` pixels
+AwbGains compute_awb_gains(double r_sum, double g_sum, double b_sum, double count);
+
+// Multiply `count` pixels by the gains, clamping to max_val
+void apply_awb_gains(Pixel* data, std::size_t count, const AwbGains& gains, uint16_t max_val);
+
+// Whole image, rows in parallel
+void apply_awb_gains(RgbImage& img, const AwbGains& gains);
+
+// Planar form: multiply `count` samples of one channel by `gain`, clamping
+// to Format::max_value. Instantiated for every format in sample_format.hpp.
+template <typename Format>
+void apply_awb_gain(typename Format::Sample* data, std::size_t count, double gain);
 
 } // namespace isp
 
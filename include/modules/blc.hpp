@@ -2,11 +2,21 @@
 #define ISP_PIPELINE_MODULES_BLC_HPP
 
 #include "image.hpp"
+#include "sample_format.hpp"
+#include <cstddef>
 
 namespace isp {
 
 void apply_blc(Image& img, uint16_t black_level);
 
+void apply_blc(uint16_t* data, std::size_t count, uint16_t black_level);
+
+// Subtract the black level and requantize to 8 bits (a right shift by
+// Format::bits - 8) for the 8-bit preview path. Instantiated for the
+// uint16_t formats in sample_format.hpp.
+template <typename Format>
+void apply_blc_to_8bit(const uint16_t* src, uint8_t* dst, std::size_t count, uint16_t black_level);
+
 } // namespace isp
 
 #endif
\ No newline at end of file
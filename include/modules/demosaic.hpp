@@ -2,11 +2,79 @@
 #define ISP_PIPELINE_MODULES_DEMOSAIC_HPP
 
 #include "image.hpp"
+#include "planar_image.hpp"
+#include "point_lut.hpp"
+#include "region.hpp"
 #include "rgb_image.hpp"
+#include <string>
 
 namespace isp {
 
-RgbImage demosaic(const Image& raw);
+struct ChannelSums;
+
+enum class DemosaicMethod {
+    Bilinear,  // 3x3: cheapest, but zippers and fringes along edges
+    Malvar,    // Malvar-He-Cutler 5x5 gradient-corrected interpolation
+};
+
+// "bilinear" or "mhc"; false for anything else
+bool parse_demosaic_method(const std::string& name, DemosaicMethod& method);
+
+// Rows and columns a method reads on each side of the output pixel
+constexpr int demosaic_radius(DemosaicMethod method) {
+    return method == DemosaicMethod::Malvar ? 2 : 1;
+}
+
+RgbImage demosaic(const Image& raw, DemosaicMethod method = DemosaicMethod::Bilinear);
+
+// Demosaic into `rgb`, reusing its storage when the size and depth match.
+// A non-null `lut` is applied to each output row while it is still in
+// cache, in place of a separate pass over the image. A non-null `sums`
+// receives the channel sums of the output before `lut`.
+void demosaic(const Image& raw, RgbImage& rgb, const PointLut* lut = nullptr, ChannelSums* sums = nullptr,
+              DemosaicMethod method = DemosaicMethod::Bilinear);
+
+// Preview demosaic with no interpolation: one RGB pixel per `factor` x
+// `factor` block of the Bayer frame, each channel the rounded mean of that
+// colour's samples in the block. At factor 2 that is R, the mean of the two
+// greens and B of one quad; 4, 8, ... bin further. The output is `factor`
+// times smaller each way, and rows and columns past the last whole block
+// are dropped. Throws std::invalid_argument unless `factor` is a power of
+// two >= 2 that leaves at least one block. `lut` and `sums` work as for
+// demosaic().
+RgbImage demosaic_binned(const Image& raw, int factor = 2);
+void demosaic_binned(const Image& raw, RgbImage& rgb, int factor, const PointLut* lut = nullptr,
+                     ChannelSums* sums = nullptr);
+
+// Same interpolation, written straight into planar storage
+PlanarRgbImage demosaic_planar(const Image& raw, DemosaicMethod method = DemosaicMethod::Bilinear);
+
+// Bilinear interpolation of frame row y, columns [x_begin, x_end), for a
+// frame with Bayer pattern P (instantiated for all four). `window` holds
+// raw rows y-1, y, y+1; out[0] receives column x_begin. The pattern is a
+// template argument so each instantiation has its sample phase built in;
+// pick one per frame with dispatch_bayer_pattern or demosaic_row_for.
+template <BayerPattern P>
+void demosaic_row(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out);
+
+// Malvar-He-Cutler interpolation of the same row: `window` holds raw rows
+// y-2 .. y+2. The gradient corrections can overshoot, so results are
+// clamped to [0, max_value].
+template <BayerPattern P>
+void demosaic_malvar_row(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out,
+                         uint16_t max_value);
+
+// Either row kernel; bilinear ignores `max_value`. The window holds
+// 2 * demosaic_radius(method) + 1 rows.
+using DemosaicRowFn = void (*)(const RowWindow<uint16_t>&, int, int, int, Pixel*, uint16_t);
+
+// The row kernel for `pattern` and `method`
+DemosaicRowFn demosaic_row_for(BayerPattern pattern, DemosaicMethod method = DemosaicMethod::Bilinear);
+
+// Planar form for any sample type (instantiated for uint8_t and uint16_t):
+// the same interpolation written to one output row per channel.
+template <BayerPattern P, typename T>
+void demosaic_row(const RowWindow<T>& window, int y, int x_begin, int x_end, T* out_r, T* out_g, T* out_b);
 
 } // namespace isp
 
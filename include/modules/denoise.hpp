@@ -1,15 +1,108 @@
 #ifndef ISP_DENOISE_HPP
 #define ISP_DENOISE_HPP
 
+#include "frame_arena.hpp"
+#include "planar_image.hpp"
+#include "region.hpp"
 #include "rgb_image.hpp"
+#include <vector>
 
 namespace isp {
 
+// Precomputed bilateral weights for one (sigma_spatial, sigma_range) pair:
+// a (2r+1)^2 spatial table and a range-weight LUT indexed by the squared
+// RGB distance to the centre pixel. Build once and reuse across rows,
+// tiles and frames.
+//
+// Tolerance vs. evaluating std::exp per tap:
+// - Range weights below exp(-17) (< 2^-24 of the centre's weight) are
+//   dropped. Every other weight is the same float std::exp produces as
+//   long as the LUT can hold one entry per integer distance, which is the
+//   case for sigma_range <= 43.9. Output differs by at most 1 code value.
+// - Above that, distances are quantized into 65536 buckets and weights
+//   carry a relative error below 1.3e-4, i.e. within 1 code value for
+//   12-bit data.
+class DenoiseKernel {
+public:
+    explicit DenoiseKernel(float sigma_spatial = 2.0f, float sigma_range = 30.0f);
+
+    float sigma_spatial() const { return sigma_spatial_; }
+    float sigma_range() const { return sigma_range_; }
+    int radius() const { return radius_; }
+
+    // One entry per integer squared distance (no quantization)
+    bool exact_range() const { return range_scale_ == 1.0f; }
+
+    // Row-major (dy, dx) table, dy and dx in [-radius, radius]
+    const float* spatial_table() const { return spatial_.data(); }
+
+    // Range LUT; index = min(color_dist * range_scale, range_max_index).
+    // The last entry is 0 so distances past the cutoff carry no weight.
+    const float* range_table() const { return range_.data(); }
+    float range_scale() const { return range_scale_; }
+    float range_max_index() const { return static_cast<float>(range_.size() - 1); }
+
+private:
+    float sigma_spatial_;
+    float sigma_range_;
+    int radius_;
+    float range_scale_{1.0f};
+    std::vector<float> spatial_;
+    std::vector<float> range_;
+};
+
+enum class DenoiseMethod {
+    Bilateral,  // exact bilateral filter, cost grows with radius^2
+    Guided,     // guided filter, constant cost per pixel at any radius
+};
+
+struct DenoiseParams {
+    DenoiseMethod method = DenoiseMethod::Bilateral;
+    float sigma_spatial = 2.0f;
+    float sigma_range = 30.0f;
+    // Guided only: the filter coefficients are solved on a grid downsampled
+    // by this factor and upsampled bilinearly. 1 is most accurate; 2 and 4
+    // cut the box-filter work by about 4x and 16x.
+    int subsample = 1;
+};
+
 // Bilateral filter for noise reduction
 // sigma_spatial: spatial kernel size (default: 2.0)
 // sigma_range: color similarity threshold (default: 30.0)
 void apply_denoise(RgbImage& img, float sigma_spatial = 2.0f, float sigma_range = 30.0f);
 
+// Same filter with prebuilt weight tables, for callers that run many frames
+void apply_denoise(RgbImage& img, const DenoiseKernel& kernel);
+void apply_denoise(RgbImage& img, const DenoiseKernel& kernel, FrameArena& arena);
+
+void apply_denoise(PlanarRgbImage& img, float sigma_spatial = 2.0f, float sigma_range = 30.0f);
+
+void apply_denoise(RgbImage& img, const DenoiseParams& params);
+void apply_denoise(PlanarRgbImage& img, const DenoiseParams& params);
+
+// Edge-preserving smoothing with a guided filter (He et al.), each channel
+// acting as its own guide. Box windows have radius ceil(2 * sigma_spatial)
+// and the regularizer is sigma_range^2, so structures whose local deviation
+// is well above sigma_range are kept. Approximates the bilateral filter
+// with O(1) work per pixel, independent of the radius.
+void apply_guided_denoise(RgbImage& img, float sigma_spatial, float sigma_range, int subsample = 1);
+void apply_guided_denoise(RgbImage& img, float sigma_spatial, float sigma_range, int subsample, FrameArena& arena);
+void apply_guided_denoise(PlanarRgbImage& img, float sigma_spatial, float sigma_range, int subsample = 1);
+void apply_guided_denoise(PlanarRgbImage8& img, float sigma_spatial, float sigma_range, int subsample = 1);
+
+// Kernel radius used for a given sigma_spatial: ceil(2 * sigma_spatial)
+int denoise_radius(float sigma_spatial);
+
+// Filter frame columns [x_begin, x_end) of one row. `window` holds the
+// 2*radius+1 source rows centred on it; out[0] receives column x_begin.
+void denoise_row(const RowWindow<Pixel>& window, int x_begin, int x_end, Pixel* out,
+                 const DenoiseKernel& kernel, uint16_t max_val);
+
+// Planar form: one window per channel, all centred on the same row
+void denoise_row(const RowWindow<uint16_t>& r, const RowWindow<uint16_t>& g, const RowWindow<uint16_t>& b,
+                 int x_begin, int x_end, uint16_t* out_r, uint16_t* out_g, uint16_t* out_b,
+                 const DenoiseKernel& kernel, uint16_t max_val);
+
 } // namespace isp
 
 #endif // ISP_DENOISE_HPP
\ No newline at end of file
@@ -1,11 +1,33 @@
 #ifndef ISP_PIPELINE_MODULES_GAMMA_HPP
 #define ISP_PIPELINE_MODULES_GAMMA_HPP
 
+#include "planar_image.hpp"
 #include "rgb_image.hpp"
+#include "sample_format.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace isp {
 
 void apply_gamma(RgbImage& img, double gamma = 2.2);
+void apply_gamma(PlanarRgbImage& img, double gamma = 2.2);
+void apply_gamma(PlanarRgbImage8& img, double gamma = 2.2);
+
+// LUT mapping every code in [0, max_val] through x^(1/gamma)
+std::vector<uint16_t> build_gamma_lut(uint16_t max_val, double gamma);
+
+void apply_gamma_lut(Pixel* data, std::size_t count, const std::vector<uint16_t>& lut);
+
+// Format::max_value + 1 entries, shared between calls with the same gamma.
+// Only the few most recently used gammas are kept, so a gamma sweep does
+// not grow the cache; the returned table stays valid while it is held.
+template <typename Format>
+std::shared_ptr<const std::vector<typename Format::Sample>> cached_gamma_lut(double gamma);
+
+// Planar form over one channel; `lut` has Format::max_value + 1 entries
+template <typename Format>
+void apply_gamma_lut(typename Format::Sample* data, std::size_t count, const typename Format::Sample* lut);
 
 } // namespace isp
 
@@ -0,0 +1,49 @@
+#ifndef ISP_PIPELINE_MODULES_RAW_DENOISE_HPP
+#define ISP_PIPELINE_MODULES_RAW_DENOISE_HPP
+
+#include "frame_arena.hpp"
+#include "image.hpp"
+#include <cstdint>
+
+namespace isp {
+
+// Sensor noise in code values after BLC: shot noise that grows with the
+// signal plus a constant read noise, sigma^2(s) = shot_gain * s + read_sigma^2
+struct RawNoiseModel {
+    float shot_gain = 0.4f;   // code values per photo-electron
+    float read_sigma = 4.0f;  // code values
+
+    float variance(float signal) const { return shot_gain * signal + read_sigma * read_sigma; }
+
+    // Typical noise for a sensor of this depth and black level, for when
+    // no calibration is at hand. Pedestals are set about 16 read-noise
+    // sigmas above zero so the noise floor is not clipped, and full scale
+    // is taken as a 10k-electron well.
+    static RawNoiseModel estimate(int bit_depth, uint16_t black_level);
+};
+
+struct RawDenoiseParams {
+    // Black level the frame had before BLC, for RawNoiseModel::estimate
+    uint16_t black_level = 64;
+    // Same-colour neighbours further than strength * sigma from the centre
+    // sample get no weight; closer ones are weighted by 1 - (d / that)^2
+    float strength = 2.0f;
+};
+
+// Edge-preserving denoise on the Bayer frame, between BLC and demosaic.
+// Each sample is averaged with the 8 nearest samples of its own colour
+// (2 columns and/or 2 rows away, mirrored at the frame edges), weighted by
+// how far each lies from it relative to the noise expected at its level.
+// Filtering one sample per pixel is a third of the work of an RGB denoise,
+// and noise is removed before demosaic can spread it into its neighbours.
+void apply_raw_denoise(Image& raw, const RawDenoiseParams& params = {});
+void apply_raw_denoise(Image& raw, const RawNoiseModel& noise, float strength, FrameArena& arena);
+
+// Filter one row. `north` and `south` are the rows two above and below
+// (the same colours as `mid`), all `width` samples long.
+void raw_denoise_row(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int width, uint16_t* out,
+                     const RawNoiseModel& noise, float strength, uint16_t max_value);
+
+} // namespace isp
+
+#endif
@@ -1,11 +1,45 @@
 #ifndef ISP_PIPELINE_MODULES_SHARPEN_HPP
 #define ISP_PIPELINE_MODULES_SHARPEN_HPP
 
+#include "convert_8bit.hpp"
+#include "frame_arena.hpp"
+#include "planar_image.hpp"
+#include "region.hpp"
 #include "rgb_image.hpp"
+#include "sample_format.hpp"
 
 namespace isp {
 
-void apply_sharpen(RgbImage& img);
+// Sharpening adds `strength` times the 4-neighbour Laplacian to each sample:
+// c + strength * (4c - up - down - left - right). Strength 1 is the classic
+// 5-point kernel, 0 leaves the image unchanged. The row kernels take it as
+// a fixed-point gain with 8 fractional bits, so results are exact integers.
+constexpr int kSharpenUnitGain = 256;
+
+// Gain for `strength`; throws std::invalid_argument outside [0, 8]
+int sharpen_gain(float strength);
+
+void apply_sharpen(RgbImage& img, float strength = 1.0f);
+void apply_sharpen(RgbImage& img, FrameArena& arena, float strength = 1.0f);
+
+// Also writes each sharpened row to `rgb8` (width * height * 3 bytes) while
+// it is still in cache
+void apply_sharpen(RgbImage& img, FrameArena& arena, const To8Bit& to_8bit, uint8_t* rgb8,
+                   float strength = 1.0f);
+// The planar forms sharpen at strength 1
+void apply_sharpen(PlanarRgbImage& img);
+void apply_sharpen(PlanarRgbImage8& img);
+
+// Sharpen frame columns [x_begin, x_end) of one row. `window` holds the
+// source rows above, at and below it; out[0] receives column x_begin.
+void sharpen_row(const RowWindow<Pixel>& window, int x_begin, int x_end, Pixel* out,
+                 uint16_t max_val, int gain = kSharpenUnitGain);
+
+// Single-channel form over one plane, clamping to Format::max_value.
+// Instantiated for every format in sample_format.hpp.
+template <typename Format>
+void sharpen_row(const RowWindow<typename Format::Sample>& window, int x_begin, int x_end,
+                 typename Format::Sample* out);
 
 } // namespace isp
 
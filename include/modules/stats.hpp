@@ -0,0 +1,71 @@
+#ifndef ISP_PIPELINE_MODULES_STATS_HPP
+#define ISP_PIPELINE_MODULES_STATS_HPP
+
+#include "frame_arena.hpp"
+#include "image.hpp"
+#include "modules/awb.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace isp {
+
+constexpr int kStatsHistogramBins = 256;
+
+// What compute_bayer_stats collects. The unit is the 2x2 Bayer quad (one
+// R, two G, one B sample); odd trailing rows and columns are skipped.
+struct StatsConfig {
+    // Grid of equal zones over the frame
+    int zones_x = 16;
+    int zones_y = 12;
+
+    // Sample every n-th quad in each direction; 1 = every quad
+    int subsample = 1;
+
+    // Black level already subtracted from the frame. Samples at or above
+    // max_value - black_level, the sensor's clip point after BLC, count as
+    // saturated.
+    uint16_t black_level = 0;
+};
+
+// Sums over the sampled quads whose top-left sample lies in one zone
+struct ZoneStats {
+    uint64_t r = 0;
+    uint64_t g = 0;  // both greens
+    uint64_t b = 0;
+    uint32_t quads = 0;
+    uint32_t saturated = 0;  // quads with at least one clipped sample
+};
+
+struct BayerStats {
+    int zones_x = 0;
+    int zones_y = 0;
+    uint16_t saturation_level = 0;
+
+    std::vector<ZoneStats> zones;  // row-major, zones_x * zones_y
+    ZoneStats total;               // all zones
+
+    // R, G, B sample histograms over [0, max_value], kStatsHistogramBins
+    // equal bins each; greens contribute two samples per quad
+    std::array<std::array<uint32_t, kStatsHistogramBins>, 3> histogram{};
+
+    const ZoneStats& zone(int zx, int zy) const {
+        return zones[static_cast<std::size_t>(zy) * static_cast<std::size_t>(zones_x) + static_cast<std::size_t>(zx)];
+    }
+};
+
+// Statistics of a BLC'd Bayer frame, for AWB and auto exposure. Threads
+// take bands of quad rows and accumulate into private zone and histogram
+// partials taken from `arena`; the partials are then summed per zone.
+// `stats` is reused, so repeated calls with one config allocate nothing.
+// Throws std::invalid_argument for non-positive zone counts or subsample.
+void compute_bayer_stats(const Image& raw, const StatsConfig& config, BayerStats& stats, FrameArena& arena);
+BayerStats compute_bayer_stats(const Image& raw, const StatsConfig& config = {});
+
+// Gray World gains from the frame's channel means, as apply_awb computes
+// them from the demosaiced image
+AwbGains gray_world_gains(const BayerStats& stats);
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,474 @@
+#ifndef ISP_PIPELINE_PIPELINE_HPP
+#define ISP_PIPELINE_PIPELINE_HPP
+
+#include "convert_8bit.hpp"
+#include "exec_context.hpp"
+#include "frame_arena.hpp"
+#include "image.hpp"
+#include "point_lut.hpp"
+#include "rgb_image.hpp"
+#include "stage_cache.hpp"
+#include "modules/awb.hpp"
+#include "modules/demosaic.hpp"
+#include "modules/denoise.hpp"
+#include "modules/raw_denoise.hpp"
+#include "modules/stats.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace isp {
+
+// Geometry and sample format of the frames a pipeline is planned for
+struct FrameFormat {
+    int width = 0;
+    int height = 0;
+    int bit_depth = 12;
+    BayerPattern pattern = BayerPattern::RGGB;
+
+    bool operator==(const FrameFormat&) const = default;
+};
+
+// Buffers one frame passes through. RAW stages modify `raw` in place,
+// the demosaic stage fills `rgb`, and RGB stages modify `rgb` in place.
+// Temporary buffers come from `scratch`, which is emptied between frames.
+// `stats` is set by a StatsStage for the stages after it.
+// `rgb8` is set only for the last stage, and only when it
+// fuses_8bit_output(): it then also writes the final image there as
+// interleaved 8-bit RGB.
+// `lut` is set only for a stage that fuses_point_lut(), when the point
+// operations after it were folded into it: it then also maps its output
+// through the table.
+struct Frame {
+    Image& raw;
+    RgbImage& rgb;
+    FrameArena& scratch;
+    const BayerStats* stats = nullptr;
+    uint8_t* rgb8 = nullptr;
+    const PointLut* lut = nullptr;
+};
+
+// One step of the ISP. A stage sees the frame format once in plan(), where
+// it builds its tables, and afterwards only run() is called per frame.
+class Stage {
+public:
+    enum class Domain { Raw, Demosaic, Rgb };
+
+    virtual ~Stage() = default;
+
+    virtual const char* name() const = 0;
+    virtual Domain domain() const = 0;
+
+    virtual void plan(const FrameFormat& format) { (void)format; }
+    virtual void run(Frame& frame) = 0;
+
+    // Whether run() honours Frame::rgb8
+    virtual bool fuses_8bit_output() const { return false; }
+
+    // Whether run() honours Frame::lut
+    virtual bool fuses_point_lut() const { return false; }
+
+    // Point operations map each sample through a per-channel function
+    // (BLC, white balance gains, gamma). The pipeline composes each run of
+    // them into one PointLut and never calls their run().
+    virtual bool is_point_op() const { return false; }
+
+    // Apply this stage's function on top of `lut`: lut[c][v] = f_c(lut[c][v]),
+    // clamped to lut.max_value()
+    virtual void compose(PointLut& lut, const Frame& frame) { (void)lut; (void)frame; }
+
+    // Whether compose() depends on the frame, so the table is rebuilt per
+    // frame rather than once in plan()
+    virtual bool composes_per_frame() const { return false; }
+
+    // Whether compose() reads Frame::rgb, so the run cannot be folded into
+    // the demosaic stage before it
+    virtual bool compose_reads_rgb(const Frame& frame) const { (void)frame; return false; }
+
+    // Where to add the current frame's Bayer sums, or null: R, both greens,
+    // B and the quad count over whole quads, as compute_bayer_stats totals
+    // them. They are taken from the demosaic input in the last RAW step's
+    // own pass when that is the BLC table, else in one pass after it. Not
+    // added when process_cached() restores a later step.
+    virtual ZoneStats* bayer_sums() { return nullptr; }
+
+    // For a demosaic stage: RAW pixels per side of the block one RGB pixel
+    // covers. Stages after it see an image that many times smaller each way.
+    virtual int binning() const { return 1; }
+
+    // Hash of the parameters run() depends on, for Pipeline::process_cached.
+    // Empty when the output depends on more than the input frame and these
+    // parameters (e.g. state carried between frames), which keeps this
+    // stage and everything after it out of the cache.
+    virtual std::optional<uint64_t> params_hash() const { return std::nullopt; }
+};
+
+class BlcStage : public Stage {
+public:
+    explicit BlcStage(uint16_t black_level = 64) : black_level_(black_level) {}
+
+    const char* name() const override { return "BLC"; }
+    Domain domain() const override { return Domain::Raw; }
+    void run(Frame& frame) override;
+    bool is_point_op() const override { return true; }
+    void compose(PointLut& lut, const Frame& frame) override;
+    std::optional<uint64_t> params_hash() const override { return black_level_; }
+
+private:
+    uint16_t black_level_;
+};
+
+// Bayer-domain denoise (see apply_raw_denoise). Place it after BLC; the
+// noise model is estimated for the planned bit depth and the black level
+// in `params`.
+class RawDenoiseStage : public Stage {
+public:
+    explicit RawDenoiseStage(const RawDenoiseParams& params = {}) : params_(params) {}
+
+    const char* name() const override { return "Raw denoise"; }
+    Domain domain() const override { return Domain::Raw; }
+    void plan(const FrameFormat& format) override;
+    void run(Frame& frame) override;
+    std::optional<uint64_t> params_hash() const override;
+
+private:
+    RawDenoiseParams params_;
+    RawNoiseModel noise_;
+};
+
+// Collects 3A statistics from the Bayer frame (see compute_bayer_stats)
+// and publishes them in Frame::stats. Place it after BLC.
+class StatsStage : public Stage {
+public:
+    explicit StatsStage(const StatsConfig& config = {}) : config_(config) {}
+
+    const char* name() const override { return "Stats"; }
+    Domain domain() const override { return Domain::Raw; }
+    void run(Frame& frame) override;
+    std::optional<uint64_t> params_hash() const override;
+
+    const BayerStats& stats() const { return stats_; }
+
+private:
+    StatsConfig config_;
+    BayerStats stats_;
+};
+
+class DemosaicStage : public Stage {
+public:
+    explicit DemosaicStage(DemosaicMethod method = DemosaicMethod::Bilinear) : method_(method) {}
+
+    const char* name() const override { return "Demosaic"; }
+    Domain domain() const override { return Domain::Demosaic; }
+    void run(Frame& frame) override;
+    bool fuses_point_lut() const override { return true; }
+    std::optional<uint64_t> params_hash() const override { return static_cast<uint64_t>(method_); }
+
+    DemosaicMethod method() const { return method_; }
+
+private:
+    DemosaicMethod method_;
+};
+
+// Preview demosaic (see demosaic_binned): the RGB stages after it run on
+// an image `factor` times smaller each way
+class BinnedDemosaicStage : public Stage {
+public:
+    // Throws std::invalid_argument unless `factor` is a power of two >= 2
+    explicit BinnedDemosaicStage(int factor = 2);
+
+    const char* name() const override { return "Binned demosaic"; }
+    Domain domain() const override { return Domain::Demosaic; }
+    void plan(const FrameFormat& format) override;
+    void run(Frame& frame) override;
+    bool fuses_point_lut() const override { return true; }
+    int binning() const override { return factor_; }
+    std::optional<uint64_t> params_hash() const override { return static_cast<uint64_t>(factor_); }
+
+private:
+    int factor_;
+};
+
+// Gray World. Gains come from Frame::stats when a StatsStage ran, and
+// otherwise from a pass over the demosaiced image.
+//
+// In video mode the frame is corrected with TemporalAwb's gains from the
+// frames before it. Each frame's own measurement only feeds the next
+// frame. It comes from Frame::stats, or else from Bayer sums taken in the
+// BLC pass, the same statistic, so a steady scene comes out as in still
+// mode; only without either is the demosaiced image measured.
+class AwbStage : public Stage {
+public:
+    AwbStage() = default;
+    explicit AwbStage(const TemporalAwbConfig& temporal) : temporal_(std::in_place, temporal) {}
+
+    const char* name() const override { return "AWB"; }
+    Domain domain() const override { return Domain::Rgb; }
+    void run(Frame& frame) override;
+    bool is_point_op() const override { return true; }
+    void compose(PointLut& lut, const Frame& frame) override;
+    bool composes_per_frame() const override { return true; }
+    bool compose_reads_rgb(const Frame& frame) const override;
+    ZoneStats* bayer_sums() override;
+    // Video mode output depends on earlier frames
+    std::optional<uint64_t> params_hash() const override;
+
+    // Video mode state; null otherwise
+    const TemporalAwb* temporal() const { return temporal_ ? &*temporal_ : nullptr; }
+
+private:
+    // Gains for this frame; `lut` is what the image has been through so far
+    AwbGains frame_gains(const Frame& frame, const PointLut* lut);
+
+    std::optional<TemporalAwb> temporal_;
+    BayerStats measured_;  // this frame's Bayer sums in `total`, video mode only
+};
+
+// The setters of the tunable stages below may be called between frames of
+// a planned pipeline: they rebuild only the stage's own tables, and the
+// pipeline picks the change up from params_hash() (see Pipeline).
+class GammaStage : public Stage {
+public:
+    explicit GammaStage(double gamma = 2.2) : gamma_(gamma) {}
+
+    const char* name() const override { return "Gamma"; }
+    Domain domain() const override { return Domain::Rgb; }
+    void plan(const FrameFormat& format) override;
+    void run(Frame& frame) override;
+    bool is_point_op() const override { return true; }
+    void compose(PointLut& lut, const Frame& frame) override;
+    std::optional<uint64_t> params_hash() const override;
+
+    double gamma() const { return gamma_; }
+    void set_gamma(double gamma);
+
+private:
+    void build_lut();
+
+    double gamma_;
+    uint16_t max_code_{0};  // planned; 0 before plan()
+    std::vector<uint16_t> lut_;
+};
+
+class DenoiseStage : public Stage {
+public:
+    explicit DenoiseStage(const DenoiseParams& params = {}) : params_(params) {}
+
+    const char* name() const override { return "Denoise"; }
+    Domain domain() const override { return Domain::Rgb; }
+    void plan(const FrameFormat& format) override;
+    void run(Frame& frame) override;
+    std::optional<uint64_t> params_hash() const override;
+
+    const DenoiseParams& params() const { return params_; }
+    void set_params(const DenoiseParams& params);
+
+private:
+    void build_kernel();
+
+    DenoiseParams params_;
+    std::optional<DenoiseKernel> kernel_;
+};
+
+class SharpenStage : public Stage {
+public:
+    // Throws std::invalid_argument for a strength outside [0, 8]
+    explicit SharpenStage(float strength = 1.0f);
+
+    const char* name() const override { return "Sharpen"; }
+    Domain domain() const override { return Domain::Rgb; }
+    void plan(const FrameFormat& format) override;
+    void run(Frame& frame) override;
+    bool fuses_8bit_output() const override { return true; }
+    std::optional<uint64_t> params_hash() const override;
+
+    float strength() const { return strength_; }
+    // Throws std::invalid_argument for a strength outside [0, 8], keeping
+    // the old one
+    void set_strength(float strength);
+
+private:
+    float strength_;
+    int gain_;  // sharpen_gain(strength_); the output depends only on this
+    const To8Bit* to_8bit_{nullptr};
+};
+
+// Wall time of one step in the last process() call. A step is one stage,
+// or a run of point operations together with the stage they were folded
+// into, named e.g. "Demosaic+AWB+Gamma".
+struct StageTiming {
+    const char* name;
+    double microseconds;
+};
+
+// An ordered list of stages, planned once for a frame format and then run
+// on any number of frames of that format.
+//
+//   isp::Pipeline pipeline;
+//   pipeline.add<isp::BlcStage>(64).add<isp::DemosaicStage>().add<isp::GammaStage>(2.2);
+//   pipeline.plan({width, height, 12});
+//   while (...) pipeline.process(raw, rgb);
+//
+// plan() checks the stage order (RAW stages, then exactly one demosaic,
+// then RGB stages), lets every stage build its tables, and sizes the
+// working RAW buffer, so process() does no per-frame setup. process()
+// copies the input into that buffer, leaving it untouched, and reuses
+// `out` when it already has the frame's size.
+//
+// Consecutive point operations are composed into one per-channel table
+// (once in plan(), or per frame when one of them depends on the frame) and
+// applied in a single pass: RAW ones at the start fold into the input
+// copy, RGB ones right after the demosaic fold into its output rows, and
+// any other run is one table lookup per sample. Stage scratch memory comes
+// from an arena that grows during the first frame and is reused after it,
+// so from the second frame on process() makes no heap allocations.
+//
+// Stage parameters may change between frames through the stages' setters
+// (GammaStage::set_gamma, DenoiseStage::set_params,
+// SharpenStage::set_strength). Each process() compares every stage's
+// params_hash() with the last one it saw and recomposes only the tables
+// that hold a changed one; the buffers stay as planned.
+class Pipeline {
+public:
+    Pipeline() = default;
+    Pipeline(Pipeline&&) = default;
+    Pipeline& operator=(Pipeline&&) = default;
+
+    Pipeline& add(std::unique_ptr<Stage> stage);
+
+    template <typename S, typename... Args>
+    Pipeline& add(Args&&... args) {
+        return add(std::make_unique<S>(std::forward<Args>(args)...));
+    }
+
+    const std::vector<std::unique_ptr<Stage>>& stages() const { return stages_; }
+
+    // Throws std::invalid_argument if the stage order is invalid
+    void plan(const FrameFormat& format);
+    bool planned() const { return planned_; }
+    const FrameFormat& format() const { return format_; }
+
+    // Size of the RGB output: the frame's, divided by the demosaic stage's binning
+    int output_width() const { return output_width_; }
+    int output_height() const { return output_height_; }
+
+    // Throws std::invalid_argument if `raw` does not match the planned format
+    void process(const Image& raw, RgbImage& out);
+
+    // Same, and also writes the result to `rgb8` as interleaved 8-bit RGB
+    // for the PNG/PPM writers. The conversion is fused into the last stage
+    // when it supports that, and otherwise runs after it. `rgb8` is only
+    // resized, so a reused buffer allocates nothing.
+    void process(const Image& raw, RgbImage& out, std::vector<uint8_t>& rgb8);
+
+    // Incremental mode for parameter tuning. process_cached() stores the
+    // output of each step in `cache`, keyed by `frame_id` and the
+    // params_hash() of every stage up to that step, and resumes from the
+    // latest step already there. A changed late-stage parameter, set
+    // through the stage's setter or in a rebuilt pipeline, therefore reruns
+    // only that stage and the ones after it. The last step's output is
+    // `out` itself and is not stored, and of a run of RAW steps only the
+    // last is. `frame_id` must change whenever the contents of `raw` do.
+    // Steps restored from the cache report 0 in last_timings(). Null turns
+    // caching off. The cache must outlive the pipeline's use of it; it is
+    // not owned.
+    void set_cache(StageCache* cache) { cache_ = cache; }
+    StageCache* cache() const { return cache_; }
+
+    // Same as process() without a cache
+    void process_cached(const Image& raw, uint64_t frame_id, RgbImage& out);
+
+    const std::vector<StageTiming>& last_timings() const { return timings_; }
+
+    // Thread budget: with threads > 0 the pipeline owns an ExecContext of
+    // that many workers and runs every stage on it, so pipelines processing
+    // concurrently split the cores instead of each claiming all of them.
+    // 0 (the default) runs on the caller's ExecContext::current(). Call
+    // before plan(), which places the frame buffers on the workers.
+    void set_threads(int threads);
+    int threads() const;
+
+private:
+    // Stages [begin, end) run as one unit. Either a single stage, or a
+    // stage that fuses_point_lut() followed by point operations, or only
+    // point operations.
+    struct Step {
+        std::size_t begin;
+        std::size_t end;
+        std::size_t points_begin;  // first point operation, or `end`
+        bool per_frame;            // a point operation composes per frame
+        std::string name;
+        PointLut lut;
+        // Hash of stages [0, end) for process_cached(), when they all have one
+        std::optional<uint64_t> cache_key;
+        bool cache_output;         // process_cached() stores this step's output
+    };
+
+    void run_stages(const Image& raw, RgbImage& out, uint8_t* rgb8, const uint64_t* frame_id = nullptr);
+    // First step to run for `frame_id`: one past the latest cached step,
+    // whose output is restored into the working buffers and `frame`
+    std::size_t restore_cached(uint64_t frame_id, Frame& frame);
+    void store_cached(uint64_t frame_id, const Step& step, const Frame& frame);
+    void compose_points(Step& step, const Frame& frame);
+    // From params_: each step's key for process_cached() and whether it is stored
+    void compute_cache_keys();
+    // Picks up parameters changed through stage setters since the last
+    // frame: recomposes the tables built in plan() that hold them and the
+    // cache keys, without re-planning
+    void refresh_params(const Frame& frame);
+    // Adds the Bayer sums of work_raw_ to every stage's bayer_sums(). With
+    // `lut`, maps `src` into work_raw_ through it in the same pass.
+    void sum_bayer(const PointLut* lut, const Image& src);
+    ExecContext& context() const { return exec_ ? *exec_ : ExecContext::current(); }
+
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::vector<Step> steps_;
+    std::vector<std::optional<uint64_t>> params_;  // params_hash() of each stage as last seen
+    FrameFormat format_;
+    int output_width_{0};
+    int output_height_{0};
+    bool planned_{false};
+    Image work_raw_;
+    FrameArena arena_;
+    std::vector<StageTiming> timings_;
+    StageCache* cache_{nullptr};
+    BayerStats cached_stats_;  // Frame::stats when resuming past the Stats stage
+    std::unique_ptr<ExecContext> exec_;  // null: the caller's context
+};
+
+// BLC → Stats → Demosaic → AWB → Gamma → Denoise → Sharpen with the
+// parameters isp_main has always used. `stats.black_level` is taken from
+// `black_level`.
+//
+// With `video` set, AWB runs in video mode with `temporal_awb` and
+// measures each frame in the demosaic pass, so there is no Stats stage:
+// BLC → Demosaic → AWB → Gamma → Denoise → Sharpen, with no full-frame
+// reduction before demosaic.
+struct PipelineConfig {
+    uint16_t black_level = 64;
+    double gamma = 2.2;
+    DemosaicMethod demosaic = DemosaicMethod::Bilinear;
+    // 1: full resolution. 2, 4, ...: a preview pipeline, demosaicing with
+    // BinnedDemosaicStage(preview_binning) so every RGB stage does
+    // preview_binning^2 times less work.
+    int preview_binning = 1;
+    // Adds a RawDenoiseStage right after BLC
+    bool raw_denoise = false;
+    RawDenoiseParams raw_denoise_params;
+    DenoiseParams denoise;
+    float sharpen_strength = 1.0f;
+    StatsConfig stats;
+    bool video = false;
+    TemporalAwbConfig temporal_awb;
+    // Pipeline::set_threads; 0 runs on the caller's context
+    int threads = 0;
+};
+
+Pipeline make_default_pipeline(const PipelineConfig& config = {});
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef ISP_PIPELINE_PLANAR_IMAGE_HPP
+#define ISP_PIPELINE_PLANAR_IMAGE_HPP
+
+#include "rgb_image.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace isp {
+
+// Allocator returning storage aligned to `Alignment` bytes
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+    void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t{Alignment}); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+};
+
+// RGB image stored as three separate planes of T (structure of arrays).
+// Every row of every plane starts on a 64-byte boundary: the row stride is
+// the width rounded up to kRowAlignment samples, and planes follow each
+// other in one allocation. Per-channel stages run on a plane as a plain
+// array, which vectorizes without any deinterleaving.
+template <typename T>
+class PlanarImage {
+public:
+    using Sample = T;
+    static constexpr int kRowAlignment = static_cast<int>(64 / sizeof(T)); // samples
+
+    PlanarImage() = default;
+    PlanarImage(int width, int height, int bit_depth = sizeof(T) == 1 ? 8 : 12);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int bit_depth() const { return bit_depth_; }
+    std::size_t size() const { return static_cast<std::size_t>(width_) * static_cast<std::size_t>(height_); }
+    uint16_t max_value() const;
+
+    // Samples between the starts of consecutive rows
+    std::size_t stride() const { return stride_; }
+
+    // Channel 0 = R, 1 = G, 2 = B
+    T* plane(int channel) { return data_.data() + static_cast<std::size_t>(channel) * plane_size(); }
+    const T* plane(int channel) const { return data_.data() + static_cast<std::size_t>(channel) * plane_size(); }
+
+    T* row(int channel, int y) { return plane(channel) + static_cast<std::size_t>(y) * stride_; }
+    const T* row(int channel, int y) const { return plane(channel) + static_cast<std::size_t>(y) * stride_; }
+
+private:
+    std::size_t plane_size() const { return stride_ * static_cast<std::size_t>(height_); }
+
+    int width_{0};
+    int height_{0};
+    int bit_depth_{12};
+    std::size_t stride_{0};
+    std::vector<T, AlignedAllocator<T, 64>> data_;
+};
+
+extern template class PlanarImage<uint8_t>;
+extern template class PlanarImage<uint16_t>;
+
+using PlanarRgbImage = PlanarImage<uint16_t>;
+using PlanarRgbImage8 = PlanarImage<uint8_t>;
+
+// Conversions at the boundary with interleaved code (demosaic output, I/O)
+PlanarRgbImage to_planar(const RgbImage& img);
+RgbImage to_interleaved(const PlanarRgbImage& img);
+RgbImage to_interleaved(const PlanarRgbImage8& img);
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef ISP_PIPELINE_POINT_LUT_HPP
+#define ISP_PIPELINE_POINT_LUT_HPP
+
+#include "image.hpp"
+#include "rgb_image.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace isp {
+
+// One table per colour channel (R, G, B) mapping every code in
+// [0, max_value] to an output code. Point operations (BLC, white balance
+// gains, gamma) compose onto it, so a chain of them costs one lookup per
+// sample. Entries are clamped by whoever writes them; codes above
+// max_value are looked up as max_value.
+class PointLut {
+public:
+    PointLut() = default;
+
+    // Identity tables for `bit_depth`; storage is reused when the depth
+    // does not change
+    void reset(int bit_depth);
+
+    int bit_depth() const { return bit_depth_; }
+    uint16_t max_value() const { return max_value_; }
+    std::size_t size() const { return static_cast<std::size_t>(max_value_) + 1; }
+
+    uint16_t* channel(int c) { return table_.data() + static_cast<std::size_t>(c) * size(); }
+    const uint16_t* channel(int c) const { return table_.data() + static_cast<std::size_t>(c) * size(); }
+
+    // In place over interleaved pixels; an AVX2 gather when available
+    void apply(Pixel* data, std::size_t count) const;
+
+    // Whole image, rows in parallel
+    void apply(RgbImage& img) const;
+
+    // Row y of a Bayer frame: each sample through its CFA channel's table.
+    // `src` may equal `dst`.
+    void apply_bayer_row(const uint16_t* src, uint16_t* dst, int width, int y, BayerPattern pattern) const;
+
+    // Whole frame, rows in parallel; `dst` must have the same geometry
+    void apply_bayer(const Image& src, Image& dst) const;
+
+private:
+    int bit_depth_{0};
+    uint16_t max_value_{0};
+    // Channels back to back, plus one spare entry so a 32-bit gather of
+    // the last code stays inside the buffer
+    std::vector<uint16_t> table_;
+};
+
+} // namespace isp
+
+#endif
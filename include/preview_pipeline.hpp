@@ -0,0 +1,31 @@
+#ifndef ISP_PIPELINE_PREVIEW_PIPELINE_HPP
+#define ISP_PIPELINE_PREVIEW_PIPELINE_HPP
+
+#include "image.hpp"
+#include "planar_image.hpp"
+
+namespace isp {
+
+struct PreviewPipelineConfig {
+    uint16_t black_level = 64;   // in RAW codes
+    double gamma = 2.2;
+    bool denoise = true;
+    float sigma_spatial = 2.0f;
+    float sigma_range = 2.0f;    // in 8-bit codes (~30 at 12 bits)
+    int denoise_subsample = 2;   // guided-filter quality knob, see DenoiseParams
+};
+
+// BLC → Demosaic → AWB → Gamma → Denoise → Sharpen with 8-bit samples
+// throughout, for preview streams.
+//
+// BLC requantizes the RAW to 8 bits in the same pass, and every later stage
+// runs on a planar uint8 image: half the memory traffic of the 16-bit chain
+// and twice the SIMD lanes. Denoise uses the guided filter, whose cost does
+// not depend on the radius. The bit-depth specialization is chosen once per
+// frame from raw.bit_depth(). The output is not bit-identical to the full
+// pipeline; it matches it to within the 8-bit quantization.
+PlanarRgbImage8 run_preview_pipeline(const Image& raw, const PreviewPipelineConfig& config = {});
+
+} // namespace isp
+
+#endif
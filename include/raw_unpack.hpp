@@ -0,0 +1,36 @@
+#ifndef ISP_PIPELINE_RAW_UNPACK_HPP
+#define ISP_PIPELINE_RAW_UNPACK_HPP
+
+#include "image.hpp"
+#include "io.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace isp {
+
+// Bytes one row of `width` samples occupies in `packing`, before any
+// padding. Packed rows end on a whole group (4 samples for RAW10, 2 for
+// RAW12).
+std::size_t raw_row_bytes(int width, RawPacking packing);
+
+// Bytes a whole frame needs: (height - 1) strides plus one row
+std::size_t raw_frame_bytes(const RawFileConfig& config);
+
+// Unpack one row to one uint16_t per sample. SSE4.1/AVX2 shuffles when
+// available (see simd.hpp); `src` must hold raw_row_bytes(width, packing).
+void unpack_raw_row(const uint8_t* src, int width, RawPacking packing, bool little_endian, uint16_t* dst);
+
+// Unpack a frame held in memory (a mapped file, a network buffer) into
+// `img`, in parallel across rows. `img` is reallocated only when its format
+// differs from `config`. Returns false if `size` is less than
+// raw_frame_bytes(config). Throws std::invalid_argument if bit_depth does
+// not match a MIPI packing or row_stride is shorter than a row.
+bool unpack_raw(const uint8_t* data, std::size_t size, const RawFileConfig& config, Image& img);
+
+// "raw10", "raw12" or "raw16", as taken by the command-line tools
+bool parse_raw_packing(const std::string& name, RawPacking& packing);
+
+} // namespace isp
+
+#endif
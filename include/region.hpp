@@ -0,0 +1,58 @@
+#ifndef ISP_PIPELINE_REGION_HPP
+#define ISP_PIPELINE_REGION_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+namespace isp {
+
+// Axis-aligned rectangle in frame coordinates
+struct Rect {
+    int x{0};
+    int y{0};
+    int width{0};
+    int height{0};
+
+    int right() const { return x + width; }
+    int bottom() const { return y + height; }
+    bool empty() const { return width <= 0 || height <= 0; }
+    std::size_t area() const {
+        return empty() ? 0 : static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    }
+};
+
+// Grow a rectangle by `margin` on every side and clip it to the frame
+inline Rect expand_clamped(const Rect& r, int margin, int frame_width, int frame_height) {
+    const int x0 = std::max(0, r.x - margin);
+    const int y0 = std::max(0, r.y - margin);
+    const int x1 = std::min(frame_width, r.right() + margin);
+    const int y1 = std::min(frame_height, r.bottom() + margin);
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
+
+// Read-only window of source rows handed to the row kernels.
+// rows[k] is source row (y - radius + k), already clamped to the frame,
+// and rows[k][0] is frame column `col0`. Column taps are clamped to
+// [0, frame_width) by the kernel before subtracting col0, so the buffer
+// only has to cover the clamped columns the kernel actually touches.
+template <typename T>
+struct RowWindow {
+    const T* const* rows{nullptr};
+    int col0{0};
+    int frame_width{0};
+};
+
+// Collect pointers to rows (y - radius) .. (y + radius) of a buffer whose
+// first row is frame row `first_row`, clamping to [0, frame_height).
+template <typename T>
+void gather_rows(const T* base, std::size_t stride, int first_row, int y, int radius,
+                 int frame_height, const T** rows) {
+    for (int k = 0; k <= 2 * radius; ++k) {
+        const int sy = std::clamp(y - radius + k, 0, frame_height - 1);
+        rows[k] = base + static_cast<std::size_t>(sy - first_row) * stride;
+    }
+}
+
+} // namespace isp
+
+#endif
\ No newline at end of file
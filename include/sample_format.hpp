@@ -0,0 +1,58 @@
+#ifndef ISP_PIPELINE_SAMPLE_FORMAT_HPP
+#define ISP_PIPELINE_SAMPLE_FORMAT_HPP
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace isp {
+
+// Storage type and significant bits of one sample, fixed at compile time so
+// kernels clamp against a constant and size their tables exactly.
+template <typename T, int Bits>
+struct SampleFormat {
+    static_assert(Bits >= 8 && Bits <= static_cast<int>(8 * sizeof(T)), "bit depth does not fit the sample type");
+
+    using Sample = T;
+    static constexpr int bits = Bits;
+    static constexpr T max_value = static_cast<T>((1u << Bits) - 1u);
+};
+
+// Formats with kernel instantiations: 8-bit previews and common sensor depths
+using Format8 = SampleFormat<uint8_t, 8>;
+using Format16x8 = SampleFormat<uint16_t, 8>;
+using Format10 = SampleFormat<uint16_t, 10>;
+using Format12 = SampleFormat<uint16_t, 12>;
+using Format14 = SampleFormat<uint16_t, 14>;
+using Format16 = SampleFormat<uint16_t, 16>;
+
+// Whether `bit_depth` has an instantiation for sample type T
+template <typename T>
+constexpr bool has_sample_format(int bit_depth) {
+    if constexpr (sizeof(T) == 1) {
+        return bit_depth == 8;
+    } else {
+        return bit_depth == 8 || bit_depth == 10 || bit_depth == 12 || bit_depth == 14 || bit_depth == 16;
+    }
+}
+
+// Pick the specialization once per frame: calls fn(SampleFormat<T, bit_depth>{})
+template <typename T, typename Fn>
+decltype(auto) dispatch_sample_format(int bit_depth, Fn&& fn) {
+    if constexpr (sizeof(T) == 1) {
+        if (bit_depth == 8) return fn(Format8{});
+    } else {
+        switch (bit_depth) {
+        case 8: return fn(Format16x8{});
+        case 10: return fn(Format10{});
+        case 12: return fn(Format12{});
+        case 14: return fn(Format14{});
+        case 16: return fn(Format16{});
+        default: break;
+        }
+    }
+    throw std::invalid_argument("Unsupported bit depth");
+}
+
+} // namespace isp
+
+#endif
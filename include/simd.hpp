@@ -0,0 +1,23 @@
+#ifndef ISP_PIPELINE_SIMD_HPP
+#define ISP_PIPELINE_SIMD_HPP
+
+namespace isp {
+
+// Instruction sets the vectorized kernels can dispatch to, lowest first
+enum class SimdLevel { Scalar, SSE41, AVX2 };
+
+// Best level supported by both the build and the running CPU
+SimdLevel detect_simd_level();
+
+// Level the kernels currently use (detected once, then as overridden)
+SimdLevel active_simd_level();
+
+// Force a lower level, e.g. for benchmarks or parity checks.
+// Requests above detect_simd_level() are capped to it.
+void set_simd_level(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
+
+} // namespace isp
+
+#endif
\ No newline at end of file
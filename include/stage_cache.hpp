@@ -0,0 +1,88 @@
+#ifndef ISP_PIPELINE_STAGE_CACHE_HPP
+#define ISP_PIPELINE_STAGE_CACHE_HPP
+
+#include "image.hpp"
+#include "rgb_image.hpp"
+#include "modules/stats.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace isp {
+
+// Fold `value` into a running 64-bit hash (splitmix64 finalizer)
+inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+    uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t hash_combine(uint64_t seed, double value) {
+    return hash_combine(seed, std::bit_cast<uint64_t>(value));
+}
+
+// One cached pipeline step output: the working RAW frame after a RAW step,
+// or the RGB image after any later step, and the Bayer statistics the
+// frame carried at that point, if any
+struct CachedStage {
+    Image raw;
+    RgbImage rgb;
+    std::optional<BayerStats> stats;
+
+    std::size_t bytes() const;
+};
+
+// Step outputs of Pipeline::process_cached, keyed by frame identity and
+// the parameters of every stage up to the step, with least-recently-used
+// eviction under a byte cap. Not thread-safe; share one between pipelines
+// only when they run one at a time.
+class StageCache {
+public:
+    static constexpr std::size_t kDefaultMaxBytes = std::size_t{1} << 30;
+
+    explicit StageCache(std::size_t max_bytes = kDefaultMaxBytes) : max_bytes_(max_bytes) {}
+
+    StageCache(const StageCache&) = delete;
+    StageCache& operator=(const StageCache&) = delete;
+
+    // The entry for `key`, now the most recently used, or null
+    const CachedStage* find(uint64_t key);
+
+    // Store `entry` under `key`, replacing any entry already there and
+    // evicting the least recently used ones until it fits. An entry larger
+    // than the cap is dropped.
+    void insert(uint64_t key, CachedStage entry);
+
+    void clear();
+
+    // Lowering the cap evicts right away
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const { return max_bytes_; }
+
+    std::size_t bytes() const { return bytes_; }
+    std::size_t size() const { return entries_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    using Entries = std::list<std::pair<uint64_t, CachedStage>>;
+
+    void evict_to(std::size_t max_bytes);
+    void erase(Entries::iterator it);
+
+    Entries entries_;  // most recently used first
+    std::unordered_map<uint64_t, Entries::iterator> index_;
+    std::size_t max_bytes_;
+    std::size_t bytes_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+};
+
+} // namespace isp
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ISP_PIPELINE_TILED_PIPELINE_HPP
+#define ISP_PIPELINE_TILED_PIPELINE_HPP
+
+#include "image.hpp"
+#include "region.hpp"
+#include "rgb_image.hpp"
+#include "modules/awb.hpp"
+#include "modules/demosaic.hpp"
+
+namespace isp {
+
+struct TiledPipelineConfig {
+    uint16_t black_level = 64;
+    double gamma = 2.2;
+    DemosaicMethod demosaic = DemosaicMethod::Bilinear;
+    float sigma_spatial = 2.0f;
+    float sigma_range = 30.0f;
+    float sharpen_strength = 1.0f;
+    // Output tile edge in pixels; 0 picks the largest tile whose working
+    // set (RAW + two RGB buffers, including halo) fits in the L2 cache
+    int tile_size = 0;
+};
+
+// Fused BLC → Demosaic → AWB → Gamma → Denoise → Sharpen.
+//
+// The frame is cut into cache-sized output tiles. Each thread takes whole
+// tiles and runs the complete chain on one tile (plus the halo each
+// neighbourhood stage needs) before moving to the next, so intermediate
+// images never leave the cache. Gray World AWB needs frame-wide means, so
+// a first light pass demosaics tile by tile to collect the channel sums.
+//
+// The result is bit-identical to calling apply_blc, demosaic, apply_awb,
+// apply_gamma, apply_denoise and apply_sharpen in sequence. Unlike
+// apply_blc, the input RAW is left untouched.
+RgbImage run_tiled_pipeline(const Image& raw, const TiledPipelineConfig& config = {});
+
+// Video form: the frame is corrected with `awb`'s gains from the frames
+// before it, so the first pass is skipped, and the channel sums for the
+// next frame are taken from the demosaiced tiles of the single pass. Only
+// the first frame of a stream, with no history yet, is measured up front.
+RgbImage run_tiled_pipeline(const Image& raw, const TiledPipelineConfig& config, TemporalAwb& awb);
+
+// RAW samples the chain reads to produce `roi`: the ROI grown by each
+// stage's halo (1 for sharpen, the denoise radius ceil(2 * sigma_spatial),
+// 1 or 2 for demosaic), then out to whole Bayer quads, clipped to the frame
+Rect roi_input_region(const Rect& roi, int frame_width, int frame_height, const TiledPipelineConfig& config = {});
+
+// Just the `roi` part of run_tiled_pipeline's output, pixel-identical to
+// cropping it. Only the tiles of the ROI and their halos are processed.
+// Gray World gains still need the whole frame, so this form measures them
+// in a demosaic-only pass; pass `gains` (from an earlier frame or a
+// statistics pass) to skip it and make the cost proportional to the ROI.
+// Throws std::invalid_argument unless `roi` is non-empty and inside the frame.
+RgbImage run_roi_pipeline(const Image& raw, const Rect& roi, const TiledPipelineConfig& config = {});
+RgbImage run_roi_pipeline(const Image& raw, const Rect& roi, const TiledPipelineConfig& config,
+                          const AwbGains& gains);
+
+} // namespace isp
+
+#endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef ISP_PIPELINE_TRACE_HPP
+#define ISP_PIPELINE_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped timing spans for finding where a frame's time goes: stages, tiles,
+// row strips and file I/O, each tagged with its thread and frame number,
+// written out as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// The ISP_TRACE_* macros compile to nothing unless the library is built
+// with ISP_TRACING=1 (CMake option ISP_ENABLE_TRACING). When compiled in,
+// recording still starts only after set_enabled(true), so a canary build
+// can carry it and turn it on at runtime.
+//
+// Each thread appends to its own ring buffer, so recording takes no lock:
+// a span costs two clock reads and one 40-byte store. A ring keeps the
+// newest kEventsPerThread spans of its thread, so memory stays bounded
+// in a long-running process. Span names must outlive the trace: string
+// literals, or names passed through intern().
+//
+// Spans record the frame number set on their thread by ISP_TRACE_FRAME.
+// ExecContext workers do not see it, so a parallel loop takes it along
+// explicitly:
+//
+//   const auto frame = ISP_TRACE_CURRENT_FRAME;
+//   parallel_for(height, [&](int begin, int end) {
+//       ISP_TRACE_SCOPE_IN_FRAME("Strip", "rows", frame);
+//       ...
+//   });
+
+namespace isp::trace {
+
+constexpr std::size_t kEventsPerThread = std::size_t{1} << 16;
+
+constexpr bool compiled_in() {
+#if ISP_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void set_enabled(bool enabled);
+bool enabled();
+
+// Stable copy of `name` for spans whose name is built at runtime
+const char* intern(const std::string& name);
+
+// Frame number that spans started on this thread are tagged with
+std::uint32_t current_frame();
+
+// Sets the calling thread's frame number for its lifetime
+class FrameScope {
+public:
+    explicit FrameScope(std::uint32_t frame);
+    ~FrameScope();
+    FrameScope(const FrameScope&) = delete;
+    FrameScope& operator=(const FrameScope&) = delete;
+
+private:
+    std::uint32_t previous_;
+};
+
+// Records [construction, destruction) on the calling thread's buffer
+class Span {
+public:
+    Span(const char* name, const char* category);
+    Span(const char* name, const char* category, std::uint32_t frame);
+    ~Span();
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    std::uint32_t frame_;
+    std::uint64_t begin_ns_;
+};
+
+// Spans held by all threads' buffers
+std::size_t event_count();
+
+// Drops every recorded span
+void clear();
+
+// Writes the recorded spans as a Chrome trace JSON array. Threads that are
+// still recording may have their newest spans left out; call it between
+// frames. Returns false if the file cannot be written.
+bool write_chrome_trace(const std::string& path);
+
+} // namespace isp::trace
+
+#if ISP_TRACING
+#define ISP_TRACE_CONCAT_(a, b) a##b
+#define ISP_TRACE_CONCAT(a, b) ISP_TRACE_CONCAT_(a, b)
+#define ISP_TRACE_SCOPE(name, category) \
+    ::isp::trace::Span ISP_TRACE_CONCAT(isp_trace_span_, __LINE__)(name, category)
+#define ISP_TRACE_SCOPE_IN_FRAME(name, category, frame) \
+    ::isp::trace::Span ISP_TRACE_CONCAT(isp_trace_span_, __LINE__)(name, category, frame)
+#define ISP_TRACE_FRAME(frame) ::isp::trace::FrameScope ISP_TRACE_CONCAT(isp_trace_frame_, __LINE__)(frame)
+#define ISP_TRACE_CURRENT_FRAME ::isp::trace::current_frame()
+#else
+#define ISP_TRACE_SCOPE(name, category) ((void)0)
+#define ISP_TRACE_SCOPE_IN_FRAME(name, category, frame) ((void)(frame))
+#define ISP_TRACE_FRAME(frame) ((void)(frame))
+#define ISP_TRACE_CURRENT_FRAME std::uint32_t{0}
+#endif
+
+#endif
@@ -1,139 +1,252 @@
-// frame_receiver.cpp - Receive frames and process with ISP
-#include <iostream>
-#include <fstream>
+// frame_receiver.cpp - Receive frames and process them with the ISP in-process
+//
+// Three threads connected by bounded queues:
+//   receive: recv() each frame straight into a pooled RAW Image (packed
+//            RAW10/RAW12 into the slot's byte buffer, then unpack_raw)
+//   ISP:     run the pipeline into the same slot's RGB image, its last
+//            stage also writing the 8-bit output into the byte buffer
+//   encode:  write output_NNN.png (or .ppm) and return the slot to the pool
+// so frame N+1 is received while frame N is processed and N-1 is encoded.
+#include "bounded_queue.hpp"
+#include "frame_pool.hpp"
+#include "io.hpp"
+#include "pipeline.hpp"
+#include "raw_unpack.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <bit>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
-#include <unistd.h>
-#include <sys/socket.h>
+#include <filesystem>
+#include <iostream>
 #include <netinet/in.h>
-#include <arpa/inet.h>
-#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #define SERVER_IP "192.168.64.2"
 #define PORT 8080
-#define FRAME_SIZE 614400
 
-int main() {
-    int sockfd;
-    struct sockaddr_in server_addr;
-    char *buffer;
-    ssize_t bytes_received, total_received;
-    
-    // Allocate buffer
-    buffer = new char[FRAME_SIZE];
-    if (!buffer) {
-        std::cerr << "Failed to allocate buffer" << std::endl;
-        return 1;
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Job {
+    int number;
+    isp::FrameBuffers* buffers;
+    Clock::time_point received;
+};
+
+// Fill `size` bytes from the socket. Returns false on error or when the
+// server closes the connection.
+bool recv_all(int sockfd, char* dst, std::size_t size) {
+    std::size_t total = 0;
+    while (total < size) {
+        ssize_t n = recv(sockfd, dst + total, size - total, 0);
+        if (n < 0) {
+            perror("Receive failed");
+            return false;
+        }
+        if (n == 0) {
+            if (total > 0) std::cerr << "Server closed connection mid-frame\n";
+            return false;
+        }
+        total += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const std::size_t index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+    return values[index];
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string server_ip = SERVER_IP;
+    int port = PORT;
+    std::string output_dir = ".";
+    bool save = true;
+    isp::PipelineConfig pipeline_config;
+    isp::OutputFormat output_format = isp::OutputFormat::Png;
+    isp::RawFileConfig wire{640, 480};
+    std::string trace_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) server_ip = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) port = std::stoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) output_dir = argv[++i];
+        else if (arg == "--width" && i + 1 < argc) wire.width = std::stoi(argv[++i]);
+        else if (arg == "--height" && i + 1 < argc) wire.height = std::stoi(argv[++i]);
+        else if (arg == "--bit-depth" && i + 1 < argc) wire.bit_depth = std::stoi(argv[++i]);
+        else if (arg == "--packing" && i + 1 < argc && isp::parse_raw_packing(argv[i + 1], wire.packing)) ++i;
+        else if (arg == "--pattern" && i + 1 < argc && isp::parse_bayer_pattern(argv[i + 1], wire.pattern)) ++i;
+        else if (arg == "--format" && i + 1 < argc && isp::parse_output_format(argv[i + 1], output_format)) ++i;
+        else if (arg == "--no-save") save = false;
+        else if (arg == "--video") pipeline_config.video = true;
+        else if (arg == "--trace" && i + 1 < argc) trace_path = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--host IP] [--port N] [--out DIR] [--format png|ppm|ppm8] [--no-save]"
+                      << " [--width W] [--height H] [--bit-depth B] [--packing raw10|raw12|raw16]"
+                      << " [--pattern rggb|bggr|grbg|gbrg] [--video] [--trace FILE]\n";
+            return 1;
+        }
+    }
+    if (wire.packing == isp::RawPacking::Mipi10) wire.bit_depth = 10;
+    if (wire.packing == isp::RawPacking::Mipi12) wire.bit_depth = 12;
+    if (!trace_path.empty()) {
+        if (!isp::trace::compiled_in()) {
+            std::cerr << "Built without ISP_ENABLE_TRACING; the trace will be empty\n";
+        }
+        isp::trace::set_enabled(true);
     }
-    
+
+    // Unpacked frames arrive as little-endian 16-bit samples and can land
+    // in the Image directly; packed ones go through the byte buffer
+    const isp::FrameFormat format{wire.width, wire.height, wire.bit_depth, wire.pattern};
+    const std::size_t frame_bytes = isp::raw_frame_bytes(wire);
+    const bool direct = wire.packing == isp::RawPacking::Unpacked16;
+
     // 1. Create socket
     std::cout << "Creating socket..." << std::endl;
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0) {
         perror("Socket creation failed");
-        delete[] buffer;
         return 1;
     }
     std::cout << "✓ Socket created" << std::endl;
-    
+
     // 2. Configure server address
+    struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(PORT);
-    
-    if (inet_pton(AF_INET, SERVER_IP, &server_addr.sin_addr) <= 0) {
+    server_addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (inet_pton(AF_INET, server_ip.c_str(), &server_addr.sin_addr) <= 0) {
         perror("Invalid address");
         close(sockfd);
-        delete[] buffer;
         return 1;
     }
-    
+
     // 3. Connect to server
-    std::cout << "Connecting to " << SERVER_IP << ":" << PORT << "..." << std::endl;
-    if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+    std::cout << "Connecting to " << server_ip << ":" << port << "..." << std::endl;
+    if (connect(sockfd, reinterpret_cast<struct sockaddr*>(&server_addr), sizeof(server_addr)) < 0) {
         perror("Connection failed");
         close(sockfd);
-        delete[] buffer;
         return 1;
     }
     std::cout << "✓ Connected!" << std::endl;
-    
-    // 4. Main loop: receive frames and process
-    std::cout << "\n=== Receiving and processing frames ===" << std::endl;
-    int frame_count = 0;
-    
-    while (true) {
-        // Receive one complete frame
-        total_received = 0;
-        while (total_received < FRAME_SIZE) {
-            bytes_received = recv(sockfd, buffer + total_received, 
-                                 FRAME_SIZE - total_received, 0);
-            
-            if (bytes_received < 0) {
-                perror("Receive failed");
-                goto cleanup;
+
+    if (save) std::filesystem::create_directories(output_dir);
+
+    // One slot each being received, processed and encoded, plus one queued
+    isp::FramePool pool(format, 4);
+    isp::BoundedQueue<Job> to_process(1);
+    isp::BoundedQueue<Job> to_encode(1);
+
+    std::vector<double> isp_ms;
+    std::vector<double> latency_ms;
+
+    std::thread isp_thread([&] {
+        isp::Pipeline pipeline = isp::make_default_pipeline(pipeline_config);
+        pipeline.plan(format);
+        while (std::optional<Job> job = to_process.pop()) {
+            ISP_TRACE_FRAME(static_cast<uint32_t>(job->number));
+            auto start = Clock::now();
+            // The packed input in `bytes` has been unpacked, so it can take the 8-bit output
+            isp::FrameBuffers& buffers = *job->buffers;
+            if (save && output_format != isp::OutputFormat::Ppm) {
+                pipeline.process(buffers.raw, buffers.rgb, buffers.bytes);
+            } else {
+                pipeline.process(buffers.raw, buffers.rgb);
             }
-            
-            if (bytes_received == 0) {
-                std::cout << "\nServer closed connection" << std::endl;
-                goto cleanup;
+            isp_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            to_encode.push(*job);
+        }
+        to_encode.close();
+    });
+
+    std::thread encode_thread([&] {
+        while (std::optional<Job> job = to_encode.pop()) {
+            ISP_TRACE_FRAME(static_cast<uint32_t>(job->number));
+            if (save) {
+                char output_filename[64];
+                snprintf(output_filename, sizeof(output_filename), "output_%03d%s", job->number,
+                         isp::output_extension(output_format));
+                const std::string path = (std::filesystem::path(output_dir) / output_filename).string();
+                const isp::RgbImage& rgb = job->buffers->rgb;
+                const uint8_t* rgb8 = job->buffers->bytes.data();
+                bool saved = false;
+                switch (output_format) {
+                case isp::OutputFormat::Png:  saved = isp::save_png(path, rgb8, rgb.width(), rgb.height()); break;
+                case isp::OutputFormat::Ppm8: saved = isp::save_ppm(path, rgb8, rgb.width(), rgb.height()); break;
+                case isp::OutputFormat::Ppm:  saved = isp::save_ppm(path, rgb, job->buffers->bytes); break;
+                }
+                if (!saved) {
+                    std::cerr << "[" << job->number << "] ✗ Failed to save " << path << std::endl;
+                }
             }
-            
-            total_received += bytes_received;
+            latency_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - job->received).count());
+            pool.release(*job->buffers);
         }
-        
-        frame_count++;
-        std::cout << "\n[" << frame_count << "] Received " << total_received 
-                  << " bytes" << std::endl;
-        
-        // Save RAW file temporarily
-        char raw_filename[64];
-        snprintf(raw_filename, sizeof(raw_filename), "frame_%03d.raw", frame_count);
-        
-        std::ofstream raw_file(raw_filename, std::ios::binary);
-        if (!raw_file) {
-            std::cerr << "Failed to save RAW file" << std::endl;
-            continue;
+    });
+
+    // 4. Main loop: receive frames into pooled buffers
+    std::cout << "\n=== Receiving and processing frames ===" << std::endl;
+    int frame_count = 0;
+    Clock::time_point first_frame;
+
+    while (true) {
+        ISP_TRACE_FRAME(static_cast<uint32_t>(frame_count + 1));
+        ISP_TRACE_SCOPE("Receive", "io");
+        isp::FrameBuffers& buffers = pool.acquire();
+        std::vector<uint16_t>& samples = buffers.raw.data();
+        if (!direct) buffers.bytes.resize(frame_bytes);
+        char* dst = direct ? reinterpret_cast<char*>(samples.data()) : reinterpret_cast<char*>(buffers.bytes.data());
+        if (!recv_all(sockfd, dst, frame_bytes)) {
+            pool.release(buffers);
+            break;
         }
-        raw_file.write(buffer, FRAME_SIZE);
-        raw_file.close();
-        std::cout << "[" << frame_count << "] Saved RAW: " << raw_filename << std::endl;
-        
-        // Process with ISP Pipeline
-        // Must run from ISP_Pipeline directory for relative paths to work
-        char command[512];
-        char output_filename[64];
-        snprintf(output_filename, sizeof(output_filename), "output_%03d.png", frame_count);
-        
-        // Change to ISP_Pipeline directory and run isp_main
-        const char* home = getenv("HOME");
-        snprintf(command, sizeof(command), 
-                "cd %s/Project/ISP_Pipeline && ./build/isp_main network/%s > /dev/null 2>&1", 
-                home, raw_filename);
-        
-        std::cout << "[" << frame_count << "] Processing with ISP..." << std::endl;
-        int ret = system(command);
-        
-        if (ret == 0) {
-            // Move output.png from data/ to network/ with new name
-            snprintf(command, sizeof(command), 
-                    "mv %s/Project/ISP_Pipeline/data/output.png %s/Project/ISP_Pipeline/network/%s", 
-                    home, home, output_filename);
-            system(command);
-            std::cout << "[" << frame_count << "] ✓ Saved PNG: " << output_filename << std::endl;
-            
-            // Optional: keep or delete RAW
-            // remove(raw_filename);
-        } else {
-            std::cerr << "[" << frame_count << "] ✗ ISP processing failed" << std::endl;
+        if (!direct) {
+            isp::unpack_raw(buffers.bytes.data(), frame_bytes, wire, buffers.raw);
+        } else if constexpr (std::endian::native == std::endian::big) {
+            for (uint16_t& s : samples) s = static_cast<uint16_t>(s << 8 | s >> 8);
         }
+
+        const Clock::time_point received = Clock::now();
+        if (frame_count == 0) first_frame = received;
+        ++frame_count;
+        to_process.push(Job{frame_count, &buffers, received});
     }
-    
-cleanup:
+    std::cout << "\nServer closed connection" << std::endl;
+
+    to_process.close();
+    isp_thread.join();
+    encode_thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - first_frame).count();
+
     // 5. Cleanup
     std::cout << "\n=== Completed ===" << std::endl;
     std::cout << "✓ Processed " << frame_count << " frames" << std::endl;
+    if (frame_count > 1 && seconds > 0) {
+        std::cout << "Throughput: " << frame_count / seconds << " fps, "
+                  << static_cast<double>(frame_bytes) * frame_count / seconds / 1e6 << " MB/s received\n";
+        std::cout << "ISP:        " << percentile(isp_ms, 0.5) << " ms median\n";
+        std::cout << "Latency:    " << percentile(latency_ms, 0.5) << " ms median, "
+                  << percentile(latency_ms, 0.99) << " ms p99 (received -> encoded)\n";
+    }
     close(sockfd);
-    delete[] buffer;
-    
+
+    if (!trace_path.empty() && isp::trace::write_chrome_trace(trace_path)) {
+        std::cout << "Trace:      " << trace_path << " (" << isp::trace::event_count() << " spans)\n";
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,133 @@
+// loopback_server.cpp - Stand-in for the camera driver's TCP server
+//
+// Replays a file as back-to-back frames on 127.0.0.1 so frame_receiver's
+// throughput can be measured without the VM. Frame i is the next frame's
+// worth of bytes of the file (width*height*2, or less for --packing
+// raw10/raw12), wrapping around at its end.
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define PORT 8080
+
+namespace {
+
+bool send_all(int fd, const char* src, std::size_t size) {
+    std::size_t total = 0;
+    while (total < size) {
+        ssize_t n = send(fd, src + total, size - total, 0);
+        if (n < 0) {
+            perror("Send failed");
+            return false;
+        }
+        total += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = "data/test_input.raw";
+    int port = PORT;
+    int frames = 100;
+    double fps = 0.0;  // 0 = as fast as the receiver takes them
+    int width = 640;
+    int height = 480;
+    std::string packing = "raw16";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) port = std::stoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) frames = std::stoi(argv[++i]);
+        else if (arg == "--fps" && i + 1 < argc) fps = std::stod(argv[++i]);
+        else if (arg == "--width" && i + 1 < argc) width = std::stoi(argv[++i]);
+        else if (arg == "--height" && i + 1 < argc) height = std::stoi(argv[++i]);
+        else if (arg == "--packing" && i + 1 < argc) packing = argv[++i];
+        else if (!arg.empty() && arg[0] != '-') path = arg;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--port N] [--frames N] [--fps F]"
+                      << " [--width W] [--height H] [--packing raw10|raw12|raw16] [file]\n";
+            return 1;
+        }
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (source.empty()) {
+        std::cerr << "Failed to read " << path << '\n';
+        return 1;
+    }
+
+    const std::size_t w = static_cast<std::size_t>(width);
+    const std::size_t row_bytes = packing == "raw10" ? (w + 3) / 4 * 5
+                                : packing == "raw12" ? (w + 1) / 2 * 3
+                                : w * 2;
+    const std::size_t frame_bytes = row_bytes * static_cast<std::size_t>(height);
+    std::vector<char> frame(frame_bytes);
+
+    // A receiver that hangs up should end the run, not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("Socket creation failed");
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, 1) < 0) {
+        perror("Bind/listen failed");
+        close(listen_fd);
+        return 1;
+    }
+
+    std::cout << "Serving " << frames << " frames of " << width << "x" << height
+              << " from " << path << " on 127.0.0.1:" << port << std::endl;
+    int client = accept(listen_fd, nullptr, nullptr);
+    if (client < 0) {
+        perror("Accept failed");
+        close(listen_fd);
+        return 1;
+    }
+    std::cout << "✓ Client connected" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    std::size_t offset = 0;
+    int sent = 0;
+    for (; sent < frames; ++sent) {
+        if (fps > 0) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(sent / fps)));
+        }
+        for (std::size_t i = 0; i < frame_bytes; ++i) {
+            frame[i] = source[offset];
+            offset = offset + 1 == source.size() ? 0 : offset + 1;
+        }
+        if (!send_all(client, frame.data(), frame.size())) break;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "✓ Sent " << sent << " frames in " << seconds << " s" << std::endl;
+    close(client);
+    close(listen_fd);
+    return 0;
+}
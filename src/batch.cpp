@@ -0,0 +1,245 @@
+#include "../vendor/stb_image.h"
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "exec_context.hpp"
+#include "frame_pool.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace isp {
+
+namespace {
+
+// Below this a frame's parallel regions are too short to keep every core
+// busy, so whole frames are spread across cores instead
+constexpr long long kFrameParallelMaxPixels = 4'000'000;
+
+bool is_png(const std::filesystem::path& path) {
+    return path.extension() == ".png";
+}
+
+// Pixels per frame, from the RAW geometry or the first PNG's header
+long long frame_pixels(const BatchConfig& config) {
+    for (const std::string& input : config.inputs) {
+        if (!is_png(input)) continue;
+        int w = 0, h = 0, channels = 0;
+        if (stbi_info(input.c_str(), &w, &h, &channels)) {
+            return static_cast<long long>(w) * h;
+        }
+    }
+    return static_cast<long long>(config.raw.width) * config.raw.height;
+}
+
+// <output_dir>/<stem><ext> per input. Inputs that share a stem (a.raw and
+// a.png, or files from different directories in a list) would overwrite
+// each other, so each of those gets its input index appended: a_0, a_3.
+std::vector<std::string> output_paths(const BatchConfig& config) {
+    namespace fs = std::filesystem;
+    std::map<std::string, int> uses;
+    for (const std::string& input : config.inputs) ++uses[fs::path(input).stem().string()];
+
+    std::vector<std::string> paths;
+    paths.reserve(config.inputs.size());
+    for (std::size_t i = 0; i < config.inputs.size(); ++i) {
+        std::string name = fs::path(config.inputs[i]).stem().string();
+        if (uses[name] > 1) {
+            name += '_';
+            name += std::to_string(i);
+        }
+        paths.push_back((fs::path(config.output_dir) / name).string() + output_extension(config.output_format));
+    }
+    return paths;
+}
+
+struct Job {
+    std::size_t index;
+    FrameBuffers* buffers;
+};
+
+} // anonymous namespace
+
+std::vector<std::string> list_batch_inputs(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> inputs;
+
+    if (fs::is_directory(path)) {
+        for (const auto& entry : fs::directory_iterator(path)) {
+            if (entry.is_regular_file()) inputs.push_back(entry.path().string());
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream list(path);
+    if (!list) {
+        throw std::runtime_error("Cannot open batch input: " + path);
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        const auto last = line.find_last_not_of(" \t\r");
+        inputs.push_back(line.substr(first, last - first + 1));
+    }
+    return inputs;
+}
+
+BatchStats run_batch(const BatchConfig& config) {
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    BatchStats stats;
+    if (config.inputs.empty()) return stats;
+
+    fs::create_directories(config.output_dir);
+    const std::vector<std::string> outputs = output_paths(config);
+
+    const int cores = config.threads > 0 ? config.threads : ExecContext::default_threads();
+    const int inputs = static_cast<int>(config.inputs.size());
+    int jobs = config.jobs;
+    if (jobs <= 0) {
+        jobs = frame_pixels(config) <= kFrameParallelMaxPixels ? std::min(cores, inputs) : 1;
+    }
+    jobs = std::clamp(jobs, 1, inputs);
+    const int threads_per_job = std::max(1, cores / jobs);
+    stats.jobs = jobs;
+    stats.threads_per_job = threads_per_job;
+
+    // One set of buffers per worker and writer plus one being read, so no
+    // step waits for memory while the others have work
+    const FrameFormat format{config.raw.width, config.raw.height, config.raw.bit_depth, config.raw.pattern};
+    FramePool pool(format, static_cast<std::size_t>(2 * jobs + 1));
+    BoundedQueue<Job> to_process(static_cast<std::size_t>(jobs));
+    BoundedQueue<Job> to_write(static_cast<std::size_t>(jobs));
+
+    std::mutex stats_mutex;
+    auto report_failure = [&](std::size_t index, const std::string& what) {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        std::cerr << "Failed: " << config.inputs[index] << ": " << what << '\n';
+        ++stats.failed;
+    };
+
+    // Built here rather than in the workers, so a rejected config throws to
+    // the caller before any thread starts. Each worker's pipeline runs its
+    // stages on its own share of the cores.
+    std::vector<Pipeline> pipelines;
+    pipelines.reserve(static_cast<std::size_t>(jobs));
+    PipelineConfig pipeline_config = config.pipeline;
+    pipeline_config.threads = threads_per_job;
+    for (int j = 0; j < jobs; ++j) pipelines.push_back(make_default_pipeline(pipeline_config));
+
+    const auto start = Clock::now();
+
+    std::thread reader([&] {
+        for (std::size_t i = 0; i < config.inputs.size(); ++i) {
+            ISP_TRACE_FRAME(static_cast<uint32_t>(i));
+            FrameBuffers& buffers = pool.acquire();
+            bool loaded = false;
+            std::string error = "could not read input";
+            try {
+                if (is_png(config.inputs[i])) {
+                    std::optional<Image> raw = load_png_as_raw(config.inputs[i], config.raw.pattern);
+                    if (raw) {
+                        buffers.raw = std::move(*raw);
+                        loaded = true;
+                    }
+                } else {
+                    loaded = load_raw(config.inputs[i], config.raw, buffers.raw);
+                }
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            if (!loaded) {
+                report_failure(i, error);
+                pool.release(buffers);
+                continue;
+            }
+            to_process.push(Job{i, &buffers});
+        }
+        to_process.close();
+    });
+
+    std::atomic<int> workers_left{jobs};
+    std::vector<std::thread> workers;
+    for (int j = 0; j < jobs; ++j) {
+        workers.emplace_back([&, j] {
+            Pipeline& pipeline = pipelines[static_cast<std::size_t>(j)];
+            while (std::optional<Job> job = to_process.pop()) {
+                ISP_TRACE_FRAME(static_cast<uint32_t>(job->index));
+                const Image& raw = job->buffers->raw;
+                try {
+                    const FrameFormat frame_format{raw.width(), raw.height(), raw.bit_depth(), raw.pattern()};
+                    if (!pipeline.planned() || !(pipeline.format() == frame_format)) {
+                        pipeline.plan(frame_format);
+                    }
+                    if (config.output_format == OutputFormat::Ppm) {
+                        pipeline.process(raw, job->buffers->rgb);
+                    } else {
+                        pipeline.process(raw, job->buffers->rgb, job->buffers->bytes);
+                    }
+                } catch (const std::exception& e) {
+                    report_failure(job->index, e.what());
+                    pool.release(*job->buffers);
+                    continue;
+                }
+                to_write.push(*job);
+            }
+            if (--workers_left == 0) to_write.close();
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int j = 0; j < jobs; ++j) {
+        writers.emplace_back([&] {
+            // PNG strips are deflated in parallel; stay within this writer's share
+            ExecContext context(threads_per_job);
+            ExecScope scope(context);
+            while (std::optional<Job> job = to_write.pop()) {
+                ISP_TRACE_FRAME(static_cast<uint32_t>(job->index));
+                const std::string& path = outputs[job->index];
+                const RgbImage& rgb = job->buffers->rgb;
+                const uint8_t* rgb8 = job->buffers->bytes.data();
+                bool saved = false;
+                switch (config.output_format) {
+                case OutputFormat::Png:
+                    saved = save_png(path, rgb8, rgb.width(), rgb.height());
+                    break;
+                case OutputFormat::Ppm8:
+                    saved = save_ppm(path, rgb8, rgb.width(), rgb.height());
+                    break;
+                case OutputFormat::Ppm:
+                    saved = save_ppm(path, rgb, job->buffers->bytes);
+                    break;
+                }
+                if (saved) {
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    ++stats.frames;
+                    // Input pixels: with binning the output is smaller
+                    const Image& raw = job->buffers->raw;
+                    stats.megapixels += static_cast<double>(raw.width()) * raw.height() / 1e6;
+                } else {
+                    report_failure(job->index, "could not write output");
+                }
+                pool.release(*job->buffers);
+            }
+        });
+    }
+
+    reader.join();
+    for (std::thread& worker : workers) worker.join();
+    for (std::thread& writer : writers) writer.join();
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return stats;
+}
+
+} // namespace isp
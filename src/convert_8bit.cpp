@@ -0,0 +1,116 @@
+#include "convert_8bit.hpp"
+#include "convert_8bit_simd.hpp"
+#include "simd.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace isp {
+
+namespace {
+
+uint8_t divide(uint32_t v, uint32_t max_value) {
+    return static_cast<uint8_t>(std::min(v, max_value) * 255 / max_value);
+}
+
+} // anonymous namespace
+
+To8Bit::To8Bit(int bit_depth) : bit_depth_(bit_depth) {
+    if (bit_depth < 1 || bit_depth > 16) {
+        throw std::invalid_argument("Bit depth must be between 1 and 16");
+    }
+    const uint32_t max_value = (1u << bit_depth) - 1u;
+    max_value_ = static_cast<uint16_t>(max_value);
+
+    // Smallest constant for each shift pair that cannot round low; keep the
+    // first that is exact for every code. 10- and 12-bit find one, 14- and
+    // 16-bit need more than 16 bits of precision and use the table.
+    for (int pre = 0; pre <= 16 - bit_depth; ++pre) {
+        for (int post = 0; post < 16; ++post) {
+            const uint64_t numerator = uint64_t{255} << (16 + post);
+            const uint64_t denominator = uint64_t{max_value} << pre;
+            const uint64_t multiplier = (numerator + denominator - 1) / denominator;
+            if (multiplier > 0xFFFF) break;
+
+            bool exact = true;
+            for (uint32_t v = 0; v <= max_value && exact; ++v) {
+                const uint32_t y = static_cast<uint32_t>(((uint64_t{v} << pre) * multiplier) >> (16 + post));
+                exact = y == divide(v, max_value);
+            }
+            if (exact) {
+                pre_shift_ = pre;
+                multiplier_ = static_cast<uint16_t>(multiplier);
+                post_shift_ = post;
+                return;
+            }
+        }
+    }
+
+    lut_.resize(std::size_t{max_value} + 1);
+    for (uint32_t v = 0; v <= max_value; ++v) {
+        lut_[v] = divide(v, max_value);
+    }
+}
+
+void To8Bit::convert(const uint16_t* src, std::size_t count, uint8_t* dst) const {
+    if (multiplier_ == 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[i] = lut_[std::min(src[i], max_value_)];
+        }
+        return;
+    }
+
+    std::size_t done = 0;
+#if defined(ISP_HAVE_AVX2) || defined(ISP_HAVE_SSE41)
+    const detail::To8BitParams params{max_value_, pre_shift_, multiplier_, post_shift_};
+    const SimdLevel level = active_simd_level();
+#endif
+#if defined(ISP_HAVE_AVX2)
+    if (level == SimdLevel::AVX2) done = detail::convert_8bit_avx2(src, count, dst, params);
+#endif
+#if defined(ISP_HAVE_SSE41)
+    if (level == SimdLevel::SSE41) done = detail::convert_8bit_sse41(src, count, dst, params);
+#endif
+    for (std::size_t i = done; i < count; ++i) {
+        const uint32_t v = static_cast<uint32_t>(std::min(src[i], max_value_)) << pre_shift_;
+        dst[i] = static_cast<uint8_t>((v * multiplier_) >> (16 + post_shift_));
+    }
+}
+
+void To8Bit::convert(const Pixel* src, std::size_t count, uint8_t* dst) const {
+    static_assert(sizeof(Pixel) == 3 * sizeof(uint16_t), "Pixel must be three packed samples");
+    convert(reinterpret_cast<const uint16_t*>(src), 3 * count, dst);
+}
+
+const To8Bit& cached_to_8bit(int bit_depth) {
+    static std::mutex mutex;
+    static std::map<int, To8Bit> converters;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = converters.find(bit_depth);
+    if (it == converters.end()) {
+        it = converters.emplace(bit_depth, To8Bit(bit_depth)).first;
+    }
+    return it->second;
+}
+
+void convert_to_8bit(const RgbImage& img, std::vector<uint8_t>& dst) {
+    dst.resize(img.size() * 3);
+    convert_to_8bit(img, dst.data());
+}
+
+void convert_to_8bit(const RgbImage& img, uint8_t* out) {
+    const To8Bit& to_8bit = cached_to_8bit(img.bit_depth());
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    const Pixel* src = img.data().data();
+    parallel_for(img.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const std::size_t row = static_cast<std::size_t>(y) * w;
+            to_8bit.convert(src + row, w, out + 3 * row);
+        }
+    });
+}
+
+} // namespace isp
@@ -0,0 +1,34 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "convert_8bit_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256i;
+    using C = __m128i;
+    static constexpr std::size_t kLanes = 16;
+
+    static V load(const uint16_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static V set1(int x) { return _mm256_set1_epi16(static_cast<short>(x)); }
+    static C count(int n) { return _mm_cvtsi32_si128(n); }
+    static V min(V a, V b) { return _mm256_min_epu16(a, b); }
+    static V sll(V a, C c) { return _mm256_sll_epi16(a, c); }
+    static V srl(V a, C c) { return _mm256_srl_epi16(a, c); }
+    static V mulhi(V a, V b) { return _mm256_mulhi_epu16(a, b); }
+    // vpackuswb interleaves 128-bit lanes; the permute restores sample order
+    static void store_packed(uint8_t* p, V a, V b) {
+        const V packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), packed);
+    }
+};
+
+} // anonymous namespace
+
+std::size_t convert_8bit_avx2(const uint16_t* src, std::size_t count, uint8_t* dst, const To8BitParams& params) {
+    return convert_8bit<Avx2Ops>(src, count, dst, params);
+}
+
+} // namespace isp::detail
@@ -0,0 +1,55 @@
+#ifndef ISP_PIPELINE_CONVERT_8BIT_SIMD_HPP
+#define ISP_PIPELINE_CONVERT_8BIT_SIMD_HPP
+
+// Vectorized 16-to-8-bit conversion, shared by the SSE4.1 and AVX2 builds.
+// Each sample is clamped, scaled with an unsigned multiply-high and packed
+// to bytes with saturation. Each translation unit supplies an Ops struct
+// for its instruction set and instantiates the kernel under the matching
+// compiler flags.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace isp::detail {
+
+struct To8BitParams {
+    uint16_t max_value;
+    int pre_shift;
+    uint16_t multiplier;
+    int post_shift;
+};
+
+// Convert the largest prefix of `count` that fills whole vectors; returns
+// the number of samples done
+std::size_t convert_8bit_sse41(const uint16_t* src, std::size_t count, uint8_t* dst, const To8BitParams& params);
+std::size_t convert_8bit_avx2(const uint16_t* src, std::size_t count, uint8_t* dst, const To8BitParams& params);
+
+// Ops must provide:
+//   V, C (shift count), kLanes, load(p), set1(x), count(n), min(a, b),
+//   sll(a, c), srl(a, c), mulhi(a, b), store_packed(p, a, b) -> 2 * kLanes
+//   bytes, a's samples first
+template <typename Ops>
+std::size_t convert_8bit(const uint16_t* src, std::size_t count, uint8_t* dst, const To8BitParams& params) {
+    using V = typename Ops::V;
+    constexpr std::size_t step = 2 * Ops::kLanes;
+    const V max_value = Ops::set1(params.max_value);
+    const V multiplier = Ops::set1(params.multiplier);
+    const auto pre = Ops::count(params.pre_shift);
+    const auto post = Ops::count(params.post_shift);
+
+    auto scale = [&](V v) {
+        return Ops::srl(Ops::mulhi(Ops::sll(Ops::min(v, max_value), pre), multiplier), post);
+    };
+
+    std::size_t i = 0;
+    for (; i + step <= count; i += step) {
+        const V a = scale(Ops::load(src + i));
+        const V b = scale(Ops::load(src + i + Ops::kLanes));
+        Ops::store_packed(dst + i, a, b);
+    }
+    return i;
+}
+
+} // namespace isp::detail
+
+#endif
@@ -0,0 +1,32 @@
+// Built with -msse4.1; only called when the CPU reports SSE4.1 support
+#include "convert_8bit_simd.hpp"
+#include <smmintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Sse41Ops {
+    using V = __m128i;
+    using C = __m128i;
+    static constexpr std::size_t kLanes = 8;
+
+    static V load(const uint16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static V set1(int x) { return _mm_set1_epi16(static_cast<short>(x)); }
+    static C count(int n) { return _mm_cvtsi32_si128(n); }
+    static V min(V a, V b) { return _mm_min_epu16(a, b); }
+    static V sll(V a, C c) { return _mm_sll_epi16(a, c); }
+    static V srl(V a, C c) { return _mm_srl_epi16(a, c); }
+    static V mulhi(V a, V b) { return _mm_mulhi_epu16(a, b); }
+    static void store_packed(uint8_t* p, V a, V b) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(a, b));
+    }
+};
+
+} // anonymous namespace
+
+std::size_t convert_8bit_sse41(const uint16_t* src, std::size_t count, uint8_t* dst, const To8BitParams& params) {
+    return convert_8bit<Sse41Ops>(src, count, dst, params);
+}
+
+} // namespace isp::detail
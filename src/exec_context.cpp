@@ -0,0 +1,204 @@
+#include "exec_context.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace isp {
+
+namespace {
+
+thread_local ExecContext* tl_current = nullptr;
+thread_local bool tl_in_task = false;
+
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+// Marks this thread as running a task, so loops started from it run inline
+struct InTask {
+    bool previous = tl_in_task;
+    InTask() { tl_in_task = true; }
+    ~InTask() { tl_in_task = previous; }
+};
+
+} // anonymous namespace
+
+int ExecContext::default_threads() {
+    if (const char* env = std::getenv("ISP_NUM_THREADS")) {
+        const int n = std::atoi(env);
+        if (n > 0) return n;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+ExecContext::ExecContext(int threads)
+    : threads_(threads > 0 ? threads : default_threads()), blocks_(new Block[static_cast<std::size_t>(threads_)]) {
+    workers_.reserve(static_cast<std::size_t>(threads_ - 1));
+    for (int w = 1; w < threads_; ++w) {
+        workers_.emplace_back([this, w] { worker_main(w); });
+    }
+}
+
+ExecContext::~ExecContext() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+}
+
+ExecContext& ExecContext::current() {
+    return tl_current ? *tl_current : shared();
+}
+
+ExecContext& ExecContext::shared() {
+    static ExecContext context;
+    return context;
+}
+
+void ExecContext::run_tasks(int count, int grain, bool steal, TaskFn fn, void* state) {
+    if (count <= 0) return;
+    grain = std::max(1, grain);
+    const int tasks = (count - 1) / grain + 1;
+
+    if (threads_ == 1 || tasks == 1 || tl_in_task) {
+        InTask in_task;
+        for (int t = 0; t < tasks; ++t) {
+            fn(state, t * grain, std::min(count, (t + 1) * grain), 0);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> serial(run_mutex_);
+    fn_ = fn;
+    state_ = state;
+    count_ = count;
+    grain_ = grain;
+    steal_ = steal;
+    error_ = nullptr;
+    for (int w = 0; w < threads_; ++w) {
+        const auto begin = static_cast<uint32_t>(static_cast<int64_t>(tasks) * w / threads_);
+        const auto end = static_cast<uint32_t>(static_cast<int64_t>(tasks) * (w + 1) / threads_);
+        blocks_[static_cast<std::size_t>(w)].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = threads_ - 1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) std::rethrow_exception(error_);
+}
+
+void ExecContext::work(int worker) {
+    InTask in_task;
+    auto call = [&](int task) {
+        const int begin = task * grain_;
+        try {
+            fn_(state_, begin, std::min(count_, begin + grain_), worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+    };
+    int task = 0;
+    while (take_own(worker, task)) call(task);
+    if (!steal_) return;
+    for (int k = 1; k < threads_; ++k) {
+        const int victim = (worker + k) % threads_;
+        while (steal_from(victim, task)) call(task);
+    }
+}
+
+void ExecContext::worker_main(int worker) {
+    tl_current = this;
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        work(worker);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) done_.notify_one();
+    }
+}
+
+bool ExecContext::take_own(int worker, int& task) {
+    std::atomic<uint64_t>& range = blocks_[static_cast<std::size_t>(worker)].range;
+    uint64_t r = range.load(std::memory_order_acquire);
+    for (;;) {
+        const auto begin = static_cast<uint32_t>(r >> 32);
+        const auto end = static_cast<uint32_t>(r);
+        if (begin >= end) return false;
+        if (range.compare_exchange_weak(r, pack(begin + 1, end), std::memory_order_acq_rel)) {
+            task = static_cast<int>(begin);
+            return true;
+        }
+    }
+}
+
+bool ExecContext::steal_from(int victim, int& task) {
+    std::atomic<uint64_t>& range = blocks_[static_cast<std::size_t>(victim)].range;
+    uint64_t r = range.load(std::memory_order_acquire);
+    for (;;) {
+        const auto begin = static_cast<uint32_t>(r >> 32);
+        const auto end = static_cast<uint32_t>(r);
+        if (begin >= end) return false;
+        if (range.compare_exchange_weak(r, pack(begin, end - 1), std::memory_order_acq_rel)) {
+            task = static_cast<int>(end - 1);
+            return true;
+        }
+    }
+}
+
+void ExecContext::first_touch(void* data, std::size_t bytes) {
+    if (!data || bytes == 0) return;
+    auto* base = static_cast<unsigned char*>(data);
+#if defined(__linux__)
+    // Whole pages inside the buffer go back to the kernel, and the next
+    // write places each on the writer's node
+    const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = (reinterpret_cast<uintptr_t>(base) + page - 1) & ~(page - 1);
+    const uintptr_t last = (reinterpret_cast<uintptr_t>(base) + bytes) & ~(page - 1);
+    if (last > first) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+#endif
+    const std::size_t n = static_cast<std::size_t>(threads_);
+    auto fill = [&](int begin, int end, int) {
+        for (int w = begin; w < end; ++w) {
+            const std::size_t from = bytes * static_cast<std::size_t>(w) / n;
+            const std::size_t to = bytes * static_cast<std::size_t>(w + 1) / n;
+            std::memset(base + from, 0, to - from);
+        }
+    };
+    // One task per worker, never stolen, so slice w is written by worker w
+    using F = decltype(fill);
+    run_tasks(threads_, 1, false, [](void* f, int begin, int end, int worker) {
+        (*static_cast<F*>(f))(begin, end, worker);
+    }, &fill);
+}
+
+ExecScope::ExecScope(ExecContext& context) : previous_(tl_current) {
+    tl_current = &context;
+}
+
+ExecScope::~ExecScope() {
+    tl_current = previous_;
+}
+
+} // namespace isp
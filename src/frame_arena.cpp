@@ -0,0 +1,58 @@
+#include "frame_arena.hpp"
+
+namespace isp {
+
+FrameArena::FrameArena(std::size_t capacity) {
+    if (capacity > 0) add_block(capacity);
+}
+
+void FrameArena::add_block(std::size_t bytes) {
+    bytes = footprint(bytes);
+    Block block;
+    block.storage.reset(new std::byte[bytes + kAlignment]);
+    const auto address = reinterpret_cast<std::uintptr_t>(block.storage.get());
+    block.base = block.storage.get() + (kAlignment - address % kAlignment) % kAlignment;
+    block.size = bytes;
+    blocks_.push_back(std::move(block));
+}
+
+void FrameArena::reserve(std::size_t bytes) {
+    const std::size_t total = capacity();
+    if (total < bytes) add_block(bytes - total);
+}
+
+void FrameArena::reset() {
+    if (blocks_.size() > 1) {
+        const std::size_t total = capacity();
+        blocks_.clear();
+        add_block(total);
+    }
+    block_ = 0;
+    offset_ = 0;
+}
+
+std::size_t FrameArena::capacity() const {
+    std::size_t total = 0;
+    for (const Block& block : blocks_) total += block.size;
+    return total;
+}
+
+void* FrameArena::allocate_bytes(std::size_t bytes) {
+    bytes = footprint(bytes);
+    while (block_ < blocks_.size()) {
+        Block& block = blocks_[block_];
+        if (block.size - offset_ >= bytes) {
+            void* p = block.base + offset_;
+            offset_ += bytes;
+            return p;
+        }
+        ++block_;
+        offset_ = 0;
+    }
+    add_block(bytes);
+    block_ = blocks_.size() - 1;
+    offset_ = bytes;
+    return blocks_.back().base;
+}
+
+} // namespace isp
@@ -0,0 +1,43 @@
+#include "frame_pool.hpp"
+#include <stdexcept>
+
+namespace isp {
+
+FramePool::FramePool(const FrameFormat& format, std::size_t count) {
+    if (count == 0) {
+        throw std::invalid_argument("Frame pool needs at least one buffer set");
+    }
+
+    // The 8-bit RGB output is the largest user; packed RAW needs at most 2 bytes per pixel
+    const std::size_t pixels = static_cast<std::size_t>(format.width) * static_cast<std::size_t>(format.height);
+    const std::size_t bytes = 3 * pixels;
+
+    buffers_.reserve(count);
+    free_.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto buffers = std::make_unique<FrameBuffers>();
+        buffers->raw = Image(format.width, format.height, format.bit_depth, format.pattern);
+        buffers->rgb = RgbImage(format.width, format.height, format.bit_depth);
+        buffers->bytes.reserve(bytes);
+        free_.push_back(buffers.get());
+        buffers_.push_back(std::move(buffers));
+    }
+}
+
+FrameBuffers& FramePool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] { return !free_.empty(); });
+    FrameBuffers* buffers = free_.back();
+    free_.pop_back();
+    return *buffers;
+}
+
+void FramePool::release(FrameBuffers& buffers) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(&buffers);
+    }
+    available_.notify_one();
+}
+
+} // namespace isp
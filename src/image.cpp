@@ -3,6 +3,26 @@
 
 namespace isp {
 
+int bayer_channel(BayerPattern pattern, int x, int y) {
+    // Channels of the quad's top-left, top-right, bottom-left, bottom-right
+    static constexpr int kQuads[4][4] = {
+        {0, 1, 1, 2},  // RGGB
+        {2, 1, 1, 0},  // BGGR
+        {1, 0, 2, 1},  // GRBG
+        {1, 2, 0, 1},  // GBRG
+    };
+    return kQuads[static_cast<int>(pattern)][(y & 1) * 2 + (x & 1)];
+}
+
+bool parse_bayer_pattern(const std::string& name, BayerPattern& pattern) {
+    if (name == "rggb") pattern = BayerPattern::RGGB;
+    else if (name == "bggr") pattern = BayerPattern::BGGR;
+    else if (name == "grbg") pattern = BayerPattern::GRBG;
+    else if (name == "gbrg") pattern = BayerPattern::GBRG;
+    else return false;
+    return true;
+}
+
 Image::Image(int width, int height, int bit_depth, BayerPattern pattern)
     : width_(width)
     , height_(height)
@@ -3,48 +3,306 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../vendor/stb_image_write.h"
 #include "io.hpp"
+#include "convert_8bit.hpp"
+#include "exec_context.hpp"
+#include "raw_unpack.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(ISP_HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 namespace isp {
 
-std::optional<Image> load_raw(const std::string& path, const RawFileConfig& config) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open: " << path << '\n';
-        return std::nullopt;
+namespace {
+
+// Read-only mapping of a whole file; data() is null if it could not be mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const uint8_t*>(p);
+                size_ = static_cast<std::size_t>(st.st_size);
+                // Rows are unpacked in parallel; start paging everything in
+                ::madvise(p, size_, MADV_WILLNEED);
+            }
+        }
+        ::close(fd);  // the mapping stays valid
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
     }
 
-    Image img(config.width, config.height, config.bit_depth, config.pattern);
-    auto& data = img.data();
-    const bool is_16bit = config.bit_depth > 8;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    std::size_t size() const { return size_; }
 
-    if (is_16bit) {
-        // 16-bit: read two bytes per pixel
-        std::vector<uint8_t> buffer(data.size() * 2);
-        file.read(reinterpret_cast<char*>(buffer.data()), 
-                  static_cast<std::streamsize>(buffer.size()));
+private:
+    const uint8_t* data_{nullptr};
+    std::size_t size_{0};
+};
 
-        for (std::size_t i = 0; i < data.size(); ++i) {
-            uint16_t low = buffer[i * 2];
-            uint16_t high = buffer[i * 2 + 1];
-            data[i] = static_cast<uint16_t>(config.little_endian ? (high << 8 | low) : (low << 8 | high));
+// Samples in PPM order: one byte each up to 8 bits, else big-endian pairs
+void serialize_samples(const uint16_t* data, std::size_t count, uint16_t max_val, std::vector<uint8_t>& out) {
+    if (max_val > 255) {
+        out.resize(count * 2);
+        uint8_t* dst = out.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[2 * i] = static_cast<uint8_t>(data[i] >> 8);
+            dst[2 * i + 1] = static_cast<uint8_t>(data[i] & 0xFF);
         }
     } else {
-        // 8-bit: one byte per pixel
-        std::vector<uint8_t> buffer(data.size());
-        file.read(reinterpret_cast<char*>(buffer.data()), 
-                  static_cast<std::streamsize>(buffer.size()));
+        out.resize(count);
+        uint8_t* dst = out.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[i] = static_cast<uint8_t>(data[i]);
+        }
+    }
+}
 
-        for (std::size_t i = 0; i < data.size(); ++i) {
-            data[i] = buffer[i];
+// Header and body in two writes instead of a put() per byte
+bool write_ppm(const std::string& path, char p, char kind, int width, int height, int max_val,
+               const uint8_t* body, std::size_t bytes) {
+    ISP_TRACE_SCOPE("Write PPM", "io");
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to create: " << path << '\n';
+        return false;
+    }
+    file << p << kind << "\n" << width << " " << height << "\n" << max_val << "\n";
+    file.write(reinterpret_cast<const char*>(body), static_cast<std::streamsize>(bytes));
+    return static_cast<bool>(file);
+}
+
+#if defined(ISP_HAVE_ZLIB)
+
+// Bytes of filtered image data each deflate strip covers. Strips compress
+// in parallel; each is primed with the 32 KiB before it, so splitting costs
+// almost no ratio.
+constexpr std::size_t kPngStripBytes = 256 * 1024;
+constexpr std::size_t kDeflateWindow = 32 * 1024;
+constexpr int kPngLevel = 1;  // still smaller files than stb_image_write's encoder
+
+uint8_t paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// Filter one row (type byte + bytes) with whichever of the five PNG
+// filters gives the smallest sum of absolute residuals, as libpng and
+// stb_image_write do. `prev` is null for the first row.
+void filter_png_row(const uint8_t* row, const uint8_t* prev, std::size_t bytes, uint8_t* out) {
+    constexpr std::size_t bpp = 3;
+    auto predict = [&](int type, std::size_t i) -> uint8_t {
+        const int a = i >= bpp ? row[i - bpp] : 0;
+        const int b = prev ? prev[i] : 0;
+        const int c = prev && i >= bpp ? prev[i - bpp] : 0;
+        switch (type) {
+        case 1: return static_cast<uint8_t>(a);
+        case 2: return static_cast<uint8_t>(b);
+        case 3: return static_cast<uint8_t>((a + b) >> 1);
+        case 4: return paeth(a, b, c);
+        default: return 0;
+        }
+    };
+
+    int best_type = 0;
+    long best_cost = -1;
+    for (int type = 0; type < 5; ++type) {
+        long cost = 0;
+        for (std::size_t i = 0; i < bytes; ++i) {
+            cost += std::abs(static_cast<int8_t>(static_cast<uint8_t>(row[i] - predict(type, i))));
+        }
+        if (best_cost < 0 || cost < best_cost) {
+            best_cost = cost;
+            best_type = type;
         }
     }
 
+    out[0] = static_cast<uint8_t>(best_type);
+    for (std::size_t i = 0; i < bytes; ++i) {
+        out[1 + i] = static_cast<uint8_t>(row[i] - predict(best_type, i));
+    }
+}
+
+// Raw deflate of data[begin, end); every strip but the last ends with a
+// sync flush so the strips concatenate into one stream
+bool deflate_strip(const uint8_t* data, std::size_t begin, std::size_t end, bool last, std::vector<uint8_t>& out) {
+    z_stream zs{};
+    if (deflateInit2(&zs, kPngLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    const std::size_t dictionary = std::min(begin, kDeflateWindow);
+    if (dictionary > 0) {
+        deflateSetDictionary(&zs, data + begin - dictionary, static_cast<uInt>(dictionary));
+    }
+
+    out.resize(deflateBound(&zs, static_cast<uLong>(end - begin)) + 16);
+    zs.next_in = const_cast<Bytef*>(data + begin);
+    zs.avail_in = static_cast<uInt>(end - begin);
+    zs.next_out = out.data();
+    zs.avail_out = static_cast<uInt>(out.size());
+    const int status = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool ok = last ? status == Z_STREAM_END : (status == Z_OK && zs.avail_in == 0);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+void put_u32(std::ofstream& file, uint32_t v) {
+    const char bytes[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+                           static_cast<char>(v >> 8), static_cast<char>(v)};
+    file.write(bytes, 4);
+}
+
+void put_chunk(std::ofstream& file, const char* type, const uint8_t* data, uint32_t size) {
+    put_u32(file, size);
+    file.write(type, 4);
+    if (size > 0) file.write(reinterpret_cast<const char*>(data), size);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    if (size > 0) crc = crc32(crc, data, size);  // a null buffer would reset it
+    put_u32(file, static_cast<uint32_t>(crc));
+}
+
+// 8-bit RGB PNG whose image data is filtered and deflated in parallel
+// strips (the pigz scheme), written as a single IDAT chunk
+bool write_png_strips(const std::string& path, const uint8_t* rgb, int width, int height) {
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * 3;
+    const std::size_t filtered_row = row_bytes + 1;
+    std::vector<uint8_t> filtered(filtered_row * static_cast<std::size_t>(height));
+
+    parallel_for(height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const std::size_t row = static_cast<std::size_t>(y);
+            filter_png_row(rgb + row * row_bytes, y > 0 ? rgb + (row - 1) * row_bytes : nullptr, row_bytes,
+                           filtered.data() + row * filtered_row);
+        }
+    });
+
+    const std::size_t rows_per_strip = std::max<std::size_t>(1, kPngStripBytes / filtered_row);
+    const int strips = static_cast<int>((static_cast<std::size_t>(height) + rows_per_strip - 1) / rows_per_strip);
+    std::vector<std::vector<uint8_t>> compressed(static_cast<std::size_t>(strips));
+    std::vector<uLong> adlers(static_cast<std::size_t>(strips));
+    std::vector<uLong> crcs(static_cast<std::size_t>(strips));
+    std::vector<std::size_t> sizes(static_cast<std::size_t>(strips));
+    // One strip per task: deflate time varies with content
+    std::atomic<bool> ok{true};
+    parallel_for_workers(strips, 1, [&](int first, int last, int) {
+        for (int k = first; k < last; ++k) {
+            const std::size_t i = static_cast<std::size_t>(k);
+            const std::size_t begin = i * rows_per_strip * filtered_row;
+            const std::size_t end = std::min(filtered.size(), begin + rows_per_strip * filtered_row);
+            if (!deflate_strip(filtered.data(), begin, end, k + 1 == strips, compressed[i])) ok = false;
+            adlers[i] = adler32(1, filtered.data() + begin, static_cast<uInt>(end - begin));
+            crcs[i] = crc32(0, compressed[i].data(), static_cast<uInt>(compressed[i].size()));
+            sizes[i] = end - begin;
+        }
+    });
+    if (!ok) {
+        std::cerr << "PNG compression failed: " << path << '\n';
+        return false;
+    }
+
+    // zlib stream = header + concatenated strips + Adler-32 of all input
+    uint8_t header[2] = {0x78, 0x01};  // 32 KiB window, fastest compression
+    uLong adler = adlers[0];
+    std::size_t idat_size = sizeof(header) + 4;
+    for (int k = 0; k < strips; ++k) {
+        const std::size_t i = static_cast<std::size_t>(k);
+        if (k > 0) adler = adler32_combine(adler, adlers[i], static_cast<z_off_t>(sizes[i]));
+        idat_size += compressed[i].size();
+    }
+    if (idat_size > 0x7FFFFFFF) {
+        std::cerr << "PNG too large: " << path << '\n';
+        return false;
+    }
+    const uint8_t trailer[4] = {static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                                static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)};
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to create: " << path << '\n';
+        return false;
+    }
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    uint8_t ihdr[13] = {};
+    for (int b = 0; b < 4; ++b) {
+        ihdr[b] = static_cast<uint8_t>(static_cast<uint32_t>(width) >> (24 - 8 * b));
+        ihdr[4 + b] = static_cast<uint8_t>(static_cast<uint32_t>(height) >> (24 - 8 * b));
+    }
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // truecolor
+    put_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+
+    // IDAT written piece by piece; its CRC is combined from the strips'
+    put_u32(file, static_cast<uint32_t>(idat_size));
+    file.write("IDAT", 4);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    uLong crc = crc32(crc32(0, reinterpret_cast<const Bytef*>("IDAT"), 4), header, sizeof(header));
+    for (int k = 0; k < strips; ++k) {
+        const std::vector<uint8_t>& strip = compressed[static_cast<std::size_t>(k)];
+        file.write(reinterpret_cast<const char*>(strip.data()), static_cast<std::streamsize>(strip.size()));
+        crc = crc32_combine(crc, crcs[static_cast<std::size_t>(k)], static_cast<z_off_t>(strip.size()));
+    }
+    file.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+    crc = crc32(crc, trailer, sizeof(trailer));
+    put_u32(file, static_cast<uint32_t>(crc));
+
+    put_chunk(file, "IEND", nullptr, 0);
+    return static_cast<bool>(file);
+}
+
+#endif // ISP_HAVE_ZLIB
+
+} // anonymous namespace
+
+std::optional<Image> load_raw(const std::string& path, const RawFileConfig& config) {
+    Image img;
+    if (!load_raw(path, config, img)) {
+        return std::nullopt;
+    }
     return img;
 }
 
+bool load_raw(const std::string& path, const RawFileConfig& config, Image& img) {
+    ISP_TRACE_SCOPE("Load RAW", "io");
+    // Unpacked straight from the page cache: no read buffer, no stream
+    MappedFile file(path);
+    if (!file.data()) {
+        std::cerr << "Failed to open: " << path << '\n';
+        return false;
+    }
+    if (!unpack_raw(file.data(), file.size(), config, img)) {
+        std::cerr << "File too small for a " << config.width << "x" << config.height
+                  << " frame: " << path << '\n';
+        return false;
+    }
+    return true;
+}
+
 std::optional<Image> load_png_as_raw(const std::string& path, BayerPattern pattern) {
+    ISP_TRACE_SCOPE("Load PNG", "io");
     int w, h, channels;
     uint8_t* data = stbi_load(path.c_str(), &w, &h, &channels, 3); // Force RGB
     if (!data) {
@@ -53,127 +311,117 @@ std::optional<Image> load_png_as_raw(const std::string& path, BayerPattern patte
     }
 
     Image raw(w, h, 12, pattern);
-    auto& raw_data = raw.data();
-
-    // Simulate Bayer pattern: keep only one channel per pixel
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            std::size_t src_idx = static_cast<std::size_t>((y * w + x) * 3);
-            std::size_t dst_idx = static_cast<std::size_t>(y * w + x);
-
-            uint8_t r = data[src_idx + 0];
-            uint8_t g = data[src_idx + 1];
-            uint8_t b = data[src_idx + 2];
-
-            bool even_row = (y % 2 == 0);
-            bool even_col = (x % 2 == 0);
-
-            uint8_t value;
-            if (pattern == BayerPattern::RGGB) {
-                if (even_row && even_col)       value = r;
-                else if (even_row && !even_col) value = g;
-                else if (!even_row && even_col) value = g;
-                else                            value = b;
-            } else {
-                // Fallback: only RGGB supported
-                value = g;
-            }
+    const std::size_t width = static_cast<std::size_t>(w);
 
-            // Convert 8-bit to 12-bit
-            raw_data[dst_idx] = static_cast<uint16_t>(value) << 4;
+    // Simulate the sensor: keep the pattern's channel at each pixel, 8 → 12 bits
+    parallel_for(h, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int channel[2] = {bayer_channel(pattern, 0, y), bayer_channel(pattern, 1, y)};
+            const uint8_t* src = data + static_cast<std::size_t>(y) * width * 3;
+            uint16_t* dst = raw.data().data() + static_cast<std::size_t>(y) * width;
+            for (std::size_t x = 0; x < width; ++x) {
+                dst[x] = static_cast<uint16_t>(src[3 * x + static_cast<std::size_t>(channel[x & 1])] << 4);
+            }
         }
-    }
+    });
 
     stbi_image_free(data);
     return raw;
 }
 
-bool save_ppm(const std::string& path, const Image& img) {
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to create: " << path << '\n';
-        return false;
+std::optional<RgbImage> load_png(const std::string& path) {
+    ISP_TRACE_SCOPE("Load PNG", "io");
+    int w, h, channels;
+    uint8_t* data = stbi_load(path.c_str(), &w, &h, &channels, 3);
+    if (!data) {
+        std::cerr << "Failed to load: " << path << '\n';
+        return std::nullopt;
     }
 
-    const int w = img.width();
-    const int h = img.height();
-    const uint16_t max_val = img.max_value();
-    const auto& data = img.data();
+    RgbImage rgb(w, h, 12);
+    const uint8_t* src = data;
+    for (Pixel& p : rgb.data()) {
+        p = Pixel{static_cast<uint16_t>(src[0] << 4), static_cast<uint16_t>(src[1] << 4),
+                  static_cast<uint16_t>(src[2] << 4)};
+        src += 3;
+    }
 
-    // PPM header (P5 = grayscale binary)
-    file << "P5\n" << w << " " << h << "\n" << max_val << "\n";
+    stbi_image_free(data);
+    return rgb;
+}
 
-    if (max_val > 255) {
-        // 16-bit: PPM uses big-endian
-        for (std::size_t i = 0; i < data.size(); ++i) {
-            uint8_t high = static_cast<uint8_t>(data[i] >> 8);
-            uint8_t low = static_cast<uint8_t>(data[i] & 0xFF);
-            file.put(static_cast<char>(high));
-            file.put(static_cast<char>(low));
-        }
-    } else {
-        for (std::size_t i = 0; i < data.size(); ++i) {
-            file.put(static_cast<char>(data[i]));
-        }
-    }
+bool save_ppm(const std::string& path, const Image& img) {
+    std::vector<uint8_t> staging;
+    return save_ppm(path, img, staging);
+}
 
-    return true;
+bool save_ppm(const std::string& path, const Image& img, std::vector<uint8_t>& staging) {
+    // P5 = grayscale binary
+    const uint16_t* data = img.data().data();
+    serialize_samples(data, img.data().size(), img.max_value(), staging);
+    return write_ppm(path, 'P', '5', img.width(), img.height(), img.max_value(), staging.data(), staging.size());
 }
 
 bool save_ppm(const std::string& path, const RgbImage& img) {
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to create: " << path << '\n';
-        return false;
-    }
+    std::vector<uint8_t> staging;
+    return save_ppm(path, img, staging);
+}
+
+bool save_ppm(const std::string& path, const RgbImage& img, std::vector<uint8_t>& staging) {
+    // P6 = RGB binary
+    static_assert(sizeof(Pixel) == 3 * sizeof(uint16_t), "Pixel must be three packed samples");
+    const uint16_t* data = reinterpret_cast<const uint16_t*>(img.data().data());
+    serialize_samples(data, img.size() * 3, img.max_value(), staging);
+    return write_ppm(path, 'P', '6', img.width(), img.height(), img.max_value(), staging.data(), staging.size());
+}
 
-    const int w = img.width();
-    const int h = img.height();
-    const uint16_t max_val = img.max_value();
-    const auto& data = img.data();
+bool save_ppm(const std::string& path, const uint8_t* rgb, int width, int height) {
+    const std::size_t bytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3;
+    return write_ppm(path, 'P', '6', width, height, 255, rgb, bytes);
+}
 
-    // PPM header (P6 = RGB binary)
-    file << "P6\n" << w << " " << h << "\n" << max_val << "\n";
+bool save_png(const std::string& path, const RgbImage& img) {
+    std::vector<uint8_t> staging;
+    return save_png(path, img, staging);
+}
 
-    if (max_val > 255) {
-        // 16-bit: PPM uses big-endian
-        for (const auto& p : data) {
-            file.put(static_cast<char>(p.r >> 8));
-            file.put(static_cast<char>(p.r & 0xFF));
-            file.put(static_cast<char>(p.g >> 8));
-            file.put(static_cast<char>(p.g & 0xFF));
-            file.put(static_cast<char>(p.b >> 8));
-            file.put(static_cast<char>(p.b & 0xFF));
-        }
-    } else {
-        for (const auto& p : data) {
-            file.put(static_cast<char>(p.r));
-            file.put(static_cast<char>(p.g));
-            file.put(static_cast<char>(p.b));
-        }
-    }
+bool save_png(const std::string& path, const RgbImage& img, std::vector<uint8_t>& staging) {
+    convert_to_8bit(img, staging);
+    return save_png(path, staging.data(), img.width(), img.height());
+}
 
-    return true;
+bool save_png(const std::string& path, const uint8_t* rgb, int width, int height) {
+    ISP_TRACE_SCOPE("Write PNG", "io");
+#if defined(ISP_HAVE_ZLIB)
+    return write_png_strips(path, rgb, width, height);
+#else
+    return stbi_write_png(path.c_str(), width, height, 3, rgb, width * 3) != 0;
+#endif
 }
 
-bool save_png(const std::string& path, const RgbImage& img) {
-    const int w = img.width();
-    const int h = img.height();
-    const auto& data = img.data();
-    const uint16_t max_val = img.max_value();
+bool parse_output_format(const std::string& name, OutputFormat& format) {
+    if (name == "png") format = OutputFormat::Png;
+    else if (name == "ppm") format = OutputFormat::Ppm;
+    else if (name == "ppm8") format = OutputFormat::Ppm8;
+    else return false;
+    return true;
+}
 
-    // PNG 只支援 8-bit，需要轉換
-    std::vector<uint8_t> buffer(static_cast<std::size_t>(w * h * 3));
+const char* output_extension(OutputFormat format) {
+    return format == OutputFormat::Png ? ".png" : ".ppm";
+}
 
-    for (std::size_t i = 0; i < data.size(); ++i) {
-        // 從原本的 bit depth 轉換到 8-bit
-        buffer[i * 3 + 0] = static_cast<uint8_t>(data[i].r * 255 / max_val);
-        buffer[i * 3 + 1] = static_cast<uint8_t>(data[i].g * 255 / max_val);
-        buffer[i * 3 + 2] = static_cast<uint8_t>(data[i].b * 255 / max_val);
+bool save_image(const std::string& path, const RgbImage& img, OutputFormat format, std::vector<uint8_t>& staging) {
+    switch (format) {
+    case OutputFormat::Ppm:
+        return save_ppm(path, img, staging);
+    case OutputFormat::Ppm8:
+        convert_to_8bit(img, staging);
+        return save_ppm(path, staging.data(), img.width(), img.height());
+    case OutputFormat::Png:
+        break;
     }
-
-    int result = stbi_write_png(path.c_str(), w, h, 3, buffer.data(), w * 3);
-    return result != 0;
+    return save_png(path, img, staging);
 }
 
-} // namespace isp
\ No newline at end of file
+} // namespace isp
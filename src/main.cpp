@@ -1,42 +1,232 @@
 #include "image.hpp"
 #include "io.hpp"
 #include "rgb_image.hpp"
+#include "planar_image.hpp"
 #include "modules/blc.hpp"
 #include "modules/demosaic.hpp"
 #include "modules/awb.hpp"
 #include "modules/gamma.hpp"
 #include "modules/sharpen.hpp"
 #include "modules/denoise.hpp"
+#include "tiled_pipeline.hpp"
+#include "preview_pipeline.hpp"
+#include "pipeline.hpp"
+#include "batch.hpp"
+#include "exec_context.hpp"
+#include "raw_unpack.hpp"
+#include "alloc_counter.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <iostream>
 #include <optional>
 #include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
 
 int main(int argc, char* argv[]) {
     std::string input_path = "data/test.raw";
     bool use_png_input = false;
+    bool use_tiled = false;
+    bool use_planar = false;
+    bool use_preview = false;
+    bool use_video = false;
+    bool use_raw_denoise = false;
+    int preview_binning = 1;
+    std::optional<isp::Rect> roi;
+    isp::DemosaicMethod demosaic_method = isp::DemosaicMethod::Bilinear;
+    int repeat = 1;
+    int threads = 0;
+    std::string batch_path;
+    isp::BatchConfig batch;
+    isp::RawFileConfig raw_config{640, 480};
 
-    if (argc > 1) {
-        input_path = argv[1];
+    // Written when main returns, whichever mode ran
+    struct TraceOutput {
+        std::string path;
+        ~TraceOutput() {
+            if (!path.empty() && isp::trace::write_chrome_trace(path)) {
+                std::cout << "Trace: " << path << " (" << isp::trace::event_count() << " spans)\n";
+            }
+        }
+    } trace_output;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tiled") {
+            use_tiled = true;
+            continue;
+        }
+        if (arg == "--planar") {
+            use_planar = true;
+            continue;
+        }
+        if (arg == "--preview") {
+            use_preview = true;
+            continue;
+        }
+        if (arg == "--video") {
+            use_video = true;
+            continue;
+        }
+        if (arg == "--bin" && i + 1 < argc) {
+            preview_binning = std::stoi(argv[++i]);
+            if (preview_binning < 1 || (preview_binning & (preview_binning - 1)) != 0) {
+                std::cerr << "Binning must be a power of two: " << argv[i] << "\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--roi" && i + 1 < argc) {
+            isp::Rect r;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &r.x, &r.y, &r.width, &r.height) != 4) {
+                std::cerr << "ROI must be x,y,width,height: " << argv[i] << "\n";
+                return 1;
+            }
+            roi = r;
+            continue;
+        }
+        if (arg == "--raw-denoise") {
+            use_raw_denoise = true;
+            continue;
+        }
+        if (arg == "--trace" && i + 1 < argc) {
+            trace_output.path = argv[++i];
+            if (!isp::trace::compiled_in()) {
+                std::cerr << "Built without ISP_ENABLE_TRACING; the trace will be empty\n";
+            }
+            isp::trace::set_enabled(true);
+            continue;
+        }
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--batch" && i + 1 < argc) {
+            batch_path = argv[++i];
+            continue;
+        }
+        if (arg == "--out" && i + 1 < argc) {
+            batch.output_dir = argv[++i];
+            continue;
+        }
+        if (arg == "--jobs" && i + 1 < argc) {
+            batch.jobs = std::stoi(argv[++i]);
+            continue;
+        }
+        if (arg == "--ppm") {
+            batch.output_format = isp::OutputFormat::Ppm;
+            continue;
+        }
+        if (arg == "--format" && i + 1 < argc) {
+            if (!isp::parse_output_format(argv[++i], batch.output_format)) {
+                std::cerr << "Unknown format: " << argv[i] << " (png, ppm or ppm8)\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--width" && i + 1 < argc) {
+            raw_config.width = std::stoi(argv[++i]);
+            continue;
+        }
+        if (arg == "--height" && i + 1 < argc) {
+            raw_config.height = std::stoi(argv[++i]);
+            continue;
+        }
+        if (arg == "--bit-depth" && i + 1 < argc) {
+            raw_config.bit_depth = std::stoi(argv[++i]);
+            continue;
+        }
+        if (arg == "--big-endian") {
+            raw_config.little_endian = false;
+            continue;
+        }
+        if (arg == "--packing" && i + 1 < argc) {
+            if (!isp::parse_raw_packing(argv[++i], raw_config.packing)) {
+                std::cerr << "Unknown packing: " << argv[i] << " (raw10, raw12 or raw16)\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--pattern" && i + 1 < argc) {
+            if (!isp::parse_bayer_pattern(argv[++i], raw_config.pattern)) {
+                std::cerr << "Unknown pattern: " << argv[i] << " (rggb, bggr, grbg or gbrg)\n";
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--demosaic" && i + 1 < argc) {
+            if (!isp::parse_demosaic_method(argv[++i], demosaic_method)) {
+                std::cerr << "Unknown demosaic: " << argv[i] << " (bilinear or mhc)\n";
+                return 1;
+            }
+            continue;
+        }
+        input_path = arg;
         if (input_path.size() > 4 && 
             input_path.substr(input_path.size() - 4) == ".png") {
             use_png_input = true;
         }
     }
+    // Packed formats fix the sample depth
+    if (raw_config.packing == isp::RawPacking::Mipi10) raw_config.bit_depth = 10;
+    if (raw_config.packing == isp::RawPacking::Mipi12) raw_config.bit_depth = 12;
+
+    // The tiled, ROI, planar and preview paths run their own fixed chains
+    const char* fixed_chain = use_tiled ? "--tiled" : roi ? "--roi" : use_planar ? "--planar"
+                            : use_preview ? "--preview" : nullptr;
+    if (use_raw_denoise && fixed_chain) {
+        std::cerr << "--raw-denoise cannot be combined with " << fixed_chain << "\n";
+        return 1;
+    }
+    if (preview_binning > 1 && fixed_chain) {
+        std::cerr << "--bin cannot be combined with " << fixed_chain << "\n";
+        return 1;
+    }
+
+    if (!batch_path.empty()) {
+        batch.inputs = isp::list_batch_inputs(batch_path);
+        batch.raw = raw_config;
+        batch.threads = threads;
+        batch.pipeline.demosaic = demosaic_method;
+        batch.pipeline.raw_denoise = use_raw_denoise;
+        batch.pipeline.preview_binning = preview_binning;
+        std::cout << "=== Batch: " << batch.inputs.size() << " frames from " << batch_path << " ===\n";
+
+        isp::BatchStats stats;
+        try {
+            stats = isp::run_batch(batch);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Jobs:     " << stats.jobs << " x " << stats.threads_per_job << " threads\n";
+        std::cout << "Frames:   " << stats.frames << " written, " << stats.failed << " failed\n";
+        std::cout << "Time:     " << stats.seconds << " s\n";
+        if (stats.seconds > 0) {
+            std::cout << "Rate:     " << static_cast<double>(stats.frames) / stats.seconds << " frames/s, "
+                      << stats.megapixels / stats.seconds << " MP/s\n";
+        }
+        std::cout << "Output:   " << batch.output_dir << "/\n";
+        return stats.failed == 0 ? 0 : 1;
+    }
+
+    // Every parallel loop below runs on these workers
+    isp::ExecContext exec(threads);
+    isp::ExecScope exec_scope(exec);
 
     std::optional<isp::Image> result;
 
     if (use_png_input) {
         std::cout << "Loading PNG as RAW: " << input_path << "\n";
-        result = isp::load_png_as_raw(input_path);
+        result = isp::load_png_as_raw(input_path, raw_config.pattern);
     } else {
         std::cout << "Loading RAW: " << input_path << "\n";
-        isp::RawFileConfig config;
-        config.width = 640;
-        config.height = 480;
-        config.bit_depth = 12;
-        config.pattern = isp::BayerPattern::RGGB;
-        config.little_endian = true;
-        result = isp::load_raw(input_path, config);
+        result = isp::load_raw(input_path, raw_config);
     }
 
     if (!result) {
@@ -49,56 +239,168 @@ int main(int argc, char* argv[]) {
 
     // Benchmark helper
     using Clock = std::chrono::high_resolution_clock;
-    auto total_start = Clock::now();
 
-    std::cout << "=== Pipeline Benchmark ===\n";
+    if (roi) {
+        std::cout << "=== ROI Pipeline Benchmark ===\n";
+        isp::TiledPipelineConfig tiled_config;
+        tiled_config.demosaic = demosaic_method;
+        isp::RgbImage rgb;
+        auto start = Clock::now();
+        try {
+            rgb = isp::run_roi_pipeline(raw, *roi, tiled_config);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        auto end = Clock::now();
+        const isp::Rect input = isp::roi_input_region(*roi, raw.width(), raw.height(), tiled_config);
+        std::cout << "ROI:      " << roi->width << "x" << roi->height << " at " << roi->x << "," << roi->y
+                  << " (reads " << input.width << "x" << input.height << " RAW)\n";
+        std::cout << "Total:    " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+                  << " us\n\n";
+
+        std::cout << "Saving output...\n";
+        isp::save_ppm("data/output.ppm", rgb);
+        isp::save_png("data/output.png", rgb);
+        std::cout << "Saved: data/output.png\n";
+        return 0;
+    }
+
+    if (use_tiled) {
+        std::cout << "=== Tiled Pipeline Benchmark ===\n";
+        // In video mode the repeats are a stream; the last frame is timed
+        isp::TemporalAwb awb;
+        isp::TiledPipelineConfig tiled_config;
+        tiled_config.demosaic = demosaic_method;
+        isp::RgbImage rgb;
+        long long tiled_time = 0;
+        for (int i = 0; i < (use_video ? repeat : 1); ++i) {
+            ISP_TRACE_FRAME(static_cast<uint32_t>(i));
+            auto start = Clock::now();
+            rgb = use_video ? isp::run_tiled_pipeline(raw, tiled_config, awb) : isp::run_tiled_pipeline(raw, tiled_config);
+            auto end = Clock::now();
+            tiled_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        }
+        std::cout << "Total:    " << tiled_time << " us\n\n";
+
+        std::cout << "Saving output...\n";
+        isp::save_ppm("data/output.ppm", rgb);
+        isp::save_png("data/output.png", rgb);
+        std::cout << "Saved: data/output.png\n";
+        return 0;
+    }
+
+    if (use_preview) {
+        std::cout << "=== 8-bit Preview Pipeline Benchmark ===\n";
+        auto start = Clock::now();
+        isp::PlanarRgbImage8 preview = isp::run_preview_pipeline(raw);
+        auto end = Clock::now();
+        auto preview_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "Total:    " << preview_time << " us\n\n";
+
+        std::cout << "Saving output...\n";
+        isp::RgbImage rgb = isp::to_interleaved(preview);
+        isp::save_ppm("data/output.ppm", rgb);
+        isp::save_png("data/output.png", rgb);
+        std::cout << "Saved: data/output.png\n";
+        return 0;
+    }
+
+    if (use_planar) {
+        // Planar working format: one plane per channel from demosaic to output
+        auto total_start = Clock::now();
+        std::cout << "=== Planar Pipeline Benchmark ===\n";
+
+        auto start = Clock::now();
+        isp::apply_blc(raw, 64);
+        auto end = Clock::now();
+        std::cout << "BLC:      " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+        start = Clock::now();
+        isp::PlanarRgbImage planar = isp::demosaic_planar(raw, demosaic_method);
+        end = Clock::now();
+        std::cout << "Demosaic: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+        start = Clock::now();
+        isp::apply_awb(planar);
+        end = Clock::now();
+        std::cout << "AWB:      " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+        start = Clock::now();
+        isp::apply_gamma(planar, 2.2);
+        end = Clock::now();
+        std::cout << "Gamma:    " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
 
-    // BLC
-    auto start = Clock::now();
-    isp::apply_blc(raw, 64);
-    auto end = Clock::now();
-    auto blc_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "BLC:      " << blc_time << " us\n";
-
-    // Demosaic
-    start = Clock::now();
-    isp::RgbImage rgb = isp::demosaic(raw);
-    end = Clock::now();
-    auto demosaic_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Demosaic: " << demosaic_time << " us\n";
-
-    // AWB
-    start = Clock::now();
-    isp::apply_awb(rgb);
-    end = Clock::now();
-    auto awb_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "AWB:      " << awb_time << " us\n";
-
-    // Gamma
-    start = Clock::now();
-    isp::apply_gamma(rgb, 2.2);
-    end = Clock::now();
-    auto gamma_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Gamma:    " << gamma_time << " us\n";
-
-    // Denoise
-    start = Clock::now();
-    isp::apply_denoise(rgb);
-    end = Clock::now();
-    auto denoise_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Denoise:  " << denoise_time << " us\n";
-
-    // Sharpen
-    start = Clock::now();
-    isp::apply_sharpen(rgb);
-    end = Clock::now();
-    auto sharpen_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Sharpen:  " << sharpen_time << " us\n";
+        start = Clock::now();
+        isp::apply_denoise(planar);
+        end = Clock::now();
+        std::cout << "Denoise:  " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
 
+        start = Clock::now();
+        isp::apply_sharpen(planar);
+        end = Clock::now();
+        std::cout << "Sharpen:  " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+        auto total_end = Clock::now();
+        std::cout << "-------------------------\n";
+        std::cout << "Total:    " << std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start).count() << " us\n\n";
+
+        std::cout << "Saving output...\n";
+        isp::RgbImage rgb = isp::to_interleaved(planar);
+        isp::save_ppm("data/output.ppm", rgb);
+        isp::save_png("data/output.png", rgb);
+        std::cout << "Saved: data/output.png\n";
+        return 0;
+    }
+
+    isp::PipelineConfig pipeline_config;
+    pipeline_config.video = use_video;
+    pipeline_config.demosaic = demosaic_method;
+    pipeline_config.raw_denoise = use_raw_denoise;
+    pipeline_config.preview_binning = preview_binning;
+    isp::Pipeline pipeline = isp::make_default_pipeline(pipeline_config);
+    pipeline.plan({raw.width(), raw.height(), raw.bit_depth(), raw.pattern()});
+
+    std::cout << "=== Pipeline Benchmark ===\n";
+
+    isp::RgbImage rgb;
+    auto total_start = Clock::now();
+    pipeline.process(raw, rgb);
     auto total_end = Clock::now();
+
+    // Further runs of the same frame only check that steady state allocates nothing
+    if (repeat > 1) {
+        const std::uint64_t before = isp::heap_allocation_count();
+        for (int i = 1; i < repeat; ++i) {
+            ISP_TRACE_FRAME(static_cast<uint32_t>(i));
+            pipeline.process(raw, rgb);
+        }
+        const std::uint64_t allocations = isp::heap_allocation_count() - before;
+        std::cout << "Heap allocations in frames 2-" << repeat << ": " << allocations << "\n";
+    }
+
+    // Fused steps have longer names, e.g. "Demosaic+AWB+Gamma"
+    std::size_t column = 10;
+    for (const isp::StageTiming& timing : pipeline.last_timings()) {
+        column = std::max(column, std::string(timing.name).size() + 2);
+    }
+    auto print_row = [&](const std::string& name, long long microseconds) {
+        std::string label = name + ":";
+        label.resize(column, ' ');
+        std::cout << label << microseconds << " us\n";
+    };
+    for (const isp::StageTiming& timing : pipeline.last_timings()) {
+        print_row(timing.name, static_cast<long long>(timing.microseconds));
+    }
+
     auto total_time = std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start).count();
-    std::cout << "-------------------------\n";
-    std::cout << "Total:    " << total_time << " us\n\n";
+    std::cout << std::string(column + 15, '-') << "\n";
+    print_row("Total", static_cast<long long>(total_time));
+    std::cout << "\n";
+
+    if (preview_binning > 1) {
+        std::cout << "Preview:  " << rgb.width() << "x" << rgb.height() << " (1/" << preview_binning << " per side)\n\n";
+    }
 
     // Save
     std::cout << "Saving output...\n";
@@ -1,20 +1,11 @@
 #include "modules/awb.hpp"
+#include "exec_context.hpp"
 #include <algorithm>
+#include <stdexcept>
 
 namespace isp {
 
-void apply_awb(RgbImage& img) {
-    if (img.size() == 0) return;
-
-    // Calculate channel averages
-    double r_sum = 0, g_sum = 0, b_sum = 0;
-    for (const auto& p : img.data()) {
-        r_sum += p.r;
-        g_sum += p.g;
-        b_sum += p.b;
-    }
-
-    double count = static_cast<double>(img.size());
+AwbGains compute_awb_gains(double r_sum, double g_sum, double b_sum, double count) {
     double r_avg = r_sum / count;
     double g_avg = g_sum / count;
     double b_avg = b_sum / count;
@@ -27,16 +18,67 @@ void apply_awb(RgbImage& img) {
     // Use max average as reference (preserve brightness)
     double max_avg = std::max({r_avg, g_avg, b_avg});
 
-    double r_gain = max_avg / r_avg;
-    double g_gain = max_avg / g_avg;
-    double b_gain = max_avg / b_avg;
+    return AwbGains{max_avg / r_avg, max_avg / g_avg, max_avg / b_avg};
+}
+
+void add_channel_sums(const Pixel* data, std::size_t count, ChannelSums& sums) {
+    uint64_t r = 0, g = 0, b = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        r += data[i].r;
+        g += data[i].g;
+        b += data[i].b;
+    }
+    sums.r += r;
+    sums.g += g;
+    sums.b += b;
+    sums.count += count;
+}
+
+void add_channel_sums(const RgbImage& img, ChannelSums& sums) {
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    const Pixel* data = img.data().data();
+    sums = parallel_sum(img.height(), sums, [&](int begin, int end) {
+        ChannelSums rows;
+        add_channel_sums(data + static_cast<std::size_t>(begin) * w, static_cast<std::size_t>(end - begin) * w, rows);
+        return rows;
+    });
+}
 
-    // Apply gains
-    uint16_t max_val = img.max_value();
-    for (auto& p : img.data()) {
-        double new_r = p.r * r_gain;
-        double new_g = p.g * g_gain;
-        double new_b = p.b * b_gain;
+AwbGains gray_world_gains(const ChannelSums& sums) {
+    if (sums.count == 0) return AwbGains{};
+    return compute_awb_gains(static_cast<double>(sums.r), static_cast<double>(sums.g), static_cast<double>(sums.b),
+                             static_cast<double>(sums.count));
+}
+
+TemporalAwb::TemporalAwb(const TemporalAwbConfig& config) : config_(config) {
+    if (!(config.smoothing > 0.0 && config.smoothing <= 1.0)) {
+        throw std::invalid_argument("AWB smoothing must be in (0, 1]");
+    }
+}
+
+void TemporalAwb::update(const AwbGains& measured) {
+    if (frames_ == 0) {
+        gains_ = measured;
+    } else {
+        const double a = config_.smoothing;
+        gains_.r += a * (measured.r - gains_.r);
+        gains_.g += a * (measured.g - gains_.g);
+        gains_.b += a * (measured.b - gains_.b);
+    }
+    ++frames_;
+}
+
+void TemporalAwb::reset() {
+    gains_ = AwbGains{};
+    frames_ = 0;
+}
+
+void apply_awb_gains(Pixel* data, std::size_t count, const AwbGains& gains, uint16_t max_val) {
+    for (std::size_t i = 0; i < count; ++i) {
+        Pixel& p = data[i];
+        double new_r = p.r * gains.r;
+        double new_g = p.g * gains.g;
+        double new_b = p.b * gains.b;
 
         // Clamp to valid range
         p.r = static_cast<uint16_t>(std::min(new_r, static_cast<double>(max_val)));
@@ -45,4 +87,88 @@ void apply_awb(RgbImage& img) {
     }
 }
 
+template <typename Format>
+void apply_awb_gain(typename Format::Sample* data, std::size_t count, double gain) {
+    using Sample = typename Format::Sample;
+    constexpr double max_d = Format::max_value;
+    for (std::size_t i = 0; i < count; ++i) {
+        data[i] = static_cast<Sample>(std::min(data[i] * gain, max_d));
+    }
+}
+
+template void apply_awb_gain<Format8>(uint8_t*, std::size_t, double);
+template void apply_awb_gain<Format16x8>(uint16_t*, std::size_t, double);
+template void apply_awb_gain<Format10>(uint16_t*, std::size_t, double);
+template void apply_awb_gain<Format12>(uint16_t*, std::size_t, double);
+template void apply_awb_gain<Format14>(uint16_t*, std::size_t, double);
+template void apply_awb_gain<Format16>(uint16_t*, std::size_t, double);
+
+void apply_awb(RgbImage& img) {
+    if (img.size() == 0) return;
+
+    // Integer channel sums: exact, so the gains match double sums, and a
+    // plain parallel reduction
+    ChannelSums sums;
+    add_channel_sums(img, sums);
+    apply_awb_gains(img, gray_world_gains(sums));
+}
+
+void apply_awb_gains(RgbImage& img, const AwbGains& gains) {
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    const uint16_t max_val = img.max_value();
+    Pixel* data = img.data().data();
+    parallel_for(img.height(), [&](int begin, int end) {
+        apply_awb_gains(data + static_cast<std::size_t>(begin) * w, static_cast<std::size_t>(end - begin) * w, gains,
+                        max_val);
+    });
+}
+
+namespace {
+
+template <typename T>
+void apply_awb_planar(PlanarImage<T>& img) {
+    if (img.size() == 0) return;
+
+    const int w = img.width();
+    const int h = img.height();
+
+    // Integer channel sums: exact, and a plain reduction over each plane row
+    uint64_t sums[3] = {0, 0, 0};
+    for (int c = 0; c < 3; ++c) {
+        sums[c] = parallel_sum(h, uint64_t{0}, [&](int begin, int end) {
+            uint64_t sum = 0;
+            for (int y = begin; y < end; ++y) {
+                const T* row = img.row(c, y);
+                for (int x = 0; x < w; ++x) sum += row[x];
+            }
+            return sum;
+        });
+    }
+
+    AwbGains gains = compute_awb_gains(static_cast<double>(sums[0]), static_cast<double>(sums[1]),
+                                       static_cast<double>(sums[2]), static_cast<double>(img.size()));
+    const double channel_gains[3] = {gains.r, gains.g, gains.b};
+
+    dispatch_sample_format<T>(img.bit_depth(), [&](auto format) {
+        using Format = decltype(format);
+        for (int c = 0; c < 3; ++c) {
+            parallel_for(h, [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    apply_awb_gain<Format>(img.row(c, y), static_cast<std::size_t>(w), channel_gains[c]);
+                }
+            });
+        }
+    });
+}
+
+} // anonymous namespace
+
+void apply_awb(PlanarRgbImage& img) {
+    apply_awb_planar(img);
+}
+
+void apply_awb(PlanarRgbImage8& img) {
+    apply_awb_planar(img);
+}
+
 } // namespace isp
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "modules/blc.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
 
 namespace isp {
 
-void apply_blc(Image& img, uint16_t black_level) {
-    for (auto& pixel : img.data()) {
+void apply_blc(uint16_t* data, std::size_t count, uint16_t black_level) {
+    for (std::size_t i = 0; i < count; ++i) {
+        uint16_t& pixel = data[i];
         if (pixel > black_level) {
             pixel -= black_level;
         } else {
@@ -12,4 +15,27 @@ void apply_blc(Image& img, uint16_t black_level) {
     }
 }
 
+template <typename Format>
+void apply_blc_to_8bit(const uint16_t* src, uint8_t* dst, std::size_t count, uint16_t black_level) {
+    constexpr int shift = Format::bits - 8;
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint16_t pixel = src[i] > black_level ? static_cast<uint16_t>(src[i] - black_level) : 0;
+        dst[i] = static_cast<uint8_t>(std::min<uint16_t>(pixel, Format::max_value) >> shift);
+    }
+}
+
+template void apply_blc_to_8bit<Format16x8>(const uint16_t*, uint8_t*, std::size_t, uint16_t);
+template void apply_blc_to_8bit<Format10>(const uint16_t*, uint8_t*, std::size_t, uint16_t);
+template void apply_blc_to_8bit<Format12>(const uint16_t*, uint8_t*, std::size_t, uint16_t);
+template void apply_blc_to_8bit<Format14>(const uint16_t*, uint8_t*, std::size_t, uint16_t);
+template void apply_blc_to_8bit<Format16>(const uint16_t*, uint8_t*, std::size_t, uint16_t);
+
+void apply_blc(Image& img, uint16_t black_level) {
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    uint16_t* data = img.data().data();
+    parallel_for(img.height(), [&](int begin, int end) {
+        apply_blc(data + static_cast<std::size_t>(begin) * w, static_cast<std::size_t>(end - begin) * w, black_level);
+    });
+}
+
 } // namespace isp
\ No newline at end of file
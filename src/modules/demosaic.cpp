@@ -1,79 +1,513 @@
 #include "modules/demosaic.hpp"
-#include <omp.h>
+#include "demosaic_simd.hpp"
+#include "exec_context.hpp"
+#include "modules/awb.hpp"
+#include "simd.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <vector>
 
 namespace isp {
 
 namespace {
 
-// Safe pixel access with boundary clamping
-uint16_t get_pixel(const Image& img, int x, int y) {
-    x = std::max(0, std::min(x, img.width() - 1));
-    y = std::max(0, std::min(y, img.height() - 1));
-    return img.data()[static_cast<std::size_t>(y * img.width() + x)];
+// Column and row parity of the R sample in pattern P's 2x2 quad; B sits
+// diagonally opposite. Every pattern is RGGB shifted by this phase.
+template <BayerPattern P>
+struct BayerPhase {
+    static constexpr int red_x = (P == BayerPattern::RGGB || P == BayerPattern::GBRG) ? 0 : 1;
+    static constexpr int red_y = (P == BayerPattern::RGGB || P == BayerPattern::GRBG) ? 0 : 1;
+
+    static bool red_row(int y) { return (y & 1) == red_y; }
+};
+
+// Clamped scalar path for the columns next to the frame edge
+template <BayerPattern P>
+void demosaic_clamped(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out) {
+    const int last_col = window.frame_width - 1;
+    const bool red_row = BayerPhase<P>::red_row(y);
+
+    // Safe pixel access with column clamping (rows are clamped by the caller)
+    auto get_pixel = [&](int x, int dy) -> uint16_t {
+        x = std::max(0, std::min(x, last_col));
+        return window.rows[1 + dy][x - window.col0];
+    };
+
+    for (int x = x_begin; x < x_end; ++x) {
+        const bool red_col = (x & 1) == BayerPhase<P>::red_x;
+
+        Pixel p;
+        uint16_t center = get_pixel(x, 0);
+
+        if (red_row && red_col) {
+            // R pixel
+            p.r = center;
+            p.g = static_cast<uint16_t>((
+                get_pixel(x-1, 0) + get_pixel(x+1, 0) +
+                get_pixel(x, -1) + get_pixel(x, 1)) / 4);
+            p.b = static_cast<uint16_t>((
+                get_pixel(x-1, -1) + get_pixel(x+1, -1) +
+                get_pixel(x-1, 1) + get_pixel(x+1, 1)) / 4);
+        }
+        else if (red_row && !red_col) {
+            // G pixel on R row
+            p.g = center;
+            p.r = static_cast<uint16_t>((
+                get_pixel(x-1, 0) + get_pixel(x+1, 0)) / 2);
+            p.b = static_cast<uint16_t>((
+                get_pixel(x, -1) + get_pixel(x, 1)) / 2);
+        }
+        else if (!red_row && red_col) {
+            // G pixel on B row
+            p.g = center;
+            p.r = static_cast<uint16_t>((
+                get_pixel(x, -1) + get_pixel(x, 1)) / 2);
+            p.b = static_cast<uint16_t>((
+                get_pixel(x-1, 0) + get_pixel(x+1, 0)) / 2);
+        }
+        else {
+            // B pixel
+            p.b = center;
+            p.g = static_cast<uint16_t>((
+                get_pixel(x-1, 0) + get_pixel(x+1, 0) +
+                get_pixel(x, -1) + get_pixel(x, 1)) / 4);
+            p.r = static_cast<uint16_t>((
+                get_pixel(x-1, -1) + get_pixel(x+1, -1) +
+                get_pixel(x-1, 1) + get_pixel(x+1, 1)) / 4);
+        }
+
+        out[x - x_begin] = p;
+    }
+}
+
+// Unclamped scalar path for interior columns. Pixels are produced in
+// (even, odd) column pairs so the Bayer phase is fixed inside the loop.
+// RedRow: the row holds R samples (else B); RedEven: they are in even columns.
+template <bool RedRow, bool RedEven>
+void demosaic_interior_scalar(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                              int x, int count, Pixel* out) {
+    auto cross = [&](int i) {
+        return static_cast<uint16_t>((mid[i-1] + mid[i+1] + up[i] + down[i]) / 4);
+    };
+    auto diag = [&](int i) {
+        return static_cast<uint16_t>((up[i-1] + up[i+1] + down[i-1] + down[i+1]) / 4);
+    };
+    auto horiz = [&](int i) { return static_cast<uint16_t>((mid[i-1] + mid[i+1]) / 2); };
+    auto vert = [&](int i) { return static_cast<uint16_t>((up[i] + down[i]) / 2); };
+
+    // R's column: R on R rows, G on B rows. The other: G on R rows, B on B rows.
+    auto red_col = [&](int i) {
+        return RedRow ? Pixel{mid[i], cross(i), diag(i)} : Pixel{vert(i), mid[i], horiz(i)};
+    };
+    auto other_col = [&](int i) {
+        return RedRow ? Pixel{horiz(i), mid[i], vert(i)} : Pixel{diag(i), cross(i), mid[i]};
+    };
+    auto even_col = [&](int i) { return RedEven ? red_col(i) : other_col(i); };
+    auto odd_col = [&](int i) { return RedEven ? other_col(i) : red_col(i); };
+
+    int i = 0;
+    if (x % 2 != 0 && count > 0) {
+        out[0] = odd_col(0);
+        i = 1;
+    }
+    for (; i + 1 < count; i += 2) {
+        out[i] = even_col(i);
+        out[i + 1] = odd_col(i + 1);
+    }
+    if (i < count) {
+        out[i] = even_col(i);
+    }
+}
+
+template <bool RedEven>
+void demosaic_interior_scalar(bool red_row, const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                              int x, int count, Pixel* out) {
+    if (red_row) {
+        demosaic_interior_scalar<true, RedEven>(up, mid, down, x, count, out);
+    } else {
+        demosaic_interior_scalar<false, RedEven>(up, mid, down, x, count, out);
+    }
+}
+
+// Malvar-He-Cutler estimates at one site from tap(dx, dy), |dx|, |dy| <= 2.
+// The filters are the paper's, scaled by 16 so every weight is an integer.
+template <typename Tap>
+Pixel malvar_pixel(const Tap& tap, bool red_row, bool red_col, uint16_t max_value) {
+    const int c = tap(0, 0);
+    const int h1 = tap(-1, 0) + tap(1, 0);
+    const int v1 = tap(0, -1) + tap(0, 1);
+    const int h2 = tap(-2, 0) + tap(2, 0);
+    const int v2 = tap(0, -2) + tap(0, 2);
+    const int d = tap(-1, -1) + tap(1, -1) + tap(-1, 1) + tap(1, 1);
+    auto round = [&](int v) { return static_cast<uint16_t>(std::clamp((v + 8) >> 4, 0, int{max_value})); };
+    const auto center = static_cast<uint16_t>(c);
+
+    if (red_row == red_col) {
+        // R or B site: G from the cross, the opposite colour from the diagonals
+        const uint16_t g = round(8 * c + 4 * (h1 + v1) - 2 * (h2 + v2));
+        const uint16_t opposite = round(12 * c + 4 * d - 3 * (h2 + v2));
+        return red_row ? Pixel{center, g, opposite} : Pixel{opposite, g, center};
+    }
+    // G site: one colour sits left and right of it, the other above and below
+    const int c10 = 10 * c - 2 * d;
+    const uint16_t along = round(c10 + 8 * h1 - 2 * h2 + v2);
+    const uint16_t across = round(c10 + 8 * v1 - 2 * v2 + h2);
+    return red_row ? Pixel{along, center, across} : Pixel{across, center, along};
+}
+
+// Clamped Malvar path for the two columns next to each frame edge
+template <BayerPattern P>
+void malvar_clamped(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out,
+                    uint16_t max_value) {
+    const int last_col = window.frame_width - 1;
+    const bool red_row = BayerPhase<P>::red_row(y);
+    for (int x = x_begin; x < x_end; ++x) {
+        auto tap = [&](int dx, int dy) -> int {
+            return window.rows[2 + dy][std::clamp(x + dx, 0, last_col) - window.col0];
+        };
+        out[x - x_begin] = malvar_pixel(tap, red_row, (x & 1) == BayerPhase<P>::red_x, max_value);
+    }
+}
+
+// Unclamped scalar path; rows[0..4] point at the first output column
+void malvar_interior_scalar(const uint16_t* const* rows, bool red_row, bool red_even, int x, int count,
+                            Pixel* out, uint16_t max_value) {
+    for (int i = 0; i < count; ++i) {
+        auto tap = [&](int dx, int dy) -> int { return rows[2 + dy][i + dx]; };
+        out[i] = malvar_pixel(tap, red_row, ((x + i) & 1) == (red_even ? 0 : 1), max_value);
+    }
+}
+
+// Output row `oy` of demosaic_binned: sums whole quads, whose phase is the
+// pattern's because blocks start on even rows and columns
+template <BayerPattern P>
+void binned_row(const uint16_t* src, std::size_t stride, int factor, int oy, int out_width, Pixel* out) {
+    constexpr int rx = BayerPhase<P>::red_x;
+    constexpr int ry = BayerPhase<P>::red_y;
+    // Samples per block: factor^2 / 4 each of R and B, twice that of G
+    const int rb_shift = 2 * std::countr_zero(static_cast<unsigned>(factor)) - 2;
+    const int g_shift = rb_shift + 1;
+    const uint32_t rb_half = (1u << rb_shift) >> 1;
+    const uint32_t g_half = 1u << rb_shift;
+
+    const uint16_t* block_rows = src + static_cast<std::size_t>(oy) * static_cast<std::size_t>(factor) * stride;
+    if (factor == 2) {
+        // One quad per pixel, the common preview case: no inner loops
+        const uint16_t* red = block_rows + static_cast<std::size_t>(ry) * stride;
+        const uint16_t* blue = block_rows + static_cast<std::size_t>(1 - ry) * stride;
+        for (int ox = 0; ox < out_width; ++ox) {
+            const uint16_t* r = red + 2 * ox;
+            const uint16_t* b = blue + 2 * ox;
+            out[ox] = Pixel{r[rx], static_cast<uint16_t>((r[1 - rx] + b[rx] + 1) >> 1), b[1 - rx]};
+        }
+        return;
+    }
+    for (int ox = 0; ox < out_width; ++ox) {
+        const std::size_t x0 = static_cast<std::size_t>(ox) * static_cast<std::size_t>(factor);
+        uint32_t r = 0, g = 0, b = 0;
+        for (int dy = 0; dy < factor; dy += 2) {
+            const uint16_t* red = block_rows + static_cast<std::size_t>(dy + ry) * stride + x0;
+            const uint16_t* blue = block_rows + static_cast<std::size_t>(dy + 1 - ry) * stride + x0;
+            for (int dx = 0; dx < factor; dx += 2) {
+                r += red[dx + rx];
+                g += red[dx + 1 - rx] + blue[dx + rx];
+                b += blue[dx + 1 - rx];
+            }
+        }
+        out[ox] = Pixel{static_cast<uint16_t>((r + rb_half) >> rb_shift), static_cast<uint16_t>((g + g_half) >> g_shift),
+                        static_cast<uint16_t>((b + rb_half) >> rb_shift)};
+    }
+}
+
+template <BayerPattern P>
+void bilinear_row(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out, uint16_t) {
+    demosaic_row<P>(window, y, x_begin, x_end, out);
 }
 
 } // anonymous namespace
 
-RgbImage demosaic(const Image& raw) {
-    if (raw.pattern() != BayerPattern::RGGB) {
-        throw std::runtime_error("Only RGGB pattern is supported");
+bool parse_demosaic_method(const std::string& name, DemosaicMethod& method) {
+    if (name == "bilinear") method = DemosaicMethod::Bilinear;
+    else if (name == "mhc") method = DemosaicMethod::Malvar;
+    else return false;
+    return true;
+}
+
+template <BayerPattern P>
+void demosaic_row(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out) {
+    // Only the outermost columns need clamping; rows are clamped by the caller
+    const int interior_begin = std::max(x_begin, 1);
+    const int interior_end = std::min(x_end, window.frame_width - 1);
+    if (interior_begin >= interior_end) {
+        demosaic_clamped<P>(window, y, x_begin, x_end, out);
+        return;
     }
+    demosaic_clamped<P>(window, y, x_begin, interior_begin, out);
+    demosaic_clamped<P>(window, y, interior_end, x_end, out + (interior_end - x_begin));
 
-    const int w = raw.width();
-    const int h = raw.height();
-    RgbImage rgb(w, h, raw.bit_depth());
-
-    #pragma omp parallel for schedule(dynamic) 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            bool even_row = (y % 2 == 0);
-            bool even_col = (x % 2 == 0);
-
-            Pixel p;
-            uint16_t center = get_pixel(raw, x, y);
-
-            if (even_row && even_col) {
-                // R pixel
-                p.r = center;
-                p.g = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y) + get_pixel(raw, x+1, y) +
-                    get_pixel(raw, x, y-1) + get_pixel(raw, x, y+1)) / 4);
-                p.b = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y-1) + get_pixel(raw, x+1, y-1) +
-                    get_pixel(raw, x-1, y+1) + get_pixel(raw, x+1, y+1)) / 4);
+    constexpr bool red_even = BayerPhase<P>::red_x == 0;
+    const bool red_row = BayerPhase<P>::red_row(y);
+    const std::ptrdiff_t offset = interior_begin - window.col0;
+    const uint16_t* up = window.rows[0] + offset;
+    const uint16_t* mid = window.rows[1] + offset;
+    const uint16_t* down = window.rows[2] + offset;
+    Pixel* dst = out + (interior_begin - x_begin);
+    int x = interior_begin;
+
+    // Vector blocks start on an even column so every lane keeps its Bayer phase
+    const SimdLevel level = active_simd_level();
+    const int lanes = level == SimdLevel::AVX2 ? 16 : level == SimdLevel::SSE41 ? 8 : 0;
+    if (lanes > 0) {
+        const int lead = x % 2;
+        const int blocks = (interior_end - x - lead) / lanes * lanes;
+        if (blocks > 0) {
+            if (lead) {
+                demosaic_interior_scalar<red_even>(red_row, up, mid, down, x, 1, dst);
+                ++up; ++mid; ++down; ++dst; ++x;
             }
-            else if (even_row && !even_col) {
-                // G pixel on R row
-                p.g = center;
-                p.r = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y) + get_pixel(raw, x+1, y)) / 2);
-                p.b = static_cast<uint16_t>((
-                    get_pixel(raw, x, y-1) + get_pixel(raw, x, y+1)) / 2);
+#if defined(ISP_HAVE_AVX2)
+            if (level == SimdLevel::AVX2) {
+                detail::demosaic_interior_avx2(up, mid, down, red_row, red_even, blocks, dst);
             }
-            else if (!even_row && even_col) {
-                // G pixel on B row
-                p.g = center;
-                p.r = static_cast<uint16_t>((
-                    get_pixel(raw, x, y-1) + get_pixel(raw, x, y+1)) / 2);
-                p.b = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y) + get_pixel(raw, x+1, y)) / 2);
+#endif
+#if defined(ISP_HAVE_SSE41)
+            if (level == SimdLevel::SSE41) {
+                detail::demosaic_interior_sse41(up, mid, down, red_row, red_even, blocks, dst);
             }
-            else {
-                // B pixel
-                p.b = center;
-                p.g = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y) + get_pixel(raw, x+1, y) +
-                    get_pixel(raw, x, y-1) + get_pixel(raw, x, y+1)) / 4);
-                p.r = static_cast<uint16_t>((
-                    get_pixel(raw, x-1, y-1) + get_pixel(raw, x+1, y-1) +
-                    get_pixel(raw, x-1, y+1) + get_pixel(raw, x+1, y+1)) / 4);
+#endif
+            up += blocks; mid += blocks; down += blocks; dst += blocks; x += blocks;
+        }
+    }
+
+    demosaic_interior_scalar<red_even>(red_row, up, mid, down, x, interior_end - x, dst);
+}
+
+template <BayerPattern P>
+void demosaic_malvar_row(const RowWindow<uint16_t>& window, int y, int x_begin, int x_end, Pixel* out,
+                         uint16_t max_value) {
+    const int interior_begin = std::max(x_begin, 2);
+    const int interior_end = std::min(x_end, window.frame_width - 2);
+    if (interior_begin >= interior_end) {
+        malvar_clamped<P>(window, y, x_begin, x_end, out, max_value);
+        return;
+    }
+    malvar_clamped<P>(window, y, x_begin, interior_begin, out, max_value);
+    malvar_clamped<P>(window, y, interior_end, x_end, out + (interior_end - x_begin), max_value);
+
+    constexpr bool red_even = BayerPhase<P>::red_x == 0;
+    const bool red_row = BayerPhase<P>::red_row(y);
+    const uint16_t* rows[5];
+    for (int k = 0; k < 5; ++k) rows[k] = window.rows[k] + (interior_begin - window.col0);
+    Pixel* dst = out + (interior_begin - x_begin);
+    int x = interior_begin;
+
+    auto advance = [&](int n) {
+        for (auto& row : rows) row += n;
+        dst += n;
+        x += n;
+    };
+
+    // As for bilinear, vector blocks start on an even column
+    const SimdLevel level = active_simd_level();
+    const int lanes = level == SimdLevel::AVX2 ? 16 : level == SimdLevel::SSE41 ? 8 : 0;
+    if (lanes > 0) {
+        const int lead = x % 2;
+        const int blocks = (interior_end - x - lead) / lanes * lanes;
+        if (blocks > 0) {
+            if (lead) {
+                malvar_interior_scalar(rows, red_row, red_even, x, 1, dst, max_value);
+                advance(1);
+            }
+#if defined(ISP_HAVE_AVX2)
+            if (level == SimdLevel::AVX2) {
+                detail::malvar_interior_avx2(rows, red_row, red_even, blocks, dst, max_value);
             }
+#endif
+#if defined(ISP_HAVE_SSE41)
+            if (level == SimdLevel::SSE41) {
+                detail::malvar_interior_sse41(rows, red_row, red_even, blocks, dst, max_value);
+            }
+#endif
+            advance(blocks);
+        }
+    }
+
+    malvar_interior_scalar(rows, red_row, red_even, x, interior_end - x, dst, max_value);
+}
+
+template <BayerPattern P, typename T>
+void demosaic_row(const RowWindow<T>& window, int y, int x_begin, int x_end, T* out_r, T* out_g, T* out_b) {
+    const int last_col = window.frame_width - 1;
+    const bool red_row = BayerPhase<P>::red_row(y);
+    const T* up = window.rows[0] - window.col0;
+    const T* mid = window.rows[1] - window.col0;
+    const T* down = window.rows[2] - window.col0;
 
-            rgb.at(x, y) = p;
+    // Column taps are clamped to the frame, a no-op away from the edges
+    auto pixel_at = [&](int x) {
+        const int l = std::max(0, x - 1);
+        const int r = std::min(x + 1, last_col);
+        const T cross = static_cast<T>((mid[l] + mid[r] + up[x] + down[x]) / 4);
+        const T diag = static_cast<T>((up[l] + up[r] + down[l] + down[r]) / 4);
+        const T horiz = static_cast<T>((mid[l] + mid[r]) / 2);
+        const T vert = static_cast<T>((up[x] + down[x]) / 2);
+        const int i = x - x_begin;
+        if (red_row == ((x & 1) == BayerPhase<P>::red_x)) {
+            // R on R rows, B on B rows
+            out_r[i] = red_row ? mid[x] : diag;
+            out_g[i] = cross;
+            out_b[i] = red_row ? diag : mid[x];
+        } else {
+            // G sites
+            out_r[i] = red_row ? horiz : vert;
+            out_g[i] = mid[x];
+            out_b[i] = red_row ? vert : horiz;
         }
+    };
+
+    for (int x = x_begin; x < x_end; ++x) {
+        pixel_at(x);
+    }
+}
+
+#define ISP_INSTANTIATE_DEMOSAIC_ROW(P)                                                                    \
+    template void demosaic_row<P>(const RowWindow<uint16_t>&, int, int, int, Pixel*);                      \
+    template void demosaic_malvar_row<P>(const RowWindow<uint16_t>&, int, int, int, Pixel*, uint16_t);     \
+    template void demosaic_row<P, uint8_t>(const RowWindow<uint8_t>&, int, int, int, uint8_t*, uint8_t*,   \
+                                           uint8_t*);                                                      \
+    template void demosaic_row<P, uint16_t>(const RowWindow<uint16_t>&, int, int, int, uint16_t*, uint16_t*, \
+                                            uint16_t*);
+ISP_INSTANTIATE_DEMOSAIC_ROW(BayerPattern::RGGB)
+ISP_INSTANTIATE_DEMOSAIC_ROW(BayerPattern::BGGR)
+ISP_INSTANTIATE_DEMOSAIC_ROW(BayerPattern::GRBG)
+ISP_INSTANTIATE_DEMOSAIC_ROW(BayerPattern::GBRG)
+#undef ISP_INSTANTIATE_DEMOSAIC_ROW
+
+DemosaicRowFn demosaic_row_for(BayerPattern pattern, DemosaicMethod method) {
+    return dispatch_bayer_pattern(pattern, [&](auto p) -> DemosaicRowFn {
+        if (method == DemosaicMethod::Malvar) return &demosaic_malvar_row<decltype(p)::value>;
+        return &bilinear_row<decltype(p)::value>;
+    });
+}
+
+RgbImage demosaic(const Image& raw, DemosaicMethod method) {
+    RgbImage rgb;
+    demosaic(raw, rgb, nullptr, nullptr, method);
+    return rgb;
+}
+
+void demosaic(const Image& raw, RgbImage& rgb, const PointLut* lut, ChannelSums* sums, DemosaicMethod method) {
+    const int w = raw.width();
+    const int h = raw.height();
+    if (rgb.width() != w || rgb.height() != h || rgb.bit_depth() != raw.bit_depth()) {
+        rgb = RgbImage(w, h, raw.bit_depth());
     }
 
+    const uint16_t* src = raw.data().data();
+    Pixel* dst = rgb.data().data();
+    const std::size_t stride = static_cast<std::size_t>(w);
+    const int radius = demosaic_radius(method);
+    const bool malvar = method == DemosaicMethod::Malvar;
+    const uint16_t max_value = rgb.max_value();
+
+    const auto trace_frame = ISP_TRACE_CURRENT_FRAME;
+    dispatch_bayer_pattern(raw.pattern(), [&](auto pattern) {
+        const ChannelSums frame = parallel_sum(h, ChannelSums{}, [&](int begin, int end) {
+            // This task's rows; gaps between the spans show uneven shares
+            ISP_TRACE_SCOPE_IN_FRAME("Demosaic rows", "rows", trace_frame);
+            ChannelSums part;
+            for (int y = begin; y < end; ++y) {
+                const uint16_t* rows[5];
+                gather_rows(src, stride, 0, y, radius, h, rows);
+                const RowWindow<uint16_t> window{rows, 0, w};
+                Pixel* out = dst + static_cast<std::size_t>(y) * stride;
+                if (malvar) {
+                    demosaic_malvar_row<decltype(pattern)::value>(window, y, 0, w, out, max_value);
+                } else {
+                    demosaic_row<decltype(pattern)::value>(window, y, 0, w, out);
+                }
+                if (sums) add_channel_sums(out, stride, part);
+                if (lut) lut->apply(out, stride);
+            }
+            return part;
+        });
+        if (sums) *sums += frame;
+    });
+}
+
+RgbImage demosaic_binned(const Image& raw, int factor) {
+    RgbImage rgb;
+    demosaic_binned(raw, rgb, factor);
+    return rgb;
+}
+
+void demosaic_binned(const Image& raw, RgbImage& rgb, int factor, const PointLut* lut, ChannelSums* sums) {
+    if (factor < 2 || !std::has_single_bit(static_cast<unsigned>(factor))) {
+        throw std::invalid_argument("Binning factor must be a power of two >= 2");
+    }
+    const int w = raw.width() / factor;
+    const int h = raw.height() / factor;
+    if (w <= 0 || h <= 0) {
+        throw std::invalid_argument("Frame is smaller than one binning block");
+    }
+    if (rgb.width() != w || rgb.height() != h || rgb.bit_depth() != raw.bit_depth()) {
+        rgb = RgbImage(w, h, raw.bit_depth());
+    }
+
+    const uint16_t* src = raw.data().data();
+    const std::size_t src_stride = static_cast<std::size_t>(raw.width());
+    Pixel* dst = rgb.data().data();
+    const std::size_t stride = static_cast<std::size_t>(w);
+
+    dispatch_bayer_pattern(raw.pattern(), [&](auto pattern) {
+        const ChannelSums frame = parallel_sum(h, ChannelSums{}, [&](int begin, int end) {
+            ChannelSums part;
+            for (int y = begin; y < end; ++y) {
+                Pixel* out = dst + static_cast<std::size_t>(y) * stride;
+                binned_row<decltype(pattern)::value>(src, src_stride, factor, y, w, out);
+                if (sums) add_channel_sums(out, stride, part);
+                if (lut) lut->apply(out, stride);
+            }
+            return part;
+        });
+        if (sums) *sums += frame;
+    });
+}
+
+PlanarRgbImage demosaic_planar(const Image& raw, DemosaicMethod method) {
+    const int w = raw.width();
+    const int h = raw.height();
+    PlanarRgbImage rgb(w, h, raw.bit_depth());
+
+    const uint16_t* src = raw.data().data();
+    const std::size_t stride = static_cast<std::size_t>(w);
+    const int radius = demosaic_radius(method);
+    const uint16_t max_value = rgb.max_value();
+
+    const DemosaicRowFn demosaic_fn = demosaic_row_for(raw.pattern(), method);
+    parallel_for(h, [&](int begin, int end) {
+        // One interleaved row, split into the planes while it is still in L1
+        std::vector<Pixel> row(stride);
+
+        for (int y = begin; y < end; ++y) {
+            const uint16_t* rows[5];
+            gather_rows(src, stride, 0, y, radius, h, rows);
+            demosaic_fn(RowWindow<uint16_t>{rows, 0, w}, y, 0, w, row.data(), max_value);
+
+            uint16_t* r = rgb.row(0, y);
+            uint16_t* g = rgb.row(1, y);
+            uint16_t* b = rgb.row(2, y);
+            for (int x = 0; x < w; ++x) {
+                r[x] = row[static_cast<std::size_t>(x)].r;
+                g[x] = row[static_cast<std::size_t>(x)].g;
+                b[x] = row[static_cast<std::size_t>(x)].b;
+            }
+        }
+    });
+
     return rgb;
 }
 
-} // namespace isp
\ No newline at end of file
+} // namespace isp
@@ -0,0 +1,65 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "demosaic_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256i;
+    static constexpr int kLanes = 16;
+
+    static V load(const uint16_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+    static V xor_(V a, V b) { return _mm256_xor_si256(a, b); }
+    static V add(V a, V b) { return _mm256_add_epi16(a, b); }
+    static V shr1(V a) { return _mm256_srli_epi16(a, 1); }
+    static V one() { return _mm256_set1_epi16(1); }
+    static V pick(V even, V odd) { return _mm256_blend_epi16(even, odd, 0xAA); }
+
+    static V set1_32(uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+    static V or_(V a, V b) { return _mm256_or_si256(a, b); }
+    static V add32(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V sub32(V a, V b) { return _mm256_sub_epi32(a, b); }
+    static V shl32(V a, int n) { return _mm256_slli_epi32(a, n); }
+    static V sra32(V a, int n) { return _mm256_srai_epi32(a, n); }
+    static V srl32(V a, int n) { return _mm256_srli_epi32(a, n); }
+    static V min32(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max32(V a, V b) { return _mm256_max_epi32(a, b); }
+
+    static V mask(int k, int c) {
+        return _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(kRgbShuffle.bytes[k][c])));
+    }
+
+    // vpshufb works per 128-bit lane, so each lane interleaves its own 8
+    // pixels into three 128-bit blocks; the blocks are then paired up in
+    // output order for three full-width stores
+    static void store_rgb(Pixel* out, V r, V g, V b) {
+        V block[3];
+        for (int k = 0; k < 3; ++k) {
+            block[k] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, mask(k, 0)),
+                                                       _mm256_shuffle_epi8(g, mask(k, 1))),
+                                       _mm256_shuffle_epi8(b, mask(k, 2)));
+        }
+        __m256i* dst = reinterpret_cast<__m256i*>(out);
+        _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(block[0], block[1], 0x20));
+        _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(block[2], block[0], 0x30));
+        _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(block[1], block[2], 0x31));
+    }
+};
+
+} // anonymous namespace
+
+void demosaic_interior_avx2(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                            bool red_row, bool red_even, int count, Pixel* out) {
+    demosaic_interior<Avx2Ops>(up, mid, down, red_row, red_even, count, out);
+}
+
+void malvar_interior_avx2(const uint16_t* const* rows, bool red_row, bool red_even, int count, Pixel* out,
+                          uint16_t max_value) {
+    malvar_interior<Avx2Ops>(rows, red_row, red_even, count, out, max_value);
+}
+
+} // namespace isp::detail
\ No newline at end of file
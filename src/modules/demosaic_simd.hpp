@@ -0,0 +1,257 @@
+#ifndef ISP_PIPELINE_MODULES_DEMOSAIC_SIMD_HPP
+#define ISP_PIPELINE_MODULES_DEMOSAIC_SIMD_HPP
+
+// Vectorized bilinear and Malvar-He-Cutler demosaic for interior columns,
+// shared by the SSE4.1 and AVX2 builds. Each translation unit supplies an
+// Ops struct for its instruction set and instantiates demosaic_interior<Ops>
+// and malvar_interior<Ops> under the matching compiler flags.
+
+#include "rgb_image.hpp"
+#include <cstdint>
+
+namespace isp::detail {
+
+// up/mid/down point at the first output column, which must be even and at
+// least one column inside the frame; count is a multiple of the lane count.
+// `red_row`: the row holds R (else B) samples. `red_even`: R sits in even
+// columns, which with `red_row` fixes the pattern's phase for the row.
+void demosaic_interior_sse41(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                             bool red_row, bool red_even, int count, Pixel* out);
+void demosaic_interior_avx2(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                            bool red_row, bool red_even, int count, Pixel* out);
+
+// rows[0..4] are raw rows y-2 .. y+2, pointing at the first output column,
+// which must be even and at least two columns inside the frame; count is a
+// multiple of the lane count. Results are clamped to [0, max_value].
+void malvar_interior_sse41(const uint16_t* const* rows, bool red_row, bool red_even, int count, Pixel* out,
+                           uint16_t max_value);
+void malvar_interior_avx2(const uint16_t* const* rows, bool red_row, bool red_even, int count, Pixel* out,
+                          uint16_t max_value);
+
+// Ops must provide:
+//   V, kLanes, load(p), and_(a, b), xor_(a, b), add(a, b), shr1(a), one(),
+//   pick(even, odd) -> even lanes of `even`, odd lanes of `odd`,
+//   store_rgb(out, r, g, b) -> interleave kLanes pixels into `out`
+// and, for Malvar, on 32-bit lanes:
+//   set1_32(v), or_(a, b), add32(a, b), sub32(a, b), shl32(a, n), sra32(a, n),
+//   srl32(a, n), min32(a, b), max32(a, b)
+template <typename Ops>
+struct DemosaicVec {
+    using V = typename Ops::V;
+
+    // floor((a + b) / 2) without leaving 16-bit lanes
+    static V avg2(V a, V b) {
+        return Ops::add(Ops::and_(a, b), Ops::shr1(Ops::xor_(a, b)));
+    }
+
+    // floor((a + b + c + d) / 4), exact for the full 16-bit range:
+    // halve each pair, then average the halves and add back the carry
+    // from the two dropped low bits
+    static V avg4(V a, V b, V c, V d) {
+        const V ab = Ops::xor_(a, b);
+        const V cd = Ops::xor_(c, d);
+        const V hs = Ops::add(Ops::and_(a, b), Ops::shr1(ab));
+        const V ht = Ops::add(Ops::and_(c, d), Ops::shr1(cd));
+        const V carry = Ops::and_(Ops::and_(ab, cd), Ops::one());
+        const V st = Ops::xor_(hs, ht);
+        return Ops::add(Ops::add(Ops::and_(hs, ht), Ops::shr1(st)), Ops::and_(st, carry));
+    }
+};
+
+template <typename Ops, bool RedRow, bool RedEven>
+void demosaic_interior_phase(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                             int count, Pixel* out) {
+    using V = typename Ops::V;
+    using Vec = DemosaicVec<Ops>;
+    constexpr int L = Ops::kLanes;
+
+    for (int i = 0; i < count; i += L) {
+        const V c  = Ops::load(mid + i);
+        const V l  = Ops::load(mid + i - 1);
+        const V rt = Ops::load(mid + i + 1);
+        const V u  = Ops::load(up + i);
+        const V d  = Ops::load(down + i);
+
+        const V horiz = Vec::avg2(l, rt);
+        const V vert  = Vec::avg2(u, d);
+        const V cross = Vec::avg4(l, rt, u, d);
+        const V diag  = Vec::avg4(Ops::load(up + i - 1), Ops::load(up + i + 1),
+                                  Ops::load(down + i - 1), Ops::load(down + i + 1));
+
+        // Sites in the R sample's column (R, or G on a B row) and in the other one
+        const V site_r = RedRow ? c : vert;
+        const V site_g = RedRow ? cross : c;
+        const V site_b = RedRow ? diag : horiz;
+        const V other_r = RedRow ? horiz : diag;
+        const V other_g = RedRow ? c : cross;
+        const V other_b = RedRow ? vert : c;
+        if constexpr (RedEven) {
+            Ops::store_rgb(out + i, Ops::pick(site_r, other_r), Ops::pick(site_g, other_g),
+                           Ops::pick(site_b, other_b));
+        } else {
+            Ops::store_rgb(out + i, Ops::pick(other_r, site_r), Ops::pick(other_g, site_g),
+                           Ops::pick(other_b, site_b));
+        }
+    }
+}
+
+// One branch per row segment picks the phase; the loop itself has none
+template <typename Ops>
+void demosaic_interior(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                       bool red_row, bool red_even, int count, Pixel* out) {
+    if (red_row) {
+        if (red_even) demosaic_interior_phase<Ops, true, true>(up, mid, down, count, out);
+        else          demosaic_interior_phase<Ops, true, false>(up, mid, down, count, out);
+    } else {
+        if (red_even) demosaic_interior_phase<Ops, false, true>(up, mid, down, count, out);
+        else          demosaic_interior_phase<Ops, false, false>(up, mid, down, count, out);
+    }
+}
+
+// Malvar-He-Cutler filters (see malvar_pixel in demosaic.cpp). A 16-bit
+// load read as 32-bit lanes holds an even column in the low half of each
+// lane and the odd column after it in the high half. Masking and shifting
+// split them into two vectors of 32-bit lanes, wide enough for the
+// weighted sums and signed for the negative taps, and each vector only
+// runs the two filters its Bayer sites need.
+template <typename Ops>
+struct MalvarVec {
+    using V = typename Ops::V;
+
+    // Sums of the taps around one site, in 32-bit lanes
+    struct Taps {
+        V c, h1, v1, h2, v2, d;
+    };
+
+    // (v + 8) >> 4, clamped to [0, max]
+    static V round(V v, V bias, V max) {
+        return Ops::min32(Ops::max32(Ops::sra32(Ops::add32(v, bias), 4), Ops::set1_32(0)), max);
+    }
+
+    // R or B site: G, then the opposite colour
+    static void rb_site(const Taps& t, V bias, V max, V& g, V& opposite) {
+        const V hv2 = Ops::add32(t.h2, t.v2);
+        // 8c + 4(h1 + v1) - 2(h2 + v2)
+        g = round(Ops::sub32(Ops::shl32(Ops::add32(Ops::add32(t.c, t.c), Ops::add32(t.h1, t.v1)), 2),
+                             Ops::shl32(hv2, 1)), bias, max);
+        // 12c + 4d - 3(h2 + v2)
+        opposite = round(Ops::sub32(Ops::shl32(Ops::add32(Ops::add32(Ops::shl32(t.c, 1), t.c), t.d), 2),
+                                    Ops::add32(Ops::shl32(hv2, 1), hv2)), bias, max);
+    }
+
+    // G site: the colour left and right of it, then the one above and below
+    static void g_site(const Taps& t, V bias, V max, V& along, V& across) {
+        // 10c - 2d, then + 8h1 - 2h2 + v2 or + 8v1 - 2v2 + h2
+        const V c10 = Ops::shl32(Ops::sub32(Ops::add32(Ops::shl32(t.c, 2), t.c), t.d), 1);
+        along = round(Ops::add32(Ops::add32(c10, t.v2), Ops::shl32(Ops::sub32(Ops::shl32(t.h1, 2), t.h2), 1)),
+                      bias, max);
+        across = round(Ops::add32(Ops::add32(c10, t.h2), Ops::shl32(Ops::sub32(Ops::shl32(t.v1, 2), t.v2), 1)),
+                       bias, max);
+    }
+
+    // Even columns in the low halves, odd columns in the high halves
+    static V merge(V even, V odd) { return Ops::or_(even, Ops::shl32(odd, 16)); }
+};
+
+template <typename Ops, bool RedRow, bool RedEven>
+void malvar_interior_phase(const uint16_t* const* rows, int count, Pixel* out, uint16_t max_value) {
+    using V = typename Ops::V;
+    using M = MalvarVec<Ops>;
+    using Taps = typename M::Taps;
+    constexpr int L = Ops::kLanes;
+
+    const V max = Ops::set1_32(max_value);
+    const V bias = Ops::set1_32(8);
+    const V low = Ops::set1_32(0xFFFF);
+    auto lo = [&](V v) { return Ops::and_(v, low); };
+    auto hi = [](V v) { return Ops::srl32(v, 16); };
+
+    const uint16_t* const n2 = rows[0];
+    const uint16_t* const n1 = rows[1];
+    const uint16_t* const mid = rows[2];
+    const uint16_t* const s1 = rows[3];
+    const uint16_t* const s2 = rows[4];
+
+    for (int i = 0; i < count; i += L) {
+        // Column pairs starting 2 left of, at, and 2 right of each even column
+        const V m_l = Ops::load(mid + i - 2), m = Ops::load(mid + i), m_r = Ops::load(mid + i + 2);
+        const V n_l = Ops::load(n1 + i - 2), n = Ops::load(n1 + i), n_r = Ops::load(n1 + i + 2);
+        const V s_l = Ops::load(s1 + i - 2), s = Ops::load(s1 + i), s_r = Ops::load(s1 + i + 2);
+        const V nn = Ops::load(n2 + i), ss = Ops::load(s2 + i);
+
+        const Taps even{lo(m),
+                        Ops::add32(hi(m_l), hi(m)),
+                        Ops::add32(lo(n), lo(s)),
+                        Ops::add32(lo(m_l), lo(m_r)),
+                        Ops::add32(lo(nn), lo(ss)),
+                        Ops::add32(Ops::add32(hi(n_l), hi(n)), Ops::add32(hi(s_l), hi(s)))};
+        const Taps odd{hi(m),
+                       Ops::add32(lo(m), lo(m_r)),
+                       Ops::add32(hi(n), hi(s)),
+                       Ops::add32(hi(m_l), hi(m_r)),
+                       Ops::add32(hi(nn), hi(ss)),
+                       Ops::add32(Ops::add32(lo(n), lo(n_r)), Ops::add32(lo(s), lo(s_r)))};
+
+        // The R sample's column holds R sites on R rows and G sites on B
+        // rows; the other column G sites on R rows and B sites on B rows
+        const Taps& red_col = RedEven ? even : odd;
+        const Taps& other_col = RedEven ? odd : even;
+        V site_r, site_g, site_b, other_r, other_g, other_b;
+        if constexpr (RedRow) {
+            site_r = red_col.c;
+            M::rb_site(red_col, bias, max, site_g, site_b);
+            other_g = other_col.c;
+            M::g_site(other_col, bias, max, other_r, other_b);
+        } else {
+            site_g = red_col.c;
+            M::g_site(red_col, bias, max, site_b, site_r);
+            other_b = other_col.c;
+            M::rb_site(other_col, bias, max, other_g, other_r);
+        }
+        if constexpr (RedEven) {
+            Ops::store_rgb(out + i, M::merge(site_r, other_r), M::merge(site_g, other_g), M::merge(site_b, other_b));
+        } else {
+            Ops::store_rgb(out + i, M::merge(other_r, site_r), M::merge(other_g, site_g), M::merge(other_b, site_b));
+        }
+    }
+}
+
+template <typename Ops>
+void malvar_interior(const uint16_t* const* rows, bool red_row, bool red_even, int count, Pixel* out,
+                     uint16_t max_value) {
+    if (red_row) {
+        if (red_even) malvar_interior_phase<Ops, true, true>(rows, count, out, max_value);
+        else          malvar_interior_phase<Ops, true, false>(rows, count, out, max_value);
+    } else {
+        if (red_even) malvar_interior_phase<Ops, false, true>(rows, count, out, max_value);
+        else          malvar_interior_phase<Ops, false, false>(rows, count, out, max_value);
+    }
+}
+
+// pshufb masks that scatter 8 planar words into three registers of
+// interleaved RGB words. kRgbShuffle.bytes[k][c] builds output register k from
+// channel c (0 = R, 1 = G, 2 = B); 0x80 bytes are zeroed.
+struct RgbShuffle {
+    alignas(16) uint8_t bytes[3][3][16];
+
+    constexpr RgbShuffle() : bytes{} {
+        for (int k = 0; k < 3; ++k) {
+            for (int pos = 0; pos < 8; ++pos) {
+                const int word = k * 8 + pos;    // index in r0 g0 b0 r1 g1 b1 ...
+                const int pixel = word / 3;
+                const int channel = word % 3;
+                for (int c = 0; c < 3; ++c) {
+                    const bool hit = (c == channel);
+                    bytes[k][c][2 * pos] = hit ? static_cast<uint8_t>(2 * pixel) : 0x80;
+                    bytes[k][c][2 * pos + 1] = hit ? static_cast<uint8_t>(2 * pixel + 1) : 0x80;
+                }
+            }
+        }
+    }
+};
+
+inline constexpr RgbShuffle kRgbShuffle{};
+
+} // namespace isp::detail
+
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+// Built with -msse4.1; only called when the CPU reports SSE4.1 support
+#include "demosaic_simd.hpp"
+#include <smmintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Sse41Ops {
+    using V = __m128i;
+    static constexpr int kLanes = 8;
+
+    static V load(const uint16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static V and_(V a, V b) { return _mm_and_si128(a, b); }
+    static V xor_(V a, V b) { return _mm_xor_si128(a, b); }
+    static V add(V a, V b) { return _mm_add_epi16(a, b); }
+    static V shr1(V a) { return _mm_srli_epi16(a, 1); }
+    static V one() { return _mm_set1_epi16(1); }
+    static V pick(V even, V odd) { return _mm_blend_epi16(even, odd, 0xAA); }
+
+    static V set1_32(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+    static V or_(V a, V b) { return _mm_or_si128(a, b); }
+    static V add32(V a, V b) { return _mm_add_epi32(a, b); }
+    static V sub32(V a, V b) { return _mm_sub_epi32(a, b); }
+    static V shl32(V a, int n) { return _mm_slli_epi32(a, n); }
+    static V sra32(V a, int n) { return _mm_srai_epi32(a, n); }
+    static V srl32(V a, int n) { return _mm_srli_epi32(a, n); }
+    static V min32(V a, V b) { return _mm_min_epi32(a, b); }
+    static V max32(V a, V b) { return _mm_max_epi32(a, b); }
+
+    static V mask(int k, int c) {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(kRgbShuffle.bytes[k][c]));
+    }
+
+    static void store_rgb(Pixel* out, V r, V g, V b) {
+        __m128i* dst = reinterpret_cast<__m128i*>(out);
+        for (int k = 0; k < 3; ++k) {
+            const V v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, mask(k, 0)),
+                                                  _mm_shuffle_epi8(g, mask(k, 1))),
+                                     _mm_shuffle_epi8(b, mask(k, 2)));
+            _mm_storeu_si128(dst + k, v);
+        }
+    }
+};
+
+} // anonymous namespace
+
+void demosaic_interior_sse41(const uint16_t* up, const uint16_t* mid, const uint16_t* down,
+                             bool red_row, bool red_even, int count, Pixel* out) {
+    demosaic_interior<Sse41Ops>(up, mid, down, red_row, red_even, count, out);
+}
+
+void malvar_interior_sse41(const uint16_t* const* rows, bool red_row, bool red_even, int count, Pixel* out,
+                           uint16_t max_value) {
+    malvar_interior<Sse41Ops>(rows, red_row, red_even, count, out, max_value);
+}
+
+} // namespace isp::detail
\ No newline at end of file
@@ -1,71 +1,334 @@
 #include "modules/denoise.hpp"
+#include "denoise_simd.hpp"
+#include "line_buffer.hpp"
+#include "simd.hpp"
 #include <cmath>
 #include <algorithm>
-#include <omp.h>
 
 namespace isp {
 
-void apply_denoise(RgbImage& img, float sigma_spatial, float sigma_range) {
-    const int w = img.width();
-    const int h = img.height();
-    const uint16_t max_val = img.max_value();
-    
-    // Kernel radius based on sigma_spatial
-    const int radius = static_cast<int>(std::ceil(2.0f * sigma_spatial));
-    
-    // Pre-compute spatial weights
-    const float spatial_coeff = -0.5f / (sigma_spatial * sigma_spatial);
-    const float range_coeff = -0.5f / (sigma_range * sigma_range);
-    
-    // Make a copy for reading
-    std::vector<Pixel> original = img.data();
-    
-    auto get = [&](int x, int y) -> const Pixel& {
-        x = std::max(0, std::min(x, w - 1));
-        y = std::max(0, std::min(y, h - 1));
-        return original[static_cast<std::size_t>(y * w + x)];
+namespace {
+
+// exp(-17) < 2^-24: past this the range weight is lost next to the centre's 1.0
+constexpr float kRangeCutoff = 17.0f;
+constexpr std::size_t kMaxRangeEntries = 65536;
+
+// Planar float scratch for the interior path, reused across rows
+struct DenoiseScratch {
+    std::vector<float> planes;
+    std::vector<const float*> rows;
+    std::vector<float> out;
+};
+
+DenoiseScratch& thread_scratch() {
+    thread_local DenoiseScratch scratch;
+    return scratch;
+}
+
+float lookup_range(const DenoiseKernel& kernel, float color_dist) {
+    const float index = std::min(color_dist * kernel.range_scale(), kernel.range_max_index());
+    return kernel.range_table()[static_cast<std::size_t>(index)];
+}
+
+uint16_t to_output(float sum, float sum_weight, uint16_t max_val) {
+    return static_cast<uint16_t>(std::clamp(sum / sum_weight, 0.0f, static_cast<float>(max_val)));
+}
+
+// Row sources for the shared kernel: load(k, x) returns frame column x of
+// window row k as a Pixel
+struct InterleavedRows {
+    const RowWindow<Pixel>& window;
+    int frame_width() const { return window.frame_width; }
+    const Pixel& load(int k, int x) const { return window.rows[k][x - window.col0]; }
+};
+
+struct PlanarRows {
+    const RowWindow<uint16_t>& r;
+    const RowWindow<uint16_t>& g;
+    const RowWindow<uint16_t>& b;
+    int frame_width() const { return r.frame_width; }
+    Pixel load(int k, int x) const {
+        return Pixel{r.rows[k][x - r.col0], g.rows[k][x - g.col0], b.rows[k][x - b.col0]};
+    }
+};
+
+// Clamped scalar path for columns within `radius` of the frame edge.
+// store(i, r, g, b) writes output index i (frame column x_begin + i).
+template <typename Rows, typename Store>
+void denoise_clamped(const Rows& src, int x_begin, int x_end, Store&& store,
+                     const DenoiseKernel& kernel, uint16_t max_val) {
+    const int radius = kernel.radius();
+    const int taps = 2 * radius + 1;
+    const int last_col = src.frame_width() - 1;
+
+    auto get = [&](int x, int dy) -> Pixel {
+        x = std::max(0, std::min(x, last_col));
+        return src.load(radius + dy, x);
     };
-    
-    #pragma omp parallel for schedule(dynamic)
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            const Pixel& center = get(x, y);
-            
-            float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
-            float sum_weight = 0.0f;
-            
-            for (int dy = -radius; dy <= radius; ++dy) {
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    const Pixel& neighbor = get(x + dx, y + dy);
-                    
-                    // Spatial weight
-                    float spatial_dist = static_cast<float>(dx * dx + dy * dy);
-                    float spatial_weight = std::exp(spatial_dist * spatial_coeff);
-                    
-                    // Range weight (color similarity)
-                    float dr = static_cast<float>(neighbor.r) - static_cast<float>(center.r);
-                    float dg = static_cast<float>(neighbor.g) - static_cast<float>(center.g);
-                    float db = static_cast<float>(neighbor.b) - static_cast<float>(center.b);
-                    float color_dist = dr * dr + dg * dg + db * db;
-                    float range_weight = std::exp(color_dist * range_coeff);
-                    
-                    // Combined weight
-                    float weight = spatial_weight * range_weight;
-                    
-                    sum_r += weight * static_cast<float>(neighbor.r);
-                    sum_g += weight * static_cast<float>(neighbor.g);
-                    sum_b += weight * static_cast<float>(neighbor.b);
-                    sum_weight += weight;
-                }
+
+    for (int x = x_begin; x < x_end; ++x) {
+        const Pixel center = get(x, 0);
+
+        float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
+        float sum_weight = 0.0f;
+
+        for (int dy = -radius; dy <= radius; ++dy) {
+            const float* spatial = kernel.spatial_table() + (dy + radius) * taps + radius;
+            for (int dx = -radius; dx <= radius; ++dx) {
+                const Pixel neighbor = get(x + dx, dy);
+
+                // Range weight (color similarity)
+                float dr = static_cast<float>(neighbor.r) - static_cast<float>(center.r);
+                float dg = static_cast<float>(neighbor.g) - static_cast<float>(center.g);
+                float db = static_cast<float>(neighbor.b) - static_cast<float>(center.b);
+                float color_dist = dr * dr + dg * dg + db * db;
+
+                // Combined weight
+                float weight = spatial[dx] * lookup_range(kernel, color_dist);
+
+                sum_r += weight * static_cast<float>(neighbor.r);
+                sum_g += weight * static_cast<float>(neighbor.g);
+                sum_b += weight * static_cast<float>(neighbor.b);
+                sum_weight += weight;
             }
-            
-            // Normalize
-            Pixel& out = img.at(x, y);
-            out.r = static_cast<uint16_t>(std::clamp(sum_r / sum_weight, 0.0f, static_cast<float>(max_val)));
-            out.g = static_cast<uint16_t>(std::clamp(sum_g / sum_weight, 0.0f, static_cast<float>(max_val)));
-            out.b = static_cast<uint16_t>(std::clamp(sum_b / sum_weight, 0.0f, static_cast<float>(max_val)));
         }
+
+        // Normalize
+        store(x - x_begin, to_output(sum_r, sum_weight, max_val), to_output(sum_g, sum_weight, max_val),
+              to_output(sum_b, sum_weight, max_val));
+    }
+}
+
+// Unclamped scalar path over the planar copy; same tap order as the SIMD kernels
+void denoise_interior_scalar(const detail::DenoisePlanes& planes, const DenoiseKernel& kernel,
+                             int begin, int end, float* out_r, float* out_g, float* out_b) {
+    const int radius = kernel.radius();
+    const int taps = 2 * radius + 1;
+
+    for (int i = begin; i < end; ++i) {
+        const float cr = planes.r[radius][i];
+        const float cg = planes.g[radius][i];
+        const float cb = planes.b[radius][i];
+
+        float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
+        float sum_weight = 0.0f;
+
+        for (int k = 0; k < taps; ++k) {
+            const float* spatial = kernel.spatial_table() + k * taps + radius;
+            for (int dx = -radius; dx <= radius; ++dx) {
+                const float nr = planes.r[k][i + dx];
+                const float ng = planes.g[k][i + dx];
+                const float nb = planes.b[k][i + dx];
+
+                float dr = nr - cr;
+                float dg = ng - cg;
+                float db = nb - cb;
+                float color_dist = dr * dr + dg * dg + db * db;
+
+                float weight = spatial[dx] * lookup_range(kernel, color_dist);
+
+                sum_r += weight * nr;
+                sum_g += weight * ng;
+                sum_b += weight * nb;
+                sum_weight += weight;
+            }
+        }
+
+        out_r[i] = sum_r / sum_weight;
+        out_g[i] = sum_g / sum_weight;
+        out_b[i] = sum_b / sum_weight;
+    }
+}
+
+} // anonymous namespace
+
+int denoise_radius(float sigma_spatial) {
+    return static_cast<int>(std::ceil(2.0f * sigma_spatial));
+}
+
+DenoiseKernel::DenoiseKernel(float sigma_spatial, float sigma_range)
+    : sigma_spatial_(sigma_spatial)
+    , sigma_range_(sigma_range)
+    , radius_(std::max(0, denoise_radius(sigma_spatial)))
+{
+    const int taps = 2 * radius_ + 1;
+    const float spatial_coeff = -0.5f / (sigma_spatial * sigma_spatial);
+    const float range_coeff = -0.5f / (sigma_range * sigma_range);
+
+    // Spatial weights depend only on (dx, dy)
+    spatial_.resize(static_cast<std::size_t>(taps * taps));
+    for (int dy = -radius_; dy <= radius_; ++dy) {
+        for (int dx = -radius_; dx <= radius_; ++dx) {
+            float spatial_dist = static_cast<float>(dx * dx + dy * dy);
+            spatial_[static_cast<std::size_t>((dy + radius_) * taps + dx + radius_)] =
+                std::exp(spatial_dist * spatial_coeff);
+        }
+    }
+
+    // Range weights depend only on the squared color distance. Keep one
+    // entry per integer distance up to the cutoff when it fits; otherwise
+    // sample bucket centres.
+    const double cutoff = std::ceil(kRangeCutoff * 2.0 * static_cast<double>(sigma_range) * sigma_range);
+    std::size_t entries = static_cast<std::size_t>(std::max(1.0, cutoff));
+    if (entries + 1 > kMaxRangeEntries) {
+        entries = kMaxRangeEntries - 1;
+        range_scale_ = static_cast<float>(static_cast<double>(entries) / cutoff);
+    }
+
+    range_.resize(entries + 1);
+    for (std::size_t i = 0; i < entries; ++i) {
+        float color_dist = exact_range()
+            ? static_cast<float>(i)
+            : static_cast<float>((static_cast<double>(i) + 0.5) / range_scale_);
+        range_[i] = std::exp(color_dist * range_coeff);
+    }
+    range_[entries] = 0.0f;
+}
+
+namespace {
+
+template <typename Rows, typename Store>
+void denoise_row_impl(const Rows& src, int x_begin, int x_end, Store&& store,
+                      const DenoiseKernel& kernel, uint16_t max_val) {
+    const int radius = kernel.radius();
+    const int taps = 2 * radius + 1;
+
+    // Columns whose whole neighbourhood lies inside the frame need no clamping
+    const int interior_begin = std::max(x_begin, radius);
+    const int interior_end = std::min(x_end, src.frame_width() - radius);
+    if (interior_begin >= interior_end) {
+        denoise_clamped(src, x_begin, x_end, store, kernel, max_val);
+        return;
+    }
+    denoise_clamped(src, x_begin, interior_begin, store, kernel, max_val);
+    const int tail = interior_end - x_begin;
+    denoise_clamped(src, interior_end, x_end,
+        [&](int i, uint16_t r, uint16_t g, uint16_t b) { store(tail + i, r, g, b); },
+        kernel, max_val);
+
+    // Deinterleave the window's columns [interior_begin - radius, interior_end + radius)
+    // into float planes so neighbouring output pixels fill vector lanes
+    const int count = interior_end - interior_begin;
+    const int span = count + 2 * radius;
+    const std::size_t plane_size = static_cast<std::size_t>(taps) * static_cast<std::size_t>(span);
+
+    DenoiseScratch& scratch = thread_scratch();
+    scratch.planes.resize(3 * plane_size);
+    scratch.rows.resize(3 * static_cast<std::size_t>(taps));
+    scratch.out.resize(3 * static_cast<std::size_t>(count));
+
+    float* plane_r = scratch.planes.data();
+    float* plane_g = plane_r + plane_size;
+    float* plane_b = plane_g + plane_size;
+    const float** rows_r = scratch.rows.data();
+    const float** rows_g = rows_r + taps;
+    const float** rows_b = rows_g + taps;
+
+    for (int k = 0; k < taps; ++k) {
+        const std::size_t offset = static_cast<std::size_t>(k) * static_cast<std::size_t>(span);
+        for (int c = 0; c < span; ++c) {
+            const Pixel p = src.load(k, interior_begin - radius + c);
+            plane_r[offset + static_cast<std::size_t>(c)] = static_cast<float>(p.r);
+            plane_g[offset + static_cast<std::size_t>(c)] = static_cast<float>(p.g);
+            plane_b[offset + static_cast<std::size_t>(c)] = static_cast<float>(p.b);
+        }
+        rows_r[k] = plane_r + offset + radius;
+        rows_g[k] = plane_g + offset + radius;
+        rows_b[k] = plane_b + offset + radius;
+    }
+
+    const detail::DenoisePlanes planes{rows_r, rows_g, rows_b};
+    float* out_r = scratch.out.data();
+    float* out_g = out_r + count;
+    float* out_b = out_g + count;
+
+    int done = 0;
+#if defined(ISP_HAVE_AVX2) || defined(ISP_HAVE_SSE41)
+    const SimdLevel level = active_simd_level();
+    const detail::DenoiseTables tables{radius, kernel.spatial_table(), kernel.range_table(),
+                                       kernel.range_scale(), kernel.range_max_index(),
+                                       static_cast<float>(max_val)};
+#endif
+#if defined(ISP_HAVE_AVX2)
+    if (level == SimdLevel::AVX2) {
+        done = count / 8 * 8;
+        detail::denoise_interior_avx2(planes, tables, done, out_r, out_g, out_b);
+    }
+#endif
+#if defined(ISP_HAVE_SSE41)
+    if (level == SimdLevel::SSE41) {
+        done = count / 4 * 4;
+        detail::denoise_interior_sse41(planes, tables, done, out_r, out_g, out_b);
+    }
+#endif
+    denoise_interior_scalar(planes, kernel, done, count, out_r, out_g, out_b);
+
+    // Normalized sums -> output codes (the SIMD kernels have already clamped)
+    const int first = interior_begin - x_begin;
+    const float max_f = static_cast<float>(max_val);
+    for (int i = 0; i < count; ++i) {
+        store(first + i, static_cast<uint16_t>(std::clamp(out_r[i], 0.0f, max_f)),
+              static_cast<uint16_t>(std::clamp(out_g[i], 0.0f, max_f)),
+              static_cast<uint16_t>(std::clamp(out_b[i], 0.0f, max_f)));
     }
 }
 
+} // anonymous namespace
+
+void denoise_row(const RowWindow<Pixel>& window, int x_begin, int x_end, Pixel* out,
+                 const DenoiseKernel& kernel, uint16_t max_val) {
+    denoise_row_impl(InterleavedRows{window}, x_begin, x_end,
+        [out](int i, uint16_t r, uint16_t g, uint16_t b) { out[i] = Pixel{r, g, b}; },
+        kernel, max_val);
+}
+
+void denoise_row(const RowWindow<uint16_t>& r, const RowWindow<uint16_t>& g, const RowWindow<uint16_t>& b,
+                 int x_begin, int x_end, uint16_t* out_r, uint16_t* out_g, uint16_t* out_b,
+                 const DenoiseKernel& kernel, uint16_t max_val) {
+    denoise_row_impl(PlanarRows{r, g, b}, x_begin, x_end,
+        [=](int i, uint16_t vr, uint16_t vg, uint16_t vb) {
+            out_r[i] = vr;
+            out_g[i] = vg;
+            out_b[i] = vb;
+        },
+        kernel, max_val);
+}
+
+void apply_denoise(RgbImage& img, float sigma_spatial, float sigma_range) {
+    // Spatial table and range LUT, shared by every row
+    apply_denoise(img, DenoiseKernel(sigma_spatial, sigma_range));
+}
+
+void apply_denoise(RgbImage& img, const DenoiseKernel& kernel) {
+    FrameArena arena;
+    apply_denoise(img, kernel, arena);
+}
+
+void apply_denoise(RgbImage& img, const DenoiseKernel& kernel, FrameArena& arena) {
+    const int w = img.width();
+    const int h = img.height();
+    const uint16_t max_val = img.max_value();
+
+    // Filter in place: a rolling (2*radius+1)-row buffer per strip keeps the original values
+    filter_rows_in_place(img.data().data(), w, h, kernel.radius(), arena,
+        [&](const RowWindow<Pixel>& window, Pixel* out, int) {
+            denoise_row(window, 0, w, out, kernel, max_val);
+        });
+}
+
+void apply_denoise(PlanarRgbImage& img, float sigma_spatial, float sigma_range) {
+    const int w = img.width();
+    const int h = img.height();
+    const uint16_t max_val = img.max_value();
+
+    const DenoiseKernel kernel(sigma_spatial, sigma_range);
+
+    // The range weight mixes all three channels, so the planes share one rolling buffer pass
+    filter_planes_in_place(std::array<uint16_t*, 3>{img.plane(0), img.plane(1), img.plane(2)},
+        w, h, img.stride(), kernel.radius(),
+        [&](const std::array<RowWindow<uint16_t>, 3>& windows, const std::array<uint16_t*, 3>& out, int) {
+            denoise_row(windows[0], windows[1], windows[2], 0, w, out[0], out[1], out[2], kernel, max_val);
+        });
+}
+
 } // namespace isp
\ No newline at end of file
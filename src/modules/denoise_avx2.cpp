@@ -0,0 +1,34 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "denoise_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256;
+    static constexpr int kLanes = 8;
+
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(float f) { return _mm256_set1_ps(f); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V lookup(const float* table, V index) {
+        return _mm256_i32gather_ps(table, _mm256_cvttps_epi32(index), 4);
+    }
+};
+
+} // anonymous namespace
+
+void denoise_interior_avx2(const DenoisePlanes& planes, const DenoiseTables& tables, int count,
+                           float* out_r, float* out_g, float* out_b) {
+    denoise_interior<Avx2Ops>(planes, tables, count, out_r, out_g, out_b);
+}
+
+} // namespace isp::detail
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "modules/denoise.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace isp {
+
+namespace {
+
+// Columns per task in the vertical box pass; keeps the running sums in L1
+constexpr int kColumnBlock = 256;
+constexpr int kRowGroup = 8;
+
+// Box mean over the (2r+1)^2 window clipped to the frame, normalized by the
+// number of in-frame samples. Two separable running-sum passes, so the cost
+// per sample does not depend on r. `tmp` must hold w*h floats and
+// `inv_count` w doubles; src may not alias dst.
+void box_mean(const float* src, float* dst, float* tmp, double* inv_count, int w, int h, int r) {
+    for (int x = 0; x < w; ++x) {
+        inv_count[x] = 1.0 / (std::min(x + r, w - 1) - std::max(x - r, 0) + 1);
+    }
+
+    // Horizontal: kRowGroup rows at once so the running sums form independent chains
+    const int groups = (h + kRowGroup - 1) / kRowGroup;
+    parallel_for(groups, [&](int begin, int end) {
+        for (int group = begin; group < end; ++group) {
+            const int y0 = group * kRowGroup;
+            const int rows = std::min(kRowGroup, h - y0);
+            const float* s[kRowGroup];
+            float* t[kRowGroup];
+            double sums[kRowGroup] = {};
+            for (int k = 0; k < rows; ++k) {
+                s[k] = src + static_cast<std::size_t>(y0 + k) * w;
+                t[k] = tmp + static_cast<std::size_t>(y0 + k) * w;
+                for (int x = 0; x <= std::min(r, w - 1); ++x) sums[k] += s[k][x];
+            }
+            for (int x = 0; x < w; ++x) {
+                const double inv = inv_count[x];
+                const bool add = x + r + 1 < w;
+                const bool sub = x - r >= 0;
+                for (int k = 0; k < rows; ++k) {
+                    t[k][x] = static_cast<float>(sums[k] * inv);
+                    if (add) sums[k] += s[k][x + r + 1];
+                    if (sub) sums[k] -= s[k][x - r];
+                }
+            }
+        }
+    });
+
+    const int blocks = (w + kColumnBlock - 1) / kColumnBlock;
+    parallel_for(blocks, [&](int begin, int end) {
+        for (int block = begin; block < end; ++block) {
+            const int c0 = block * kColumnBlock;
+            const int cols = std::min(kColumnBlock, w - c0);
+            double sums[kColumnBlock] = {};
+            for (int y = 0; y <= std::min(r, h - 1); ++y) {
+                const float* t = tmp + static_cast<std::size_t>(y) * w + c0;
+                for (int c = 0; c < cols; ++c) sums[c] += t[c];
+            }
+            for (int y = 0; y < h; ++y) {
+                const double inv_rows = 1.0 / (std::min(y + r, h - 1) - std::max(y - r, 0) + 1);
+                float* d = dst + static_cast<std::size_t>(y) * w + c0;
+                for (int c = 0; c < cols; ++c) d[c] = static_cast<float>(sums[c] * inv_rows);
+                if (y + r + 1 < h) {
+                    const float* add = tmp + static_cast<std::size_t>(y + r + 1) * w + c0;
+                    for (int c = 0; c < cols; ++c) sums[c] += add[c];
+                }
+                if (y - r >= 0) {
+                    const float* sub = tmp + static_cast<std::size_t>(y - r) * w + c0;
+                    for (int c = 0; c < cols; ++c) sums[c] -= sub[c];
+                }
+            }
+        }
+    });
+}
+
+// Average `factor` x `factor` blocks (partial blocks at the right and bottom edges)
+void downsample(const float* src, int w, int h, int factor, float* dst, int lw, int lh) {
+    parallel_for(lh, [&](int begin, int end) {
+        for (int ly = begin; ly < end; ++ly) {
+            const int y0 = ly * factor;
+            const int y1 = std::min(y0 + factor, h);
+            for (int lx = 0; lx < lw; ++lx) {
+                const int x0 = lx * factor;
+                const int x1 = std::min(x0 + factor, w);
+                float sum = 0.0f;
+                for (int y = y0; y < y1; ++y) {
+                    const float* s = src + static_cast<std::size_t>(y) * w;
+                    for (int x = x0; x < x1; ++x) sum += s[x];
+                }
+                dst[static_cast<std::size_t>(ly) * lw + lx] = sum / static_cast<float>((y1 - y0) * (x1 - x0));
+            }
+        }
+    });
+}
+
+// Bilinear sample position on the coarse grid for full-resolution index i:
+// coarse sample j sits at the centre of block j
+struct Tap {
+    int i0;
+    int i1;
+    float t;
+};
+
+void upsample_taps(int size, int coarse_size, int factor, Tap* taps) {
+    for (int i = 0; i < size; ++i) {
+        const float pos = std::clamp((static_cast<float>(i) + 0.5f) / static_cast<float>(factor) - 0.5f,
+                                     0.0f, static_cast<float>(coarse_size - 1));
+        const int i0 = static_cast<int>(pos);
+        taps[i] = Tap{i0, std::min(i0 + 1, coarse_size - 1), pos - static_cast<float>(i0)};
+    }
+}
+
+// Shared by every layout: get(c, y, x) reads channel c, set(c, y, x, v)
+// writes the result. Channels are filtered one after another; all scratch
+// planes come from `arena`.
+template <typename Get, typename Set>
+void guided_filter(int w, int h, uint16_t max_code, float sigma_spatial, float sigma_range, int subsample,
+                   FrameArena& arena, Get&& get, Set&& set) {
+    if (w == 0 || h == 0) return;
+
+    const float max_val = static_cast<float>(max_code);
+    const float eps = sigma_range * sigma_range;
+    const int factor = std::max(1, subsample);
+    const int radius = std::max(1, static_cast<int>(std::lround(
+        static_cast<float>(denoise_radius(sigma_spatial)) / static_cast<float>(factor))));
+
+    // Coefficients are solved on the coarse grid; at factor 1 it is the frame itself
+    const std::size_t size = static_cast<std::size_t>(w) * h;
+    const int lw = (w + factor - 1) / factor;
+    const int lh = (h + factor - 1) / factor;
+    const std::size_t lsize = static_cast<std::size_t>(lw) * lh;
+
+    FrameArena::Scope scope(arena);
+    float* channel = arena.allocate<float>(size);
+    float* coarse_channel = factor > 1 ? arena.allocate<float>(lsize) : nullptr;
+    const float* p = factor > 1 ? coarse_channel : channel;
+
+    float* tmp = arena.allocate<float>(lsize);
+    float* mean_p = arena.allocate<float>(lsize);
+    float* var_p = arena.allocate<float>(lsize);
+    float* work = arena.allocate<float>(lsize);
+    double* inv_count = arena.allocate<double>(static_cast<std::size_t>(lw));
+
+    Tap* x_taps = arena.allocate<Tap>(static_cast<std::size_t>(w));
+    Tap* y_taps = arena.allocate<Tap>(static_cast<std::size_t>(h));
+    upsample_taps(w, lw, factor, x_taps);
+    upsample_taps(h, lh, factor, y_taps);
+
+    for (int c = 0; c < 3; ++c) {
+        parallel_for(h, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                float* dst = channel + static_cast<std::size_t>(y) * w;
+                for (int x = 0; x < w; ++x) dst[x] = static_cast<float>(get(c, y, x));
+            }
+        });
+        if (factor > 1) {
+            downsample(channel, w, h, factor, coarse_channel, lw, lh);
+        }
+
+        // With the channel as its own guide: a = var(p) / (var(p) + eps), b = (1 - a) * mean(p)
+        box_mean(p, mean_p, tmp, inv_count, lw, lh, radius);
+        parallel_for(lh, [&](int begin, int end) {
+            const std::size_t last = static_cast<std::size_t>(end) * lw;
+            for (std::size_t i = static_cast<std::size_t>(begin) * lw; i < last; ++i) work[i] = p[i] * p[i];
+        });
+        box_mean(work, var_p, tmp, inv_count, lw, lh, radius);
+        parallel_for(lh, [&](int begin, int end) {
+            const std::size_t last = static_cast<std::size_t>(end) * lw;
+            for (std::size_t i = static_cast<std::size_t>(begin) * lw; i < last; ++i) {
+                const float var = std::max(var_p[i] - mean_p[i] * mean_p[i], 0.0f);
+                const float a = var / (var + eps);
+                work[i] = a;
+                mean_p[i] *= 1.0f - a;
+            }
+        });
+
+        // Average the coefficients of every window covering a pixel
+        float* mean_a = var_p;
+        box_mean(work, mean_a, tmp, inv_count, lw, lh, radius);
+        float* mean_b = work;
+        box_mean(mean_p, mean_b, tmp, inv_count, lw, lh, radius);
+
+        // q = mean_a * p + mean_b, with the coefficients interpolated back to full resolution
+        parallel_for(h, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const Tap ty = y_taps[y];
+                const std::size_t row0 = static_cast<std::size_t>(ty.i0) * lw;
+                const std::size_t row1 = static_cast<std::size_t>(ty.i1) * lw;
+                for (int x = 0; x < w; ++x) {
+                    const std::size_t i = static_cast<std::size_t>(y) * w + x;
+                    float a, b;
+                    if (factor == 1) {
+                        a = mean_a[i];
+                        b = mean_b[i];
+                    } else {
+                        const Tap tx = x_taps[x];
+                        auto lerp2 = [&](const float* plane) {
+                            const float top = plane[row0 + tx.i0] + tx.t * (plane[row0 + tx.i1] - plane[row0 + tx.i0]);
+                            const float bottom = plane[row1 + tx.i0] + tx.t * (plane[row1 + tx.i1] - plane[row1 + tx.i0]);
+                            return top + ty.t * (bottom - top);
+                        };
+                        a = lerp2(mean_a);
+                        b = lerp2(mean_b);
+                    }
+                    set(c, y, x, static_cast<uint16_t>(std::clamp(a * channel[i] + b, 0.0f, max_val)));
+                }
+            }
+        });
+    }
+}
+
+} // anonymous namespace
+
+void apply_guided_denoise(RgbImage& img, float sigma_spatial, float sigma_range, int subsample) {
+    FrameArena arena;
+    apply_guided_denoise(img, sigma_spatial, sigma_range, subsample, arena);
+}
+
+void apply_guided_denoise(RgbImage& img, float sigma_spatial, float sigma_range, int subsample, FrameArena& arena) {
+    Pixel* pixels = img.data().data();
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    auto at = [=](int c, int y, int x) -> uint16_t& {
+        Pixel& p = pixels[static_cast<std::size_t>(y) * w + static_cast<std::size_t>(x)];
+        return c == 0 ? p.r : c == 1 ? p.g : p.b;
+    };
+    guided_filter(img.width(), img.height(), img.max_value(), sigma_spatial, sigma_range, subsample, arena,
+        [&](int c, int y, int x) { return at(c, y, x); },
+        [&](int c, int y, int x, uint16_t v) { at(c, y, x) = v; });
+}
+
+namespace {
+
+template <typename T>
+void guided_filter_planar(PlanarImage<T>& img, float sigma_spatial, float sigma_range, int subsample) {
+    FrameArena arena;
+    guided_filter(img.width(), img.height(), img.max_value(), sigma_spatial, sigma_range, subsample, arena,
+        [&](int c, int y, int x) { return img.row(c, y)[x]; },
+        [&](int c, int y, int x, uint16_t v) { img.row(c, y)[x] = static_cast<T>(v); });
+}
+
+} // anonymous namespace
+
+void apply_guided_denoise(PlanarRgbImage& img, float sigma_spatial, float sigma_range, int subsample) {
+    guided_filter_planar(img, sigma_spatial, sigma_range, subsample);
+}
+
+void apply_guided_denoise(PlanarRgbImage8& img, float sigma_spatial, float sigma_range, int subsample) {
+    guided_filter_planar(img, sigma_spatial, sigma_range, subsample);
+}
+
+void apply_denoise(RgbImage& img, const DenoiseParams& params) {
+    if (params.method == DenoiseMethod::Guided) {
+        apply_guided_denoise(img, params.sigma_spatial, params.sigma_range, params.subsample);
+    } else {
+        apply_denoise(img, params.sigma_spatial, params.sigma_range);
+    }
+}
+
+void apply_denoise(PlanarRgbImage& img, const DenoiseParams& params) {
+    if (params.method == DenoiseMethod::Guided) {
+        apply_guided_denoise(img, params.sigma_spatial, params.sigma_range, params.subsample);
+    } else {
+        apply_denoise(img, params.sigma_spatial, params.sigma_range);
+    }
+}
+
+} // namespace isp
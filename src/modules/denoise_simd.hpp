@@ -0,0 +1,95 @@
+#ifndef ISP_PIPELINE_MODULES_DENOISE_SIMD_HPP
+#define ISP_PIPELINE_MODULES_DENOISE_SIMD_HPP
+
+// Vectorized bilateral filter for interior columns, shared by the SSE4.1
+// and AVX2 builds. Lanes hold neighbouring output pixels, and each lane
+// visits the taps in the same (dy, dx) order as the scalar path, so the
+// float sums match it exactly.
+
+#include <cstdint>
+
+namespace isp::detail {
+
+// Planar float copies of the window rows. r[k], g[k] and b[k] address the
+// first output column of source row (y - radius + k); `radius` columns on
+// either side are readable.
+struct DenoisePlanes {
+    const float* const* r;
+    const float* const* g;
+    const float* const* b;
+};
+
+struct DenoiseTables {
+    int radius;
+    const float* spatial;
+    const float* range;
+    float range_scale;
+    float range_max_index;
+    float max_val;
+};
+
+// Writes normalized, clamped sums for `count` pixels (a multiple of the lane count)
+void denoise_interior_sse41(const DenoisePlanes& planes, const DenoiseTables& tables, int count,
+                            float* out_r, float* out_g, float* out_b);
+void denoise_interior_avx2(const DenoisePlanes& planes, const DenoiseTables& tables, int count,
+                           float* out_r, float* out_g, float* out_b);
+
+// Ops must provide:
+//   V, kLanes, load(p), store(p, v), set1(f), add, sub, mul, div, min, max,
+//   lookup(table, index) -> table[int(index)] per lane
+template <typename Ops>
+void denoise_interior(const DenoisePlanes& planes, const DenoiseTables& tables, int count,
+                      float* out_r, float* out_g, float* out_b) {
+    using V = typename Ops::V;
+    constexpr int L = Ops::kLanes;
+    const int radius = tables.radius;
+    const int taps = 2 * radius + 1;
+
+    const V zero = Ops::set1(0.0f);
+    const V max_val = Ops::set1(tables.max_val);
+    const V scale = Ops::set1(tables.range_scale);
+    const V max_index = Ops::set1(tables.range_max_index);
+
+    for (int i = 0; i < count; i += L) {
+        const V cr = Ops::load(planes.r[radius] + i);
+        const V cg = Ops::load(planes.g[radius] + i);
+        const V cb = Ops::load(planes.b[radius] + i);
+
+        V sum_r = zero, sum_g = zero, sum_b = zero;
+        V sum_weight = zero;
+
+        for (int k = 0; k < taps; ++k) {
+            const float* row_r = planes.r[k] + i;
+            const float* row_g = planes.g[k] + i;
+            const float* row_b = planes.b[k] + i;
+            const float* spatial = tables.spatial + k * taps + radius;
+
+            for (int dx = -radius; dx <= radius; ++dx) {
+                const V nr = Ops::load(row_r + dx);
+                const V ng = Ops::load(row_g + dx);
+                const V nb = Ops::load(row_b + dx);
+
+                const V dr = Ops::sub(nr, cr);
+                const V dg = Ops::sub(ng, cg);
+                const V db = Ops::sub(nb, cb);
+                const V color_dist = Ops::add(Ops::add(Ops::mul(dr, dr), Ops::mul(dg, dg)), Ops::mul(db, db));
+                const V range_weight = Ops::lookup(tables.range, Ops::min(Ops::mul(color_dist, scale), max_index));
+
+                const V weight = Ops::mul(Ops::set1(spatial[dx]), range_weight);
+
+                sum_r = Ops::add(sum_r, Ops::mul(weight, nr));
+                sum_g = Ops::add(sum_g, Ops::mul(weight, ng));
+                sum_b = Ops::add(sum_b, Ops::mul(weight, nb));
+                sum_weight = Ops::add(sum_weight, weight);
+            }
+        }
+
+        Ops::store(out_r + i, Ops::min(Ops::max(Ops::div(sum_r, sum_weight), zero), max_val));
+        Ops::store(out_g + i, Ops::min(Ops::max(Ops::div(sum_g, sum_weight), zero), max_val));
+        Ops::store(out_b + i, Ops::min(Ops::max(Ops::div(sum_b, sum_weight), zero), max_val));
+    }
+}
+
+} // namespace isp::detail
+
+#endif
\ No newline at end of file
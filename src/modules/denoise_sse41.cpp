@@ -0,0 +1,38 @@
+// Built with -msse4.1; only called when the CPU reports SSE4.1 support
+#include "denoise_simd.hpp"
+#include <smmintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Sse41Ops {
+    using V = __m128;
+    static constexpr int kLanes = 4;
+
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(float f) { return _mm_set1_ps(f); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+
+    // No gather before AVX2: four scalar loads
+    static V lookup(const float* table, V index) {
+        const __m128i i = _mm_cvttps_epi32(index);
+        return _mm_setr_ps(table[_mm_extract_epi32(i, 0)], table[_mm_extract_epi32(i, 1)],
+                           table[_mm_extract_epi32(i, 2)], table[_mm_extract_epi32(i, 3)]);
+    }
+};
+
+} // anonymous namespace
+
+void denoise_interior_sse41(const DenoisePlanes& planes, const DenoiseTables& tables, int count,
+                            float* out_r, float* out_g, float* out_b) {
+    denoise_interior<Sse41Ops>(planes, tables, count, out_r, out_g, out_b);
+}
+
+} // namespace isp::detail
\ No newline at end of file
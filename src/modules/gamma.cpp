@@ -1,30 +1,131 @@
 #include "modules/gamma.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
 #include <cmath>
-#include <vector>
+#include <mutex>
+#include <utility>
 
 namespace isp {
 
-void apply_gamma(RgbImage& img, double gamma) {
-    if (img.size() == 0) return;
-    if (gamma <= 0) return;
-
-    uint16_t max_val = img.max_value();
+std::vector<uint16_t> build_gamma_lut(uint16_t max_val, double gamma) {
     double inv_gamma = 1.0 / gamma;
 
-    // Build LUT
     std::vector<uint16_t> lut(max_val + 1);
     for (int i = 0; i <= max_val; ++i) {
         double normalized = static_cast<double>(i) / max_val;
         double corrected = std::pow(normalized, inv_gamma);
         lut[static_cast<std::size_t>(i)] = static_cast<uint16_t>(corrected * max_val);
     }
+    return lut;
+}
 
-    // Apply LUT
-    for (auto& p : img.data()) {
+void apply_gamma_lut(Pixel* data, std::size_t count, const std::vector<uint16_t>& lut) {
+    for (std::size_t i = 0; i < count; ++i) {
+        Pixel& p = data[i];
         p.r = lut[p.r];
         p.g = lut[p.g];
         p.b = lut[p.b];
     }
 }
 
+template <typename Format>
+std::shared_ptr<const std::vector<typename Format::Sample>> cached_gamma_lut(double gamma) {
+    using Sample = typename Format::Sample;
+    using Entry = std::pair<double, std::shared_ptr<const std::vector<Sample>>>;
+    // Most recently used first
+    constexpr std::size_t kMaxEntries = 4;
+    static std::mutex mutex;
+    static std::vector<Entry> luts;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(luts.begin(), luts.end(), [gamma](const Entry& e) { return e.first == gamma; });
+    if (it == luts.end()) {
+        const std::vector<uint16_t> lut = build_gamma_lut(Format::max_value, gamma);
+        if (luts.size() == kMaxEntries) luts.pop_back();
+        luts.emplace(luts.begin(), gamma, std::make_shared<const std::vector<Sample>>(lut.begin(), lut.end()));
+    } else {
+        std::rotate(luts.begin(), it, it + 1);
+    }
+    return luts.front().second;
+}
+
+template <typename Format>
+void apply_gamma_lut(typename Format::Sample* data, std::size_t count, const typename Format::Sample* lut) {
+    // The mask keeps stray out-of-range codes inside the table
+    for (std::size_t i = 0; i < count; ++i) {
+        data[i] = lut[data[i] & Format::max_value];
+    }
+}
+
+template std::shared_ptr<const std::vector<uint8_t>> cached_gamma_lut<Format8>(double);
+template std::shared_ptr<const std::vector<uint16_t>> cached_gamma_lut<Format16x8>(double);
+template std::shared_ptr<const std::vector<uint16_t>> cached_gamma_lut<Format10>(double);
+template std::shared_ptr<const std::vector<uint16_t>> cached_gamma_lut<Format12>(double);
+template std::shared_ptr<const std::vector<uint16_t>> cached_gamma_lut<Format14>(double);
+template std::shared_ptr<const std::vector<uint16_t>> cached_gamma_lut<Format16>(double);
+
+template void apply_gamma_lut<Format8>(uint8_t*, std::size_t, const uint8_t*);
+template void apply_gamma_lut<Format16x8>(uint16_t*, std::size_t, const uint16_t*);
+template void apply_gamma_lut<Format10>(uint16_t*, std::size_t, const uint16_t*);
+template void apply_gamma_lut<Format12>(uint16_t*, std::size_t, const uint16_t*);
+template void apply_gamma_lut<Format14>(uint16_t*, std::size_t, const uint16_t*);
+template void apply_gamma_lut<Format16>(uint16_t*, std::size_t, const uint16_t*);
+
+void apply_gamma(RgbImage& img, double gamma) {
+    if (img.size() == 0) return;
+    if (gamma <= 0) return;
+
+    // Reuse the cached LUT for the common depths; build one otherwise
+    std::shared_ptr<const std::vector<uint16_t>> cached;
+    std::vector<uint16_t> built;
+    const std::vector<uint16_t>* lut = &built;
+    if (has_sample_format<uint16_t>(img.bit_depth())) {
+        dispatch_sample_format<uint16_t>(img.bit_depth(), [&](auto format) {
+            cached = cached_gamma_lut<decltype(format)>(gamma);
+        });
+        lut = cached.get();
+    } else {
+        built = build_gamma_lut(img.max_value(), gamma);
+    }
+
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    Pixel* data = img.data().data();
+    parallel_for(img.height(), [&](int begin, int end) {
+        apply_gamma_lut(data + static_cast<std::size_t>(begin) * w, static_cast<std::size_t>(end - begin) * w, *lut);
+    });
+}
+
+namespace {
+
+template <typename T>
+void apply_gamma_planar(PlanarImage<T>& img, double gamma) {
+    if (img.size() == 0) return;
+    if (gamma <= 0) return;
+
+    const int w = img.width();
+    const int h = img.height();
+    dispatch_sample_format<T>(img.bit_depth(), [&](auto format) {
+        using Format = decltype(format);
+        const auto table = cached_gamma_lut<Format>(gamma);
+        const T* lut = table->data();
+        for (int c = 0; c < 3; ++c) {
+            parallel_for(h, [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    apply_gamma_lut<Format>(img.row(c, y), static_cast<std::size_t>(w), lut);
+                }
+            });
+        }
+    });
+}
+
+} // anonymous namespace
+
+void apply_gamma(PlanarRgbImage& img, double gamma) {
+    apply_gamma_planar(img, gamma);
+}
+
+void apply_gamma(PlanarRgbImage8& img, double gamma) {
+    apply_gamma_planar(img, gamma);
+}
+
 } // namespace isp
\ No newline at end of file
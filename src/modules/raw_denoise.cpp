@@ -0,0 +1,117 @@
+#include "modules/raw_denoise.hpp"
+#include "raw_denoise_simd.hpp"
+#include "line_buffer.hpp"
+#include "simd.hpp"
+#include <algorithm>
+
+namespace isp {
+
+namespace {
+
+constexpr float kFullWellElectrons = 10000.0f;
+constexpr float kPedestalSigmas = 16.0f;
+
+detail::RawDenoiseTables make_tables(const RawNoiseModel& noise, float strength, uint16_t max_value) {
+    const float s2 = strength * strength;
+    return {s2 * noise.shot_gain, s2 * noise.read_sigma * noise.read_sigma, static_cast<float>(max_value)};
+}
+
+// One output sample from its 8 same-colour taps, in the order the SIMD path
+// visits them: N, W, E, S, then the diagonals NW, NE, SW, SE
+uint16_t filter_sample(const uint16_t (&taps)[8], uint16_t centre, const detail::RawDenoiseTables& tables) {
+    const float c = centre;
+    const float inv_h2 = 1.0f / (tables.slope * c + tables.offset);
+    float sum = c;
+    float sum_weight = 1.0f;
+    for (int k = 0; k < 8; ++k) {
+        const float n = taps[k];
+        const float d = n - c;
+        const float spatial = k < 4 ? 1.0f : 0.5f;
+        const float w = spatial * std::max(0.0f, 1.0f - (d * d) * inv_h2);
+        sum = sum + w * n;
+        sum_weight = sum_weight + w;
+    }
+    return static_cast<uint16_t>(std::min(sum / sum_weight, tables.max_value) + 0.5f);
+}
+
+// Scalar path for columns [x_begin, x_end); columns 2 past the frame edge
+// mirror to the other side, which keeps their colour
+void filter_clamped(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int width, int x_begin,
+                    int x_end, uint16_t* out, const detail::RawDenoiseTables& tables) {
+    auto column = [&](int x, int dx) {
+        if (x + dx >= 0 && x + dx < width) return x + dx;
+        if (x - dx >= 0 && x - dx < width) return x - dx;
+        return x;
+    };
+    for (int x = x_begin; x < x_end; ++x) {
+        const int l = column(x, -2);
+        const int r = column(x, 2);
+        const uint16_t taps[8] = {north[x], mid[l], mid[r], south[x], north[l], north[r], south[l], south[r]};
+        out[x] = filter_sample(taps, mid[x], tables);
+    }
+}
+
+} // anonymous namespace
+
+RawNoiseModel RawNoiseModel::estimate(int bit_depth, uint16_t black_level) {
+    const float full_scale = static_cast<float>((1 << bit_depth) - 1) - black_level;
+    RawNoiseModel model;
+    model.shot_gain = std::max(full_scale, 1.0f) / kFullWellElectrons;
+    model.read_sigma = std::max(1.0f, black_level / kPedestalSigmas);
+    return model;
+}
+
+void raw_denoise_row(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int width, uint16_t* out,
+                     const RawNoiseModel& noise, float strength, uint16_t max_value) {
+    const detail::RawDenoiseTables tables = make_tables(noise, strength, max_value);
+    const int interior_begin = std::min(2, width);
+    const int interior_end = std::max(interior_begin, width - 2);
+    filter_clamped(north, mid, south, width, 0, interior_begin, out, tables);
+    filter_clamped(north, mid, south, width, interior_end, width, out, tables);
+
+    int x = interior_begin;
+    const SimdLevel level = active_simd_level();
+    const int lanes = level == SimdLevel::AVX2 ? 8 : level == SimdLevel::SSE41 ? 4 : 0;
+    if (lanes > 0) {
+        const int blocks = (interior_end - x) / lanes * lanes;
+#if defined(ISP_HAVE_AVX2)
+        if (level == SimdLevel::AVX2 && blocks > 0) {
+            detail::raw_denoise_interior_avx2(north + x, mid + x, south + x, blocks, out + x, tables);
+        }
+#endif
+#if defined(ISP_HAVE_SSE41)
+        if (level == SimdLevel::SSE41 && blocks > 0) {
+            detail::raw_denoise_interior_sse41(north + x, mid + x, south + x, blocks, out + x, tables);
+        }
+#endif
+        x += blocks;
+    }
+
+    for (; x < interior_end; ++x) {
+        const uint16_t taps[8] = {north[x], mid[x - 2], mid[x + 2], south[x],
+                                  north[x - 2], north[x + 2], south[x - 2], south[x + 2]};
+        out[x] = filter_sample(taps, mid[x], tables);
+    }
+}
+
+void apply_raw_denoise(Image& raw, const RawDenoiseParams& params) {
+    FrameArena arena;
+    apply_raw_denoise(raw, RawNoiseModel::estimate(raw.bit_depth(), params.black_level), params.strength, arena);
+}
+
+void apply_raw_denoise(Image& raw, const RawNoiseModel& noise, float strength, FrameArena& arena) {
+    const int w = raw.width();
+    const int h = raw.height();
+    const uint16_t max_value = raw.max_value();
+
+    // The window clamps rows at the frame edges, which would change their
+    // colour; mirror the out-of-frame row of the pair instead
+    filter_rows_in_place(raw.data().data(), w, h, 2, arena,
+        [&](const RowWindow<uint16_t>& window, uint16_t* out, int y) {
+            const uint16_t* north = y >= 2 ? window.rows[0] : y + 2 < h ? window.rows[4] : window.rows[2];
+            const uint16_t* south = y + 2 < h ? window.rows[4] : y >= 2 ? window.rows[0] : window.rows[2];
+            raw_denoise_row(north, window.rows[2], south, w, out, noise, strength, max_value);
+        });
+}
+
+} // namespace isp
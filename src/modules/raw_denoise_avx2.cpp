@@ -0,0 +1,38 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "raw_denoise_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256;
+    static constexpr int kLanes = 8;
+
+    static V load(const uint16_t* p) {
+        const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(samples));
+    }
+    static void store(uint16_t* p, V v) {
+        const __m256i dwords = _mm256_cvttps_epi32(v);
+        const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(dwords), _mm256_extracti128_si256(dwords, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), words);
+    }
+    static V set1(float f) { return _mm256_set1_ps(f); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+};
+
+} // anonymous namespace
+
+void raw_denoise_interior_avx2(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int count,
+                               uint16_t* out, const RawDenoiseTables& tables) {
+    raw_denoise_interior<Avx2Ops>(north, mid, south, count, out, tables);
+}
+
+} // namespace isp::detail
\ No newline at end of file
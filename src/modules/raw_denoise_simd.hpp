@@ -0,0 +1,75 @@
+#ifndef ISP_PIPELINE_MODULES_RAW_DENOISE_SIMD_HPP
+#define ISP_PIPELINE_MODULES_RAW_DENOISE_SIMD_HPP
+
+// Vectorized Bayer-domain denoise for interior columns, shared by the
+// SSE4.1 and AVX2 builds. Same-colour neighbours are always 2 samples
+// away, so every lane reads its taps at the same offsets whatever its
+// colour, and visits them in the scalar path's order: the float sums
+// match it exactly.
+
+#include <cstdint>
+
+namespace isp::detail {
+
+// Per-frame constants: a sample's taps count while (d / h)^2 < 1, with
+// h^2 = slope * centre + offset
+struct RawDenoiseTables {
+    float slope;
+    float offset;
+    float max_value;
+};
+
+// north/mid/south point at the first output column, at least 2 columns
+// inside the frame; count is a multiple of the lane count
+void raw_denoise_interior_sse41(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int count,
+                                uint16_t* out, const RawDenoiseTables& tables);
+void raw_denoise_interior_avx2(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int count,
+                               uint16_t* out, const RawDenoiseTables& tables);
+
+// Ops must provide:
+//   V, kLanes, load(p) -> kLanes samples widened to float,
+//   store(p, v) -> truncate to kLanes 16-bit samples,
+//   set1(f), add, sub, mul, div, min, max
+template <typename Ops>
+void raw_denoise_interior(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int count,
+                          uint16_t* out, const RawDenoiseTables& tables) {
+    using V = typename Ops::V;
+    constexpr int L = Ops::kLanes;
+
+    const V zero = Ops::set1(0.0f);
+    const V one = Ops::set1(1.0f);
+    const V half = Ops::set1(0.5f);
+    const V slope = Ops::set1(tables.slope);
+    const V offset = Ops::set1(tables.offset);
+    const V max_value = Ops::set1(tables.max_value);
+
+    for (int i = 0; i < count; i += L) {
+        const V c = Ops::load(mid + i);
+        const V inv_h2 = Ops::div(one, Ops::add(Ops::mul(slope, c), offset));
+
+        V sum = c;
+        V sum_weight = one;
+        auto tap = [&](const uint16_t* p, V spatial) {
+            const V n = Ops::load(p);
+            const V d = Ops::sub(n, c);
+            const V w = Ops::mul(spatial, Ops::max(zero, Ops::sub(one, Ops::mul(Ops::mul(d, d), inv_h2))));
+            sum = Ops::add(sum, Ops::mul(w, n));
+            sum_weight = Ops::add(sum_weight, w);
+        };
+        const V diagonal = half;
+        tap(north + i, one);
+        tap(mid + i - 2, one);
+        tap(mid + i + 2, one);
+        tap(south + i, one);
+        tap(north + i - 2, diagonal);
+        tap(north + i + 2, diagonal);
+        tap(south + i - 2, diagonal);
+        tap(south + i + 2, diagonal);
+
+        Ops::store(out + i, Ops::add(Ops::min(Ops::div(sum, sum_weight), max_value), half));
+    }
+}
+
+} // namespace isp::detail
+
+#endif
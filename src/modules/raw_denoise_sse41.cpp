@@ -0,0 +1,37 @@
+// Built with -msse4.1; only called when the CPU reports SSE4.1 support
+#include "raw_denoise_simd.hpp"
+#include <smmintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Sse41Ops {
+    using V = __m128;
+    static constexpr int kLanes = 4;
+
+    static V load(const uint16_t* p) {
+        const __m128i samples = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(samples));
+    }
+    static void store(uint16_t* p, V v) {
+        const __m128i words = _mm_packus_epi32(_mm_cvttps_epi32(v), _mm_setzero_si128());
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), words);
+    }
+    static V set1(float f) { return _mm_set1_ps(f); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+};
+
+} // anonymous namespace
+
+void raw_denoise_interior_sse41(const uint16_t* north, const uint16_t* mid, const uint16_t* south, int count,
+                                uint16_t* out, const RawDenoiseTables& tables) {
+    raw_denoise_interior<Sse41Ops>(north, mid, south, count, out, tables);
+}
+
+} // namespace isp::detail
\ No newline at end of file
@@ -1,52 +1,195 @@
 #include "modules/sharpen.hpp"
+#include "line_buffer.hpp"
 #include <algorithm>
-#include <omp.h>
+#include <cmath>
+#include <stdexcept>
 
 namespace isp {
 
-void apply_sharpen(RgbImage& img) {
-    if (img.width() < 3 || img.height() < 3) return;
+int sharpen_gain(float strength) {
+    if (!(strength >= 0.0f && strength <= 8.0f)) {
+        throw std::invalid_argument("Sharpen strength must be in [0, 8]");
+    }
+    return static_cast<int>(std::lround(strength * static_cast<float>(kSharpenUnitGain)));
+}
 
-    const int w = img.width();
-    const int h = img.height();
-    const uint16_t max_val = img.max_value();
+void sharpen_row(const RowWindow<Pixel>& window, int x_begin, int x_end, Pixel* out,
+                 uint16_t max_val, int gain) {
+    const int last_col = window.frame_width - 1;
 
-    // Make a copy for reading (convolution needs original values)
-    std::vector<Pixel> original = img.data();
+    auto get = [&](int x, int dy) -> const Pixel& {
+        x = std::max(0, std::min(x, last_col));
+        return window.rows[1 + dy][x - window.col0];
+    };
 
-    auto get = [&](int x, int y) -> const Pixel& {
-        x = std::max(0, std::min(x, w - 1));
-        y = std::max(0, std::min(y, h - 1));
-        return original[static_cast<std::size_t>(y * w + x)];
+    auto clamp = [max_val](int val) -> uint16_t {
+        return static_cast<uint16_t>(std::max(0, std::min(val, static_cast<int>(max_val))));
     };
 
-    // Sharpening kernel:
+    // center + gain * laplacian / 256, rounded; at unit gain this is the kernel
     //   0  -1   0
     //  -1   5  -1
     //   0  -1   0
-    #pragma omp parallel for schedule(dynamic)
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            const Pixel& center = get(x, y);
-            const Pixel& top    = get(x, y - 1);
-            const Pixel& bottom = get(x, y + 1);
-            const Pixel& left   = get(x - 1, y);
-            const Pixel& right  = get(x + 1, y);
-
-            auto clamp = [max_val](int val) -> uint16_t {
-                return static_cast<uint16_t>(std::max(0, std::min(val, static_cast<int>(max_val))));
-            };
-
-            int r = 5 * center.r - top.r - bottom.r - left.r - right.r;
-            int g = 5 * center.g - top.g - bottom.g - left.g - right.g;
-            int b = 5 * center.b - top.b - bottom.b - left.b - right.b;
-
-            Pixel& out = img.at(x, y);
-            out.r = clamp(r);
-            out.g = clamp(g);
-            out.b = clamp(b);
+    // The Laplacian is at most 4 * 65535, so gain * laplacian fits an int.
+    auto sharpen = [gain](int center, int laplacian) {
+        return center + ((gain * laplacian + kSharpenUnitGain / 2) >> 8);
+    };
+
+    auto sharpen_at = [&](int x) {
+        const Pixel& center = get(x, 0);
+        const Pixel& top    = get(x, -1);
+        const Pixel& bottom = get(x, 1);
+        const Pixel& left   = get(x - 1, 0);
+        const Pixel& right  = get(x + 1, 0);
+
+        int r = sharpen(center.r, 4 * center.r - top.r - bottom.r - left.r - right.r);
+        int g = sharpen(center.g, 4 * center.g - top.g - bottom.g - left.g - right.g);
+        int b = sharpen(center.b, 4 * center.b - top.b - bottom.b - left.b - right.b);
+
+        Pixel& p = out[x - x_begin];
+        p.r = clamp(r);
+        p.g = clamp(g);
+        p.b = clamp(b);
+    };
+
+    const int interior_begin = std::max(x_begin, 1);
+    const int interior_end = std::min(x_end, last_col);
+    if (interior_begin >= interior_end) {
+        for (int x = x_begin; x < x_end; ++x) sharpen_at(x);
+        return;
+    }
+    for (int x = x_begin; x < interior_begin; ++x) sharpen_at(x);
+    for (int x = interior_end; x < x_end; ++x) sharpen_at(x);
+
+    // Interior columns need no clamped reads
+    const Pixel* top = window.rows[0] - window.col0;
+    const Pixel* mid = window.rows[1] - window.col0;
+    const Pixel* bottom = window.rows[2] - window.col0;
+    Pixel* dst = out - x_begin;
+    auto interior = [&](auto&& op) {
+        for (int x = interior_begin; x < interior_end; ++x) {
+            dst[x].r = clamp(op(mid[x].r, 4 * mid[x].r - top[x].r - bottom[x].r - mid[x - 1].r - mid[x + 1].r));
+            dst[x].g = clamp(op(mid[x].g, 4 * mid[x].g - top[x].g - bottom[x].g - mid[x - 1].g - mid[x + 1].g));
+            dst[x].b = clamp(op(mid[x].b, 4 * mid[x].b - top[x].b - bottom[x].b - mid[x - 1].b - mid[x + 1].b));
         }
+    };
+    // The default strength skips the multiply, which costs the vector loop
+    // about half its speed
+    if (gain == kSharpenUnitGain) {
+        interior([](int center, int laplacian) { return center + laplacian; });
+    } else {
+        interior(sharpen);
+    }
+}
+
+template <typename Format>
+void sharpen_row(const RowWindow<typename Format::Sample>& window, int x_begin, int x_end,
+                 typename Format::Sample* out) {
+    using Sample = typename Format::Sample;
+    const int last_col = window.frame_width - 1;
+    constexpr int max_i = Format::max_value;
+
+    auto sharpen_at = [&](int x) {
+        const int xl = std::max(0, x - 1) - window.col0;
+        const int xc = x - window.col0;
+        const int xr = std::min(x + 1, last_col) - window.col0;
+        int v = 5 * window.rows[1][xc] - window.rows[0][xc] - window.rows[2][xc]
+              - window.rows[1][xl] - window.rows[1][xr];
+        out[x - x_begin] = static_cast<Sample>(std::max(0, std::min(v, max_i)));
+    };
+
+    const int interior_begin = std::max(x_begin, 1);
+    const int interior_end = std::min(x_end, last_col);
+    if (interior_begin >= interior_end) {
+        for (int x = x_begin; x < x_end; ++x) sharpen_at(x);
+        return;
+    }
+    for (int x = x_begin; x < interior_begin; ++x) sharpen_at(x);
+    for (int x = interior_end; x < x_end; ++x) sharpen_at(x);
+
+    // Unclamped interior: straight-line integer code the compiler vectorizes
+    const Sample* top = window.rows[0] - window.col0;
+    const Sample* mid = window.rows[1] - window.col0;
+    const Sample* bottom = window.rows[2] - window.col0;
+    Sample* dst = out - x_begin;
+    for (int x = interior_begin; x < interior_end; ++x) {
+        int v = 5 * mid[x] - top[x] - bottom[x] - mid[x - 1] - mid[x + 1];
+        dst[x] = static_cast<Sample>(std::max(0, std::min(v, max_i)));
+    }
+}
+
+template void sharpen_row<Format8>(const RowWindow<uint8_t>&, int, int, uint8_t*);
+template void sharpen_row<Format16x8>(const RowWindow<uint16_t>&, int, int, uint16_t*);
+template void sharpen_row<Format10>(const RowWindow<uint16_t>&, int, int, uint16_t*);
+template void sharpen_row<Format12>(const RowWindow<uint16_t>&, int, int, uint16_t*);
+template void sharpen_row<Format14>(const RowWindow<uint16_t>&, int, int, uint16_t*);
+template void sharpen_row<Format16>(const RowWindow<uint16_t>&, int, int, uint16_t*);
+
+void apply_sharpen(RgbImage& img, float strength) {
+    FrameArena arena;
+    apply_sharpen(img, arena, strength);
+}
+
+void apply_sharpen(RgbImage& img, FrameArena& arena, float strength) {
+    const int gain = sharpen_gain(strength);
+    if (img.width() < 3 || img.height() < 3) return;
+
+    const int w = img.width();
+    const int h = img.height();
+    const uint16_t max_val = img.max_value();
+
+    // Convolve in place: a rolling 3-row buffer per strip keeps the original values
+    filter_rows_in_place(img.data().data(), w, h, 1, arena,
+        [&](const RowWindow<Pixel>& window, Pixel* out, int) {
+            sharpen_row(window, 0, w, out, max_val, gain);
+        });
+}
+
+void apply_sharpen(RgbImage& img, FrameArena& arena, const To8Bit& to_8bit, uint8_t* rgb8, float strength) {
+    const int gain = sharpen_gain(strength);
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    if (img.width() < 3 || img.height() < 3) {
+        to_8bit.convert(img.data().data(), img.size(), rgb8);
+        return;
     }
+
+    const uint16_t max_val = img.max_value();
+    filter_rows_in_place(img.data().data(), img.width(), img.height(), 1, arena,
+        [&](const RowWindow<Pixel>& window, Pixel* out, int y) {
+            sharpen_row(window, 0, img.width(), out, max_val, gain);
+            to_8bit.convert(out, w, rgb8 + 3 * static_cast<std::size_t>(y) * w);
+        });
+}
+
+namespace {
+
+template <typename T>
+void apply_sharpen_planar(PlanarImage<T>& img) {
+    if (img.width() < 3 || img.height() < 3) return;
+
+    const int w = img.width();
+    const int h = img.height();
+
+    // Each channel is independent, so each plane gets its own rolling buffer pass
+    dispatch_sample_format<T>(img.bit_depth(), [&](auto format) {
+        using Format = decltype(format);
+        for (int c = 0; c < 3; ++c) {
+            filter_planes_in_place(std::array<T*, 1>{img.plane(c)}, w, h, img.stride(), 1,
+                [&](const std::array<RowWindow<T>, 1>& windows, const std::array<T*, 1>& out, int) {
+                    sharpen_row<Format>(windows[0], 0, w, out[0]);
+                });
+        }
+    });
+}
+
+} // anonymous namespace
+
+void apply_sharpen(PlanarRgbImage& img) {
+    apply_sharpen_planar(img);
+}
+
+void apply_sharpen(PlanarRgbImage8& img) {
+    apply_sharpen_planar(img);
 }
 
 } // namespace isp
\ No newline at end of file
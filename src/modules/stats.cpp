@@ -0,0 +1,164 @@
+#include "modules/stats.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace isp {
+
+namespace {
+
+// Where R, the two greens and B sit in a quad, as indices into
+// {top-left, top-right, bottom-left, bottom-right}
+template <int R, int G1, int G2, int B>
+struct QuadLayout {
+    static constexpr int r = R, g1 = G1, g2 = G2, b = B;
+};
+
+// Calls fn(QuadLayout<...>{}) for the frame's pattern, so the sample loop
+// reads each channel from a fixed offset
+template <typename Fn>
+void dispatch_quad_layout(BayerPattern pattern, Fn&& fn) {
+    switch (pattern) {
+    case BayerPattern::BGGR: fn(QuadLayout<3, 1, 2, 0>{}); return;
+    case BayerPattern::GRBG: fn(QuadLayout<1, 0, 3, 2>{}); return;
+    case BayerPattern::GBRG: fn(QuadLayout<2, 0, 3, 1>{}); return;
+    case BayerPattern::RGGB: fn(QuadLayout<0, 1, 2, 3>{}); return;
+    }
+}
+
+void add_zone(ZoneStats& into, const ZoneStats& from) {
+    into.r += from.r;
+    into.g += from.g;
+    into.b += from.b;
+    into.quads += from.quads;
+    into.saturated += from.saturated;
+}
+
+} // anonymous namespace
+
+void compute_bayer_stats(const Image& raw, const StatsConfig& config, BayerStats& stats, FrameArena& arena) {
+    if (config.zones_x <= 0 || config.zones_y <= 0) {
+        throw std::invalid_argument("Stats zone counts must be positive");
+    }
+    if (config.subsample <= 0) {
+        throw std::invalid_argument("Stats subsample must be positive");
+    }
+
+    const uint16_t max_val = raw.max_value();
+    const std::size_t zone_count = static_cast<std::size_t>(config.zones_x) * static_cast<std::size_t>(config.zones_y);
+    stats.zones_x = config.zones_x;
+    stats.zones_y = config.zones_y;
+    stats.saturation_level = static_cast<uint16_t>(max_val - std::min(config.black_level, max_val));
+    stats.zones.assign(zone_count, ZoneStats{});
+    stats.total = ZoneStats{};
+    for (auto& channel : stats.histogram) channel.fill(0);
+
+    const int quads_x = raw.width() / 2;
+    const int quads_y = raw.height() / 2;
+    if (quads_x == 0 || quads_y == 0) return;
+
+    const int step = config.subsample;
+    const int sampled_rows = (quads_y + step - 1) / step;
+    ExecContext& context = ExecContext::current();
+    const int threads = context.threads();
+    constexpr std::size_t kBins = kStatsHistogramBins;
+    constexpr std::size_t kHistogramSize = 3 * kBins;
+
+    // One private set of partials per worker: no atomics in the sample loop
+    FrameArena::Scope scope(arena);
+    ZoneStats* zone_partials = arena.allocate<ZoneStats>(static_cast<std::size_t>(threads) * zone_count);
+    uint32_t* histogram_partials = arena.allocate<uint32_t>(static_cast<std::size_t>(threads) * kHistogramSize);
+    std::fill(zone_partials, zone_partials + static_cast<std::size_t>(threads) * zone_count, ZoneStats{});
+    std::fill(histogram_partials, histogram_partials + static_cast<std::size_t>(threads) * kHistogramSize, 0u);
+
+    const uint16_t saturation = stats.saturation_level;
+    const int bit_depth = raw.bit_depth();
+    const std::size_t stride = static_cast<std::size_t>(raw.width());
+    const uint16_t* data = raw.data().data();
+
+    auto bin = [&](uint16_t v) {
+        return (static_cast<std::size_t>(std::min(v, max_val)) * kBins) >> bit_depth;
+    };
+
+    context.run(sampled_rows, context.default_grain(sampled_rows), [&](int first, int last, int worker) {
+        const std::size_t t = static_cast<std::size_t>(worker);
+        ZoneStats* zones = zone_partials + t * zone_count;
+        uint32_t* histogram = histogram_partials + t * kHistogramSize;
+
+        dispatch_quad_layout(raw.pattern(), [&](auto layout) {
+            using Layout = decltype(layout);
+
+            for (int i = first; i < last; ++i) {
+                const int qy = i * step;
+                const int zy = qy * config.zones_y / quads_y;
+                const uint16_t* rows[2] = {data + static_cast<std::size_t>(2 * qy) * stride,
+                                           data + static_cast<std::size_t>(2 * qy + 1) * stride};
+                auto sample = [&](int index, std::size_t x) { return rows[index >> 1][x + (index & 1)]; };
+
+                for (int zx = 0; zx < config.zones_x; ++zx) {
+                    const int begin = zx * quads_x / config.zones_x;
+                    const int end = (zx + 1) * quads_x / config.zones_x;
+
+                    // Accumulate the zone's share of this row in registers, then add once
+                    uint64_t r_sum = 0, g_sum = 0, b_sum = 0;
+                    uint32_t quads = 0, saturated = 0;
+                    for (int qx = (begin + step - 1) / step * step; qx < end; qx += step) {
+                        const std::size_t x = static_cast<std::size_t>(2 * qx);
+                        const uint16_t r = sample(Layout::r, x);
+                        const uint16_t g1 = sample(Layout::g1, x);
+                        const uint16_t g2 = sample(Layout::g2, x);
+                        const uint16_t b = sample(Layout::b, x);
+
+                        r_sum += r;
+                        g_sum += static_cast<uint32_t>(g1) + g2;
+                        b_sum += b;
+                        ++quads;
+                        const uint16_t peak = std::max(std::max(r, g1), std::max(g2, b));
+                        saturated += peak >= saturation ? 1u : 0u;
+
+                        ++histogram[bin(r)];
+                        ++histogram[kBins + bin(g1)];
+                        ++histogram[kBins + bin(g2)];
+                        ++histogram[2 * kBins + bin(b)];
+                    }
+                    ZoneStats& zone = zones[static_cast<std::size_t>(zy) * static_cast<std::size_t>(config.zones_x) +
+                                            static_cast<std::size_t>(zx)];
+                    add_zone(zone, ZoneStats{r_sum, g_sum, b_sum, quads, saturated});
+                }
+            }
+        });
+    });
+
+    // Fold the partials
+    for (std::size_t t = 0; t < static_cast<std::size_t>(threads); ++t) {
+        const ZoneStats* zones = zone_partials + t * zone_count;
+        for (std::size_t z = 0; z < zone_count; ++z) {
+            add_zone(stats.zones[z], zones[z]);
+        }
+        const uint32_t* histogram = histogram_partials + t * kHistogramSize;
+        for (std::size_t c = 0; c < 3; ++c) {
+            for (std::size_t k = 0; k < kBins; ++k) {
+                stats.histogram[c][k] += histogram[c * kBins + k];
+            }
+        }
+    }
+    for (const ZoneStats& zone : stats.zones) {
+        add_zone(stats.total, zone);
+    }
+}
+
+BayerStats compute_bayer_stats(const Image& raw, const StatsConfig& config) {
+    BayerStats stats;
+    FrameArena arena;
+    compute_bayer_stats(raw, config, stats, arena);
+    return stats;
+}
+
+AwbGains gray_world_gains(const BayerStats& stats) {
+    if (stats.total.quads == 0) return AwbGains{};
+    // Each quad holds one R, two G and one B sample
+    return compute_awb_gains(static_cast<double>(stats.total.r), static_cast<double>(stats.total.g) / 2.0,
+                             static_cast<double>(stats.total.b), static_cast<double>(stats.total.quads));
+}
+
+} // namespace isp
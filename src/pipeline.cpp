@@ -0,0 +1,635 @@
+#include "pipeline.hpp"
+#include "exec_context.hpp"
+#include "modules/blc.hpp"
+#include "modules/demosaic.hpp"
+#include "modules/awb.hpp"
+#include "modules/gamma.hpp"
+#include "modules/sharpen.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace isp {
+
+namespace {
+
+// Gray World gains of `img` as it would look after `lut`
+AwbGains gray_world_gains(const RgbImage& img, const PointLut& lut) {
+    if (img.size() == 0) return AwbGains{};
+
+    const uint16_t* r = lut.channel(0);
+    const uint16_t* g = lut.channel(1);
+    const uint16_t* b = lut.channel(2);
+    const uint16_t max_val = lut.max_value();
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    const Pixel* data = img.data().data();
+    const ChannelSums sums = parallel_sum(img.height(), ChannelSums{}, [&](int begin, int end) {
+        ChannelSums part;
+        const std::size_t last = static_cast<std::size_t>(end) * w;
+        for (std::size_t i = static_cast<std::size_t>(begin) * w; i < last; ++i) {
+            part.r += r[std::min(data[i].r, max_val)];
+            part.g += g[std::min(data[i].g, max_val)];
+            part.b += b[std::min(data[i].b, max_val)];
+        }
+        part.count = last - static_cast<std::size_t>(begin) * w;
+        return part;
+    });
+    return gray_world_gains(sums);
+}
+
+} // anonymous namespace
+
+void BlcStage::run(Frame& frame) {
+    apply_blc(frame.raw, black_level_);
+}
+
+void BlcStage::compose(PointLut& lut, const Frame& frame) {
+    (void)frame;
+    for (int c = 0; c < 3; ++c) {
+        uint16_t* t = lut.channel(c);
+        for (std::size_t v = 0; v < lut.size(); ++v) {
+            t[v] = t[v] > black_level_ ? static_cast<uint16_t>(t[v] - black_level_) : 0;
+        }
+    }
+}
+
+void RawDenoiseStage::plan(const FrameFormat& format) {
+    noise_ = RawNoiseModel::estimate(format.bit_depth, params_.black_level);
+}
+
+void RawDenoiseStage::run(Frame& frame) {
+    apply_raw_denoise(frame.raw, noise_, params_.strength, frame.scratch);
+}
+
+std::optional<uint64_t> RawDenoiseStage::params_hash() const {
+    return hash_combine(hash_combine(0, uint64_t{params_.black_level}), double{params_.strength});
+}
+
+void StatsStage::run(Frame& frame) {
+    compute_bayer_stats(frame.raw, config_, stats_, frame.scratch);
+    frame.stats = &stats_;
+}
+
+std::optional<uint64_t> StatsStage::params_hash() const {
+    uint64_t h = hash_combine(0, static_cast<uint64_t>(config_.zones_x));
+    h = hash_combine(h, static_cast<uint64_t>(config_.zones_y));
+    h = hash_combine(h, static_cast<uint64_t>(config_.subsample));
+    return hash_combine(h, uint64_t{config_.black_level});
+}
+
+void DemosaicStage::run(Frame& frame) {
+    demosaic(frame.raw, frame.rgb, frame.lut, nullptr, method_);
+}
+
+BinnedDemosaicStage::BinnedDemosaicStage(int factor) : factor_(factor) {
+    if (factor < 2 || (factor & (factor - 1)) != 0) {
+        throw std::invalid_argument("Binning factor must be a power of two >= 2");
+    }
+}
+
+void BinnedDemosaicStage::plan(const FrameFormat& format) {
+    if (format.width < factor_ || format.height < factor_) {
+        throw std::invalid_argument("Frame is smaller than one binning block");
+    }
+}
+
+void BinnedDemosaicStage::run(Frame& frame) {
+    demosaic_binned(frame.raw, frame.rgb, factor_, frame.lut);
+}
+
+void AwbStage::run(Frame& frame) {
+    if (!temporal_ && !frame.stats) {
+        apply_awb(frame.rgb);
+        return;
+    }
+    apply_awb_gains(frame.rgb, frame_gains(frame, nullptr));
+}
+
+AwbGains AwbStage::frame_gains(const Frame& frame, const PointLut* lut) {
+    auto measure = [&] {
+        if (frame.stats) return gray_world_gains(*frame.stats);
+        if (measured_.total.quads > 0) return gray_world_gains(measured_);
+        if (lut) return gray_world_gains(frame.rgb, *lut);
+        ChannelSums sums;
+        add_channel_sums(frame.rgb, sums);
+        return gray_world_gains(sums);
+    };
+    if (!temporal_) return measure();
+
+    const AwbGains measured = measure();
+    measured_.total = ZoneStats{};
+    if (!temporal_->has_gains()) {
+        // First frame: nothing to go on but itself
+        temporal_->update(measured);
+        return temporal_->gains();
+    }
+    const AwbGains gains = temporal_->gains();
+    temporal_->update(measured);
+    return gains;
+}
+
+void AwbStage::compose(PointLut& lut, const Frame& frame) {
+    const AwbGains gains = frame_gains(frame, &lut);
+    const double channel_gains[3] = {gains.r, gains.g, gains.b};
+    const double max_val = lut.max_value();
+    // The same product and clamp as apply_awb_gains
+    for (int c = 0; c < 3; ++c) {
+        uint16_t* t = lut.channel(c);
+        for (std::size_t v = 0; v < lut.size(); ++v) {
+            t[v] = static_cast<uint16_t>(std::min(t[v] * channel_gains[c], max_val));
+        }
+    }
+}
+
+bool AwbStage::compose_reads_rgb(const Frame& frame) const {
+    return !frame.stats && measured_.total.quads == 0;
+}
+
+std::optional<uint64_t> AwbStage::params_hash() const {
+    if (temporal_) return std::nullopt;
+    return 0;
+}
+
+ZoneStats* AwbStage::bayer_sums() {
+    return temporal_ ? &measured_.total : nullptr;
+}
+
+void GammaStage::plan(const FrameFormat& format) {
+    max_code_ = static_cast<uint16_t>((1 << format.bit_depth) - 1);
+    build_lut();
+}
+
+void GammaStage::set_gamma(double gamma) {
+    gamma_ = gamma;
+    if (max_code_ > 0) build_lut();
+}
+
+void GammaStage::build_lut() {
+    lut_.clear();
+    if (gamma_ > 0) {
+        lut_ = build_gamma_lut(max_code_, gamma_);
+    }
+}
+
+void GammaStage::run(Frame& frame) {
+    if (lut_.empty()) return;
+    apply_gamma_lut(frame.rgb.data().data(), frame.rgb.size(), lut_);
+}
+
+void GammaStage::compose(PointLut& lut, const Frame& frame) {
+    (void)frame;
+    if (lut_.empty()) return;
+    for (int c = 0; c < 3; ++c) {
+        uint16_t* t = lut.channel(c);
+        for (std::size_t v = 0; v < lut.size(); ++v) {
+            t[v] = lut_[t[v]];
+        }
+    }
+}
+
+std::optional<uint64_t> GammaStage::params_hash() const {
+    return hash_combine(0, gamma_);
+}
+
+void DenoiseStage::plan(const FrameFormat& format) {
+    (void)format;
+    build_kernel();
+}
+
+void DenoiseStage::set_params(const DenoiseParams& params) {
+    params_ = params;
+    build_kernel();
+}
+
+void DenoiseStage::build_kernel() {
+    kernel_.reset();
+    if (params_.method == DenoiseMethod::Bilateral) {
+        kernel_.emplace(params_.sigma_spatial, params_.sigma_range);
+    }
+}
+
+void DenoiseStage::run(Frame& frame) {
+    if (kernel_) {
+        apply_denoise(frame.rgb, *kernel_, frame.scratch);
+    } else {
+        apply_guided_denoise(frame.rgb, params_.sigma_spatial, params_.sigma_range, params_.subsample, frame.scratch);
+    }
+}
+
+std::optional<uint64_t> DenoiseStage::params_hash() const {
+    uint64_t h = hash_combine(0, static_cast<uint64_t>(params_.method));
+    h = hash_combine(h, double{params_.sigma_spatial});
+    h = hash_combine(h, double{params_.sigma_range});
+    return hash_combine(h, static_cast<uint64_t>(params_.subsample));
+}
+
+SharpenStage::SharpenStage(float strength) : strength_(strength), gain_(sharpen_gain(strength)) {}
+
+void SharpenStage::set_strength(float strength) {
+    gain_ = sharpen_gain(strength);
+    strength_ = strength;
+}
+
+void SharpenStage::plan(const FrameFormat& format) {
+    to_8bit_ = &cached_to_8bit(format.bit_depth);
+}
+
+void SharpenStage::run(Frame& frame) {
+    if (frame.rgb8) {
+        apply_sharpen(frame.rgb, frame.scratch, *to_8bit_, frame.rgb8, strength_);
+    } else {
+        apply_sharpen(frame.rgb, frame.scratch, strength_);
+    }
+}
+
+std::optional<uint64_t> SharpenStage::params_hash() const {
+    return hash_combine(0, static_cast<uint64_t>(gain_));
+}
+
+Pipeline& Pipeline::add(std::unique_ptr<Stage> stage) {
+    if (!stage) {
+        throw std::invalid_argument("Pipeline stage must not be null");
+    }
+    stages_.push_back(std::move(stage));
+    planned_ = false;
+    return *this;
+}
+
+void Pipeline::plan(const FrameFormat& format) {
+    if (format.width <= 0 || format.height <= 0) {
+        throw std::invalid_argument("Image dimensions must be positive");
+    }
+
+    // RAW stages, exactly one demosaic, then RGB stages
+    int demosaic_count = 0;
+    for (const auto& stage : stages_) {
+        switch (stage->domain()) {
+        case Stage::Domain::Raw:
+            if (demosaic_count > 0) {
+                throw std::invalid_argument(std::string("RAW stage after demosaic: ") + stage->name());
+            }
+            break;
+        case Stage::Domain::Demosaic:
+            ++demosaic_count;
+            break;
+        case Stage::Domain::Rgb:
+            if (demosaic_count == 0) {
+                throw std::invalid_argument(std::string("RGB stage before demosaic: ") + stage->name());
+            }
+            break;
+        }
+    }
+    if (demosaic_count != 1) {
+        throw std::invalid_argument("Pipeline needs exactly one demosaic stage");
+    }
+
+    for (auto& stage : stages_) {
+        stage->plan(format);
+    }
+
+    ExecContext& exec = context();
+    ExecScope scope(exec);
+
+    // Each worker first touches the rows of the working frame it will process
+    format_ = format;
+    work_raw_ = Image(format.width, format.height, format.bit_depth, format.pattern);
+    exec.first_touch(work_raw_.data().data(), work_raw_.size() * sizeof(uint16_t));
+    int binning = 1;
+    for (const auto& stage : stages_) {
+        if (stage->domain() == Stage::Domain::Demosaic) binning = stage->binning();
+    }
+    output_width_ = format.width / binning;
+    output_height_ = format.height / binning;
+
+    // Group point operations with each other, and with a stage before them
+    // that can take their table
+    steps_.clear();
+    for (std::size_t i = 0; i < stages_.size();) {
+        Step step{i, i + 1, i + 1, false, stages_[i]->name(), PointLut{}, std::nullopt, false};
+        if (stages_[i]->is_point_op()) {
+            step.points_begin = i;
+        } else if (!stages_[i]->fuses_point_lut()) {
+            steps_.push_back(std::move(step));
+            ++i;
+            continue;
+        }
+        for (std::size_t k = step.points_begin; k < stages_.size() && stages_[k]->is_point_op(); ++k) {
+            if (k > i) step.name += std::string("+") + stages_[k]->name();
+            step.per_frame = step.per_frame || stages_[k]->composes_per_frame();
+            step.end = k + 1;
+        }
+        step.lut.reset(format.bit_depth);
+        i = step.end;
+        steps_.push_back(std::move(step));
+    }
+
+    // Tables that do not depend on the frame are built here, once
+    RgbImage no_rgb;
+    Frame frame{work_raw_, no_rgb, arena_};
+    for (Step& step : steps_) {
+        if (step.points_begin < step.end && !step.per_frame) {
+            compose_points(step, frame);
+        }
+    }
+
+    params_.clear();
+    for (const auto& stage : stages_) {
+        params_.push_back(stage->params_hash());
+    }
+    compute_cache_keys();
+
+    // Interned, so trace spans can keep the names past this pipeline
+    timings_.assign(steps_.size(), StageTiming{nullptr, 0.0});
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+        timings_[i].name = trace::intern(steps_[i].name);
+    }
+    planned_ = true;
+}
+
+void Pipeline::compute_cache_keys() {
+    // The format, then the name and parameters of every stage in order,
+    // until one has no params_hash(). Of consecutive RAW steps only the
+    // last is stored, since each stored RAW frame is as large as the input
+    // and the RAW steps are cheap to rerun.
+    std::optional<uint64_t> key = hash_combine(hash_combine(hash_combine(hash_combine(0,
+        static_cast<uint64_t>(format_.width)), static_cast<uint64_t>(format_.height)),
+        static_cast<uint64_t>(format_.bit_depth)), static_cast<uint64_t>(format_.pattern));
+    for (Step& step : steps_) {
+        for (std::size_t k = step.begin; k < step.end && key; ++k) {
+            if (!params_[k]) {
+                key.reset();
+                break;
+            }
+            key = hash_combine(hash_combine(*key, std::hash<std::string_view>{}(stages_[k]->name())), *params_[k]);
+        }
+        step.cache_key = key;
+    }
+    auto raw_step = [&](std::size_t i) { return stages_[steps_[i].begin]->domain() == Stage::Domain::Raw; };
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+        const bool last = i + 1 == steps_.size();
+        steps_[i].cache_output = steps_[i].cache_key && !last && !(raw_step(i) && raw_step(i + 1));
+    }
+}
+
+void Pipeline::refresh_params(const Frame& frame) {
+    bool changed = false;
+    for (std::size_t k = 0; k < stages_.size(); ++k) {
+        const std::optional<uint64_t> params = stages_[k]->params_hash();
+        if (params == params_[k]) continue;
+        params_[k] = params;
+        changed = true;
+        // A table built once in plan() holds the old parameters
+        for (Step& step : steps_) {
+            if (k >= step.points_begin && k < step.end && !step.per_frame) compose_points(step, frame);
+        }
+    }
+    if (changed) compute_cache_keys();
+}
+
+void Pipeline::set_threads(int threads) {
+    exec_ = threads > 0 ? std::make_unique<ExecContext>(threads) : nullptr;
+}
+
+int Pipeline::threads() const {
+    return context().threads();
+}
+
+void Pipeline::process(const Image& raw, RgbImage& out) {
+    run_stages(raw, out, nullptr);
+}
+
+void Pipeline::process(const Image& raw, RgbImage& out, std::vector<uint8_t>& rgb8) {
+    rgb8.resize(static_cast<std::size_t>(output_width_) * static_cast<std::size_t>(output_height_) * 3);
+    run_stages(raw, out, rgb8.data());
+}
+
+void Pipeline::process_cached(const Image& raw, uint64_t frame_id, RgbImage& out) {
+    if (!cache_) {
+        run_stages(raw, out, nullptr);
+        return;
+    }
+    run_stages(raw, out, nullptr, &frame_id);
+}
+
+std::size_t Pipeline::restore_cached(uint64_t frame_id, Frame& frame) {
+    ISP_TRACE_SCOPE("Cache restore", "copy");
+    for (std::size_t i = steps_.size(); i-- > 0;) {
+        const Step& step = steps_[i];
+        if (!step.cache_output) continue;
+        const CachedStage* hit = cache_->find(hash_combine(frame_id, *step.cache_key));
+        if (!hit) continue;
+        // Same format as the frame buffers, so rows are copied in place on
+        // the pipeline's workers
+        auto copy_rows = [&](const auto* src, auto* dst, std::size_t row_len, int rows) {
+            parallel_for(rows, [&](int begin, int end) {
+                const std::size_t first = static_cast<std::size_t>(begin) * row_len;
+                std::copy(src + first, src + static_cast<std::size_t>(end) * row_len, dst + first);
+            });
+        };
+        if (stages_[step.begin]->domain() == Stage::Domain::Raw) {
+            copy_rows(hit->raw.data().data(), frame.raw.data().data(), static_cast<std::size_t>(hit->raw.width()),
+                      hit->raw.height());
+        } else {
+            copy_rows(hit->rgb.data().data(), frame.rgb.data().data(), static_cast<std::size_t>(hit->rgb.width()),
+                      hit->rgb.height());
+        }
+        if (hit->stats) {
+            cached_stats_ = *hit->stats;
+            frame.stats = &cached_stats_;
+        }
+        return i + 1;
+    }
+    return 0;
+}
+
+void Pipeline::store_cached(uint64_t frame_id, const Step& step, const Frame& frame) {
+    const bool raw_domain = stages_[step.begin]->domain() == Stage::Domain::Raw;
+    const std::size_t bytes = raw_domain ? frame.raw.size() * sizeof(uint16_t) : frame.rgb.size() * sizeof(Pixel);
+    if (bytes > cache_->max_bytes()) return;
+
+    ISP_TRACE_SCOPE("Cache store", "copy");
+    CachedStage entry;
+    if (raw_domain) {
+        entry.raw = frame.raw;
+    } else {
+        entry.rgb = frame.rgb;
+    }
+    if (frame.stats) entry.stats = *frame.stats;
+    cache_->insert(hash_combine(frame_id, *step.cache_key), std::move(entry));
+}
+
+void Pipeline::compose_points(Step& step, const Frame& frame) {
+    step.lut.reset(format_.bit_depth);
+    for (std::size_t k = step.points_begin; k < step.end; ++k) {
+        stages_[k]->compose(step.lut, frame);
+    }
+}
+
+void Pipeline::sum_bayer(const PointLut* lut, const Image& src) {
+    // Summed from each row while it is in cache; trailing odd rows and
+    // columns are left out, as compute_bayer_stats does
+    const int w = src.width();
+    const int quad_rows = src.height() / 2 * 2;
+    const BayerPattern pattern = src.pattern();
+    const uint16_t* in = src.data().data();
+    uint16_t* out = work_raw_.data().data();
+    const ChannelSums sums = parallel_sum(src.height(), ChannelSums{}, [&](int begin, int end) {
+        uint64_t channel[3] = {};
+        for (int y = begin; y < end; ++y) {
+            const std::size_t row = static_cast<std::size_t>(y) * static_cast<std::size_t>(w);
+            if (lut) lut->apply_bayer_row(in + row, out + row, w, y, pattern);
+            if (y >= quad_rows) continue;
+            uint64_t even = 0, odd = 0;
+            for (int x = 0; x + 1 < w; x += 2) {
+                even += out[row + x];
+                odd += out[row + x + 1];
+            }
+            channel[bayer_channel(pattern, 0, y)] += even;
+            channel[bayer_channel(pattern, 1, y)] += odd;
+        }
+        return ChannelSums{channel[0], channel[1], channel[2], 0};
+    });
+
+    const uint32_t quads = static_cast<uint32_t>(static_cast<uint64_t>(w / 2) * static_cast<uint64_t>(quad_rows / 2));
+    for (const auto& stage : stages_) {
+        if (ZoneStats* total = stage->bayer_sums()) {
+            total->r += sums.r;
+            total->g += sums.g;
+            total->b += sums.b;
+            total->quads += quads;
+        }
+    }
+}
+
+void Pipeline::run_stages(const Image& raw, RgbImage& out, uint8_t* rgb8, const uint64_t* frame_id) {
+    if (!planned_) {
+        throw std::logic_error("Pipeline::process called before plan()");
+    }
+    const FrameFormat format{raw.width(), raw.height(), raw.bit_depth(), raw.pattern()};
+    if (!(format == format_)) {
+        throw std::invalid_argument("Frame does not match the planned format");
+    }
+
+    using Clock = std::chrono::steady_clock;
+    ISP_TRACE_SCOPE("Frame", "frame");
+
+    ExecContext& exec = context();
+    ExecScope scope(exec);
+    if (out.width() != output_width_ || out.height() != output_height_ || out.bit_depth() != format_.bit_depth) {
+        out = RgbImage(output_width_, output_height_, format_.bit_depth);
+        exec.first_touch(out.data().data(), out.size() * sizeof(Pixel));
+    }
+
+    Frame frame{work_raw_, out, arena_};
+    refresh_params(frame);
+    const std::size_t first = frame_id ? restore_cached(*frame_id, frame) : 0;
+
+    // A leading run of RAW point operations is applied while copying the
+    // input; otherwise the copy is plain
+    const bool lut_copy = steps_.front().points_begin == 0;
+    if (first == 0 && !lut_copy) {
+        ISP_TRACE_SCOPE("Copy input", "copy");
+        const std::size_t w = static_cast<std::size_t>(raw.width());
+        const uint16_t* src = raw.data().data();
+        uint16_t* dst = work_raw_.data().data();
+        parallel_for(raw.height(), [&](int begin, int end) {
+            std::copy(src + static_cast<std::size_t>(begin) * w, src + static_cast<std::size_t>(end) * w,
+                      dst + static_cast<std::size_t>(begin) * w);
+        });
+    }
+
+    // Bayer sums come from the demosaic input, in the last RAW step
+    std::size_t sum_step = steps_.size();
+    if (std::any_of(stages_.begin(), stages_.end(), [](const auto& stage) { return stage->bayer_sums(); })) {
+        for (std::size_t i = 0; i < steps_.size() && stages_[steps_[i].begin]->domain() == Stage::Domain::Raw; ++i) {
+            sum_step = i;
+        }
+    }
+
+    const Step& last = steps_.back();
+    const bool fused = rgb8 && last.points_begin == last.end && stages_.back()->fuses_8bit_output();
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+        Step& step = steps_[i];
+        if (i < first) {
+            timings_[i].microseconds = 0.0;
+            continue;
+        }
+        if (fused && i + 1 == steps_.size()) frame.rgb8 = rgb8;
+        auto start = Clock::now();
+        ISP_TRACE_SCOPE(timings_[i].name, "stage");
+        if (step.points_begin == step.end) {
+            stages_[step.begin]->run(frame);
+            if (i == sum_step) sum_bayer(nullptr, work_raw_);
+        } else if (step.points_begin > step.begin) {
+            // Folded into the stage's output, unless a table needs that output
+            bool reads_rgb = false;
+            for (std::size_t k = step.points_begin; k < step.end; ++k) {
+                reads_rgb = reads_rgb || stages_[k]->compose_reads_rgb(frame);
+            }
+            if (reads_rgb) {
+                stages_[step.begin]->run(frame);
+                compose_points(step, frame);
+                step.lut.apply(out);
+            } else {
+                if (step.per_frame) compose_points(step, frame);
+                frame.lut = &step.lut;
+                stages_[step.begin]->run(frame);
+                frame.lut = nullptr;
+            }
+        } else {
+            if (step.per_frame) compose_points(step, frame);
+            if (stages_[step.begin]->domain() == Stage::Domain::Rgb) {
+                step.lut.apply(out);
+            } else if (i == sum_step) {
+                sum_bayer(&step.lut, i == 0 ? raw : work_raw_);
+            } else {
+                step.lut.apply_bayer(i == 0 ? raw : work_raw_, work_raw_);
+            }
+        }
+        auto end = Clock::now();
+        timings_[i].microseconds = std::chrono::duration<double, std::micro>(end - start).count();
+        if (frame_id && step.cache_output) store_cached(*frame_id, step, frame);
+    }
+    if (rgb8 && !fused) {
+        ISP_TRACE_SCOPE("To 8-bit", "copy");
+        convert_to_8bit(out, rgb8);
+    }
+
+    // Folds any blocks the first frame added, before the next frame starts
+    arena_.reset();
+}
+
+Pipeline make_default_pipeline(const PipelineConfig& config) {
+    Pipeline pipeline;
+    pipeline.set_threads(config.threads);
+    StatsConfig stats = config.stats;
+    stats.black_level = config.black_level;
+    pipeline.add<BlcStage>(config.black_level);
+    if (config.raw_denoise) {
+        RawDenoiseParams raw_denoise = config.raw_denoise_params;
+        raw_denoise.black_level = config.black_level;
+        pipeline.add<RawDenoiseStage>(raw_denoise);
+    }
+    if (!config.video) {
+        pipeline.add<StatsStage>(stats);
+    }
+    if (config.preview_binning > 1) {
+        pipeline.add<BinnedDemosaicStage>(config.preview_binning);
+    } else {
+        pipeline.add<DemosaicStage>(config.demosaic);
+    }
+    if (config.video) {
+        pipeline.add<AwbStage>(config.temporal_awb);
+    } else {
+        pipeline.add<AwbStage>();
+    }
+    pipeline.add<GammaStage>(config.gamma)
+            .add<DenoiseStage>(config.denoise)
+            .add<SharpenStage>(config.sharpen_strength);
+    return pipeline;
+}
+
+} // namespace isp
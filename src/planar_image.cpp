@@ -0,0 +1,79 @@
+#include "planar_image.hpp"
+#include "exec_context.hpp"
+#include <stdexcept>
+
+namespace isp {
+
+template <typename T>
+PlanarImage<T>::PlanarImage(int width, int height, int bit_depth)
+    : width_(width)
+    , height_(height)
+    , bit_depth_(bit_depth)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Image dimensions must be positive");
+    }
+    stride_ = (static_cast<std::size_t>(width) + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+    data_.resize(3 * plane_size());
+}
+
+template <typename T>
+uint16_t PlanarImage<T>::max_value() const {
+    return static_cast<uint16_t>((1 << bit_depth_) - 1);
+}
+
+template class PlanarImage<uint8_t>;
+template class PlanarImage<uint16_t>;
+
+PlanarRgbImage to_planar(const RgbImage& img) {
+    PlanarRgbImage planar(img.width(), img.height(), img.bit_depth());
+    const int w = img.width();
+
+    parallel_for(img.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const Pixel* src = img.data().data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(w);
+            uint16_t* r = planar.row(0, y);
+            uint16_t* g = planar.row(1, y);
+            uint16_t* b = planar.row(2, y);
+            for (int x = 0; x < w; ++x) {
+                r[x] = src[x].r;
+                g[x] = src[x].g;
+                b[x] = src[x].b;
+            }
+        }
+    });
+    return planar;
+}
+
+namespace {
+
+template <typename T>
+RgbImage interleave(const PlanarImage<T>& planar) {
+    RgbImage img(planar.width(), planar.height(), planar.bit_depth());
+    const int w = planar.width();
+
+    parallel_for(planar.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            Pixel* dst = img.data().data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(w);
+            const T* r = planar.row(0, y);
+            const T* g = planar.row(1, y);
+            const T* b = planar.row(2, y);
+            for (int x = 0; x < w; ++x) {
+                dst[x] = Pixel{r[x], g[x], b[x]};
+            }
+        }
+    });
+    return img;
+}
+
+} // anonymous namespace
+
+RgbImage to_interleaved(const PlanarRgbImage& planar) {
+    return interleave(planar);
+}
+
+RgbImage to_interleaved(const PlanarRgbImage8& planar) {
+    return interleave(planar);
+}
+
+} // namespace isp
@@ -0,0 +1,94 @@
+#include "point_lut.hpp"
+#include "point_lut_simd.hpp"
+#include "simd.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace isp {
+
+void PointLut::reset(int bit_depth) {
+    if (bit_depth < 1 || bit_depth > 16) {
+        throw std::invalid_argument("Bit depth must be between 1 and 16");
+    }
+    bit_depth_ = bit_depth;
+    max_value_ = static_cast<uint16_t>((1u << bit_depth) - 1u);
+    table_.resize(3 * size() + 1);
+    for (int c = 0; c < 3; ++c) {
+        uint16_t* t = channel(c);
+        for (std::size_t v = 0; v < size(); ++v) {
+            t[v] = static_cast<uint16_t>(v);
+        }
+    }
+    table_.back() = 0;
+}
+
+void PointLut::apply(Pixel* data, std::size_t count) const {
+    static_assert(sizeof(Pixel) == 3 * sizeof(uint16_t), "Pixel must be three packed samples");
+    std::size_t done = 0;
+#if defined(ISP_HAVE_AVX2)
+    if (active_simd_level() == SimdLevel::AVX2) {
+        // Whole blocks of 8 pixels keep every vector on the same channel phase
+        done = count / 8 * 8;
+        detail::apply_point_lut_avx2(reinterpret_cast<uint16_t*>(data), 3 * done, table_.data(), size(),
+                                     max_value_);
+    }
+#endif
+    const uint16_t* r = channel(0);
+    const uint16_t* g = channel(1);
+    const uint16_t* b = channel(2);
+    for (std::size_t i = done; i < count; ++i) {
+        Pixel& p = data[i];
+        p.r = r[std::min(p.r, max_value_)];
+        p.g = g[std::min(p.g, max_value_)];
+        p.b = b[std::min(p.b, max_value_)];
+    }
+}
+
+void PointLut::apply(RgbImage& img) const {
+    const std::size_t w = static_cast<std::size_t>(img.width());
+    Pixel* data = img.data().data();
+    parallel_for(img.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            apply(data + static_cast<std::size_t>(y) * w, w);
+        }
+    });
+}
+
+void PointLut::apply_bayer_row(const uint16_t* src, uint16_t* dst, int width, int y, BayerPattern pattern) const {
+    // A Bayer row alternates between two channels
+    const int even_channel = bayer_channel(pattern, 0, y);
+    const int odd_channel = bayer_channel(pattern, 1, y);
+    const uint16_t* even = channel(even_channel);
+    const uint16_t* odd = channel(odd_channel);
+    int x = 0;
+#if defined(ISP_HAVE_AVX2)
+    if (active_simd_level() == SimdLevel::AVX2) {
+        x = width / 8 * 8;
+        detail::apply_point_lut_bayer_avx2(src, dst, static_cast<std::size_t>(x), table_.data(),
+                                           static_cast<std::size_t>(even_channel) * size(),
+                                           static_cast<std::size_t>(odd_channel) * size(), max_value_);
+    }
+#endif
+    for (; x + 1 < width; x += 2) {
+        dst[x] = even[std::min(src[x], max_value_)];
+        dst[x + 1] = odd[std::min(src[x + 1], max_value_)];
+    }
+    if (x < width) {
+        dst[x] = even[std::min(src[x], max_value_)];
+    }
+}
+
+void PointLut::apply_bayer(const Image& src, Image& dst) const {
+    const std::size_t w = static_cast<std::size_t>(src.width());
+    const uint16_t* in = src.data().data();
+    uint16_t* out = dst.data().data();
+    parallel_for(src.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const std::size_t row = static_cast<std::size_t>(y) * w;
+            apply_bayer_row(in + row, out + row, src.width(), y, src.pattern());
+        }
+    });
+}
+
+} // namespace isp
@@ -0,0 +1,67 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "point_lut_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+// Table entries for eight samples; each gather reads 32 bits at entry i
+// and the low half is the entry
+__m256i lookup8(const uint16_t* p, const int* base, __m256i offset, __m256i max) {
+    const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    const __m256i index = _mm256_add_epi32(_mm256_min_epu32(v, max), offset);
+    return _mm256_and_si256(_mm256_i32gather_epi32(base, index, 2), _mm256_set1_epi32(0xFFFF));
+}
+
+// vpackusdw interleaves 128-bit lanes; the permute restores sample order
+__m256i pack16(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+}
+
+} // anonymous namespace
+
+void apply_point_lut_avx2(uint16_t* data, std::size_t count, const uint16_t* table, std::size_t size,
+                          uint16_t max_value) {
+    // Eight samples per gather; 24 samples cover three vectors whose first
+    // lanes fall on channels 0, 2 and 1
+    const int s = static_cast<int>(size);
+    const __m256i offsets[3] = {
+        _mm256_setr_epi32(0, s, 2 * s, 0, s, 2 * s, 0, s),
+        _mm256_setr_epi32(2 * s, 0, s, 2 * s, 0, s, 2 * s, 0),
+        _mm256_setr_epi32(s, 2 * s, 0, s, 2 * s, 0, s, 2 * s),
+    };
+    const __m256i max = _mm256_set1_epi32(max_value);
+    const int* base = reinterpret_cast<const int*>(table);
+
+    for (std::size_t i = 0; i + 24 <= count; i += 24) {
+        uint16_t* p = data + i;
+        const __m256i a = lookup8(p, base, offsets[0], max);
+        const __m256i b = lookup8(p + 8, base, offsets[1], max);
+        const __m256i c = lookup8(p + 16, base, offsets[2], max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), pack16(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16), _mm256_castsi256_si128(pack16(c, c)));
+    }
+}
+
+void apply_point_lut_bayer_avx2(const uint16_t* src, uint16_t* dst, std::size_t count, const uint16_t* table,
+                                std::size_t even, std::size_t odd, uint16_t max_value) {
+    const int e = static_cast<int>(even);
+    const int o = static_cast<int>(odd);
+    const __m256i offset = _mm256_setr_epi32(e, o, e, o, e, o, e, o);
+    const __m256i max = _mm256_set1_epi32(max_value);
+    const int* base = reinterpret_cast<const int*>(table);
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i a = lookup8(src + i, base, offset, max);
+        const __m256i b = lookup8(src + i + 8, base, offset, max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pack16(a, b));
+    }
+    if (i < count) {
+        const __m256i a = lookup8(src + i, base, offset, max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(pack16(a, a)));
+    }
+}
+
+} // namespace isp::detail
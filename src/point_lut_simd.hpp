@@ -0,0 +1,27 @@
+#ifndef ISP_PIPELINE_POINT_LUT_SIMD_HPP
+#define ISP_PIPELINE_POINT_LUT_SIMD_HPP
+
+// Vectorized lookups through a PointLut. Only AVX2 has a gather, so there
+// is no SSE4.1 build.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace isp::detail {
+
+// Map `count` interleaved RGB samples (a multiple of 24, so every vector
+// starts on the same channel phase) in place. `table` holds the three
+// channel tables of `size` entries back to back and one spare entry;
+// samples above max_value read as max_value.
+void apply_point_lut_avx2(uint16_t* data, std::size_t count, const uint16_t* table, std::size_t size,
+                          uint16_t max_value);
+
+// Map `count` samples (a multiple of 8) of one Bayer row from `src` to
+// `dst`, which may be equal. Even samples use the table starting at entry
+// `even` of `table`, odd samples the one at `odd`.
+void apply_point_lut_bayer_avx2(const uint16_t* src, uint16_t* dst, std::size_t count, const uint16_t* table,
+                                std::size_t even, std::size_t odd, uint16_t max_value);
+
+} // namespace isp::detail
+
+#endif
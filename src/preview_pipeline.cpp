@@ -0,0 +1,57 @@
+#include "preview_pipeline.hpp"
+#include "exec_context.hpp"
+#include "region.hpp"
+#include "sample_format.hpp"
+#include "modules/blc.hpp"
+#include "modules/demosaic.hpp"
+#include "modules/awb.hpp"
+#include "modules/gamma.hpp"
+#include "modules/denoise.hpp"
+#include "modules/sharpen.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace isp {
+
+PlanarRgbImage8 run_preview_pipeline(const Image& raw, const PreviewPipelineConfig& config) {
+    const int w = raw.width();
+    const int h = raw.height();
+    const std::size_t stride = static_cast<std::size_t>(w);
+
+    // BLC + requantize, specialized on the sensor depth
+    std::vector<uint8_t> bayer(raw.size());
+    dispatch_sample_format<uint16_t>(raw.bit_depth(), [&](auto format) {
+        using Format = decltype(format);
+        parallel_for(h, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const std::size_t offset = static_cast<std::size_t>(y) * stride;
+                apply_blc_to_8bit<Format>(raw.data().data() + offset, bayer.data() + offset, stride,
+                                          config.black_level);
+            }
+        });
+    });
+
+    PlanarRgbImage8 rgb(w, h, 8);
+    dispatch_bayer_pattern(raw.pattern(), [&](auto pattern) {
+        parallel_for(h, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const uint8_t* rows[3];
+                gather_rows(bayer.data(), stride, 0, y, 1, h, rows);
+                demosaic_row<decltype(pattern)::value>(RowWindow<uint8_t>{rows, 0, w}, y, 0, w, rgb.row(0, y),
+                                                       rgb.row(1, y), rgb.row(2, y));
+            }
+        });
+    });
+
+    apply_awb(rgb);
+    if (config.gamma > 0) {
+        apply_gamma(rgb, config.gamma);
+    }
+    if (config.denoise) {
+        apply_guided_denoise(rgb, config.sigma_spatial, config.sigma_range, config.denoise_subsample);
+    }
+    apply_sharpen(rgb);
+    return rgb;
+}
+
+} // namespace isp
@@ -0,0 +1,163 @@
+#include "raw_unpack.hpp"
+#include "raw_unpack_simd.hpp"
+#include "simd.hpp"
+#include "exec_context.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace isp {
+
+namespace {
+
+void unpack_mipi10_scalar(const uint8_t* src, int begin, int end, uint16_t* dst) {
+    for (int x = begin; x < end; ++x) {
+        const uint8_t* group = src + static_cast<std::size_t>(x / 4) * 5;
+        const int k = x % 4;
+        dst[x] = static_cast<uint16_t>(group[k] << 2 | ((group[4] >> (2 * k)) & 0x3));
+    }
+}
+
+void unpack_mipi12_scalar(const uint8_t* src, int begin, int end, uint16_t* dst) {
+    for (int x = begin; x < end; ++x) {
+        const uint8_t* group = src + static_cast<std::size_t>(x / 2) * 3;
+        dst[x] = x % 2 == 0 ? static_cast<uint16_t>(group[0] << 4 | (group[2] & 0x0F))
+                            : static_cast<uint16_t>(group[1] << 4 | group[2] >> 4);
+    }
+}
+
+// Samples the vector kernels may unpack from a row of `row_bytes` without
+// reading past its end: whole vectors only, and room for the overread
+int vector_samples(int width, std::size_t row_bytes, int lanes, int group_samples, int group_bytes, int overread) {
+    const std::size_t readable = row_bytes > static_cast<std::size_t>(overread)
+        ? row_bytes - static_cast<std::size_t>(overread) : 0;
+    const int groups = static_cast<int>(readable / static_cast<std::size_t>(group_bytes));
+    return std::min(width, groups * group_samples) / lanes * lanes;
+}
+
+} // anonymous namespace
+
+std::size_t raw_row_bytes(int width, RawPacking packing) {
+    const std::size_t w = static_cast<std::size_t>(std::max(width, 0));
+    switch (packing) {
+    case RawPacking::Mipi10: return (w + 3) / 4 * 5;
+    case RawPacking::Mipi12: return (w + 1) / 2 * 3;
+    case RawPacking::Unpacked16: break;
+    }
+    return w * 2;
+}
+
+std::size_t raw_frame_bytes(const RawFileConfig& config) {
+    if (config.width <= 0 || config.height <= 0) return 0;
+    const std::size_t row = raw_row_bytes(config.width, config.packing);
+    const std::size_t stride = config.row_stride != 0 ? config.row_stride : row;
+    return static_cast<std::size_t>(config.height - 1) * stride + row;
+}
+
+void unpack_raw_row(const uint8_t* src, int width, RawPacking packing, bool little_endian, uint16_t* dst) {
+    const std::size_t row_bytes = raw_row_bytes(width, packing);
+    int done = 0;
+
+    switch (packing) {
+    case RawPacking::Unpacked16:
+        if (little_endian == (std::endian::native == std::endian::little)) {
+            std::memcpy(dst, src, row_bytes);
+        } else if (little_endian) {
+            // Byte swaps: plain loops the compiler vectorizes
+            for (int x = 0; x < width; ++x) {
+                dst[x] = static_cast<uint16_t>(src[2 * x + 1] << 8 | src[2 * x]);
+            }
+        } else {
+            for (int x = 0; x < width; ++x) {
+                dst[x] = static_cast<uint16_t>(src[2 * x] << 8 | src[2 * x + 1]);
+            }
+        }
+        return;
+
+    case RawPacking::Mipi10: {
+#if defined(ISP_HAVE_AVX2) || defined(ISP_HAVE_SSE41)
+        const SimdLevel level = active_simd_level();
+#endif
+#if defined(ISP_HAVE_AVX2)
+        if (level == SimdLevel::AVX2) {
+            done = vector_samples(width, row_bytes, 16, 4, 5, detail::kMipi10Overread);
+            detail::unpack_mipi10_avx2(src, done, dst);
+        }
+#endif
+#if defined(ISP_HAVE_SSE41)
+        if (level == SimdLevel::SSE41) {
+            done = vector_samples(width, row_bytes, 8, 4, 5, detail::kMipi10Overread);
+            detail::unpack_mipi10_sse41(src, done, dst);
+        }
+#endif
+        unpack_mipi10_scalar(src, done, width, dst);
+        return;
+    }
+
+    case RawPacking::Mipi12: {
+#if defined(ISP_HAVE_AVX2) || defined(ISP_HAVE_SSE41)
+        const SimdLevel level = active_simd_level();
+#endif
+#if defined(ISP_HAVE_AVX2)
+        if (level == SimdLevel::AVX2) {
+            done = vector_samples(width, row_bytes, 16, 2, 3, detail::kMipi12Overread);
+            detail::unpack_mipi12_avx2(src, done, dst);
+        }
+#endif
+#if defined(ISP_HAVE_SSE41)
+        if (level == SimdLevel::SSE41) {
+            done = vector_samples(width, row_bytes, 8, 2, 3, detail::kMipi12Overread);
+            detail::unpack_mipi12_sse41(src, done, dst);
+        }
+#endif
+        unpack_mipi12_scalar(src, done, width, dst);
+        return;
+    }
+    }
+}
+
+bool unpack_raw(const uint8_t* data, std::size_t size, const RawFileConfig& config, Image& img) {
+    if (config.width <= 0 || config.height <= 0) {
+        throw std::invalid_argument("Image dimensions must be positive");
+    }
+    if (config.packing == RawPacking::Mipi10 && config.bit_depth != 10) {
+        throw std::invalid_argument("MIPI RAW10 needs bit_depth 10");
+    }
+    if (config.packing == RawPacking::Mipi12 && config.bit_depth != 12) {
+        throw std::invalid_argument("MIPI RAW12 needs bit_depth 12");
+    }
+    const std::size_t row_bytes = raw_row_bytes(config.width, config.packing);
+    const std::size_t stride = config.row_stride != 0 ? config.row_stride : row_bytes;
+    if (stride < row_bytes) {
+        throw std::invalid_argument("Row stride is shorter than a row");
+    }
+    if (size < raw_frame_bytes(config)) {
+        return false;
+    }
+
+    if (img.width() != config.width || img.height() != config.height ||
+        img.bit_depth() != config.bit_depth || img.pattern() != config.pattern) {
+        img = Image(config.width, config.height, config.bit_depth, config.pattern);
+    }
+    uint16_t* dst = img.data().data();
+    const std::size_t w = static_cast<std::size_t>(config.width);
+
+    parallel_for(config.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            unpack_raw_row(data + static_cast<std::size_t>(y) * stride, config.width, config.packing,
+                           config.little_endian, dst + static_cast<std::size_t>(y) * w);
+        }
+    });
+    return true;
+}
+
+bool parse_raw_packing(const std::string& name, RawPacking& packing) {
+    if (name == "raw10") packing = RawPacking::Mipi10;
+    else if (name == "raw12") packing = RawPacking::Mipi12;
+    else if (name == "raw16") packing = RawPacking::Unpacked16;
+    else return false;
+    return true;
+}
+
+} // namespace isp
@@ -0,0 +1,48 @@
+// Built with -mavx2; only called when the CPU reports AVX2 support
+#include "raw_unpack_simd.hpp"
+#include <immintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256i;
+    static constexpr int kLanes = 16;
+
+    // vpshufb works per 128-bit lane, so each lane gets its own 8 samples' bytes
+    static V load(const uint8_t* p, int lane_bytes) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + lane_bytes));
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    }
+    static V shuffle_mask(const UnpackShuffle& s) {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(s.bytes)));
+    }
+    static V shuffle(V v, V mask) { return _mm256_shuffle_epi8(v, mask); }
+    static V set1(int x) { return _mm256_set1_epi16(static_cast<short>(x)); }
+    static V set8(int x0, int x1, int x2, int x3, int x4, int x5, int x6, int x7) {
+        const __m128i half = _mm_setr_epi16(static_cast<short>(x0), static_cast<short>(x1), static_cast<short>(x2),
+                                            static_cast<short>(x3), static_cast<short>(x4), static_cast<short>(x5),
+                                            static_cast<short>(x6), static_cast<short>(x7));
+        return _mm256_broadcastsi128_si256(half);
+    }
+    static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+    static V or_(V a, V b) { return _mm256_or_si256(a, b); }
+    template <int N>
+    static V srli(V a) { return _mm256_srli_epi16(a, N); }
+    static V mullo(V a, V b) { return _mm256_mullo_epi16(a, b); }
+    static void store(uint16_t* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+};
+
+} // anonymous namespace
+
+void unpack_mipi10_avx2(const uint8_t* src, int count, uint16_t* dst) {
+    unpack_mipi10<Avx2Ops>(src, count, dst);
+}
+
+void unpack_mipi12_avx2(const uint8_t* src, int count, uint16_t* dst) {
+    unpack_mipi12<Avx2Ops>(src, count, dst);
+}
+
+} // namespace isp::detail
@@ -0,0 +1,77 @@
+#ifndef ISP_PIPELINE_RAW_UNPACK_SIMD_HPP
+#define ISP_PIPELINE_RAW_UNPACK_SIMD_HPP
+
+// Vectorized MIPI RAW10/RAW12 unpacking, shared by the SSE4.1 and AVX2
+// builds. A byte shuffle gathers, for every output sample, its high byte
+// and the group's shared low-bits byte into one 16-bit lane; shifts and
+// masks then assemble the sample. Each translation unit supplies an Ops
+// struct for its instruction set and instantiates the kernels under the
+// matching compiler flags.
+
+#include <cstdint>
+
+namespace isp::detail {
+
+// Unpack `count` samples (a multiple of the lane count). The kernels read
+// up to kMipi10Overread / kMipi12Overread bytes past the last group used.
+constexpr int kMipi10Overread = 6;
+constexpr int kMipi12Overread = 4;
+
+void unpack_mipi10_sse41(const uint8_t* src, int count, uint16_t* dst);
+void unpack_mipi12_sse41(const uint8_t* src, int count, uint16_t* dst);
+void unpack_mipi10_avx2(const uint8_t* src, int count, uint16_t* dst);
+void unpack_mipi12_avx2(const uint8_t* src, int count, uint16_t* dst);
+
+// Shuffle controls for 8 samples from one 128-bit lane:
+// byte 2i = shared low-bits byte, byte 2i+1 = high byte of sample i
+struct alignas(16) UnpackShuffle {
+    uint8_t bytes[16];
+};
+
+// RAW10: samples 4g..4g+3 are bytes 5g..5g+3, low bits in byte 5g+4
+inline constexpr UnpackShuffle kMipi10Shuffle{{4, 0, 4, 1, 4, 2, 4, 3, 9, 5, 9, 6, 9, 7, 9, 8}};
+// RAW12: samples 2g, 2g+1 are bytes 3g, 3g+1, low nibbles in byte 3g+2
+inline constexpr UnpackShuffle kMipi12Shuffle{{2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10}};
+
+// Ops must provide:
+//   V, kLanes, load(p, lane_bytes) -> kLanes/8 128-bit lanes read from
+//   p + k * lane_bytes, shuffle_mask(s) -> `s` in every lane,
+//   shuffle(v, mask), set1(x), set8(x0..x7) (repeated per lane),
+//   and_(a, b), or_(a, b), srli<n>(a), mullo(a, b), store(p, v)
+template <typename Ops>
+void unpack_mipi10(const uint8_t* src, int count, uint16_t* dst) {
+    using V = typename Ops::V;
+    const V shuffle = Ops::shuffle_mask(kMipi10Shuffle);
+    const V high_mask = Ops::set1(0x3FC);
+    const V byte_mask = Ops::set1(0xFF);
+    const V two_bits = Ops::set1(0x3);
+    // Moves low-bit pair k of the shared byte up to bits 6..7
+    const V pair_shift = Ops::set8(64, 16, 4, 1, 64, 16, 4, 1);
+
+    for (int i = 0; i < count; i += Ops::kLanes) {
+        const V w = Ops::shuffle(Ops::load(src, 10), shuffle);
+        const V high = Ops::and_(Ops::template srli<6>(w), high_mask);
+        const V low = Ops::and_(Ops::template srli<6>(Ops::mullo(Ops::and_(w, byte_mask), pair_shift)), two_bits);
+        Ops::store(dst + i, Ops::or_(high, low));
+        src += Ops::kLanes / 4 * 5;
+    }
+}
+
+template <typename Ops>
+void unpack_mipi12(const uint8_t* src, int count, uint16_t* dst) {
+    using V = typename Ops::V;
+    const V shuffle = Ops::shuffle_mask(kMipi12Shuffle);
+    // Even samples: high byte from w >> 4, low nibble from w; odd samples: all of w >> 4
+    const V shifted_mask = Ops::set8(0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF);
+    const V low_mask = Ops::set8(0x000F, 0, 0x000F, 0, 0x000F, 0, 0x000F, 0);
+
+    for (int i = 0; i < count; i += Ops::kLanes) {
+        const V w = Ops::shuffle(Ops::load(src, 12), shuffle);
+        Ops::store(dst + i, Ops::or_(Ops::and_(Ops::template srli<4>(w), shifted_mask), Ops::and_(w, low_mask)));
+        src += Ops::kLanes / 2 * 3;
+    }
+}
+
+} // namespace isp::detail
+
+#endif
@@ -0,0 +1,40 @@
+// Built with -msse4.1; only called when the CPU reports SSE4.1 support
+#include "raw_unpack_simd.hpp"
+#include <smmintrin.h>
+
+namespace isp::detail {
+
+namespace {
+
+struct Sse41Ops {
+    using V = __m128i;
+    static constexpr int kLanes = 8;
+
+    static V load(const uint8_t* p, int) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static V shuffle_mask(const UnpackShuffle& s) { return _mm_load_si128(reinterpret_cast<const __m128i*>(s.bytes)); }
+    static V shuffle(V v, V mask) { return _mm_shuffle_epi8(v, mask); }
+    static V set1(int x) { return _mm_set1_epi16(static_cast<short>(x)); }
+    static V set8(int x0, int x1, int x2, int x3, int x4, int x5, int x6, int x7) {
+        return _mm_setr_epi16(static_cast<short>(x0), static_cast<short>(x1), static_cast<short>(x2),
+                              static_cast<short>(x3), static_cast<short>(x4), static_cast<short>(x5),
+                              static_cast<short>(x6), static_cast<short>(x7));
+    }
+    static V and_(V a, V b) { return _mm_and_si128(a, b); }
+    static V or_(V a, V b) { return _mm_or_si128(a, b); }
+    template <int N>
+    static V srli(V a) { return _mm_srli_epi16(a, N); }
+    static V mullo(V a, V b) { return _mm_mullo_epi16(a, b); }
+    static void store(uint16_t* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+};
+
+} // anonymous namespace
+
+void unpack_mipi10_sse41(const uint8_t* src, int count, uint16_t* dst) {
+    unpack_mipi10<Sse41Ops>(src, count, dst);
+}
+
+void unpack_mipi12_sse41(const uint8_t* src, int count, uint16_t* dst) {
+    unpack_mipi12<Sse41Ops>(src, count, dst);
+}
+
+} // namespace isp::detail
@@ -0,0 +1,48 @@
+#include "simd.hpp"
+#include <atomic>
+
+namespace isp {
+
+namespace {
+
+// ISP_HAVE_<ISA> is defined by the build when that ISA's kernels are compiled in
+SimdLevel probe_cpu() {
+#if defined(ISP_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+#endif
+#if defined(ISP_HAVE_SSE41)
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::atomic<SimdLevel>& current_level() {
+    static std::atomic<SimdLevel> level{detect_simd_level()};
+    return level;
+}
+
+} // anonymous namespace
+
+SimdLevel detect_simd_level() {
+    static const SimdLevel level = probe_cpu();
+    return level;
+}
+
+SimdLevel active_simd_level() {
+    return current_level().load(std::memory_order_relaxed);
+}
+
+void set_simd_level(SimdLevel level) {
+    if (level > detect_simd_level()) level = detect_simd_level();
+    current_level().store(level, std::memory_order_relaxed);
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE41: return "SSE4.1";
+        default:              return "Scalar";
+    }
+}
+
+} // namespace isp
\ No newline at end of file
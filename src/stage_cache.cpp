@@ -0,0 +1,59 @@
+#include "stage_cache.hpp"
+#include <iterator>
+
+namespace isp {
+
+std::size_t CachedStage::bytes() const {
+    std::size_t total = raw.size() * sizeof(uint16_t) + rgb.size() * sizeof(Pixel);
+    if (stats) total += sizeof(BayerStats) + stats->zones.size() * sizeof(ZoneStats);
+    return total;
+}
+
+const CachedStage* StageCache::find(uint64_t key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &entries_.front().second;
+}
+
+void StageCache::insert(uint64_t key, CachedStage entry) {
+    if (auto it = index_.find(key); it != index_.end()) {
+        erase(it->second);
+    }
+    const std::size_t size = entry.bytes();
+    if (size > max_bytes_) return;
+
+    evict_to(max_bytes_ - size);
+    entries_.emplace_front(key, std::move(entry));
+    index_[key] = entries_.begin();
+    bytes_ += size;
+}
+
+void StageCache::clear() {
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void StageCache::set_max_bytes(std::size_t max_bytes) {
+    max_bytes_ = max_bytes;
+    evict_to(max_bytes_);
+}
+
+void StageCache::evict_to(std::size_t max_bytes) {
+    while (bytes_ > max_bytes && !entries_.empty()) {
+        erase(std::prev(entries_.end()));
+    }
+}
+
+void StageCache::erase(Entries::iterator it) {
+    bytes_ -= it->second.bytes();
+    index_.erase(it->first);
+    entries_.erase(it);
+}
+
+} // namespace isp
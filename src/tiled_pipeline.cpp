@@ -0,0 +1,338 @@
+#include "tiled_pipeline.hpp"
+#include "exec_context.hpp"
+#include "region.hpp"
+#include "modules/blc.hpp"
+#include "modules/demosaic.hpp"
+#include "modules/awb.hpp"
+#include "modules/gamma.hpp"
+#include "modules/denoise.hpp"
+#include "modules/sharpen.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+
+namespace isp {
+
+namespace {
+
+constexpr std::size_t kFallbackL2Bytes = 1 << 20;
+
+std::size_t l2_cache_bytes() {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    long bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (bytes > 0) return static_cast<std::size_t>(bytes);
+#endif
+    return kFallbackL2Bytes;
+}
+
+// Largest even tile edge whose haloed working set fits the cache budget:
+// one RAW sample (2 B) and two RGB pixels (6 B each) per haloed pixel
+int choose_tile_size(int halo) {
+    constexpr std::size_t kBytesPerPixel = 2 + 6 + 6;
+    const double edge = std::sqrt(static_cast<double>(l2_cache_bytes() / kBytesPerPixel));
+    const int tile = std::max(32, static_cast<int>(edge) - 2 * halo);
+    return tile & ~1;
+}
+
+// Cut `area` into tiles of at most `tile` x `tile`
+std::vector<Rect> make_tiles(const Rect& area, int tile) {
+    std::vector<Rect> tiles;
+    for (int y = area.y; y < area.bottom(); y += tile) {
+        for (int x = area.x; x < area.right(); x += tile) {
+            tiles.push_back(Rect{x, y, std::min(tile, area.right() - x), std::min(tile, area.bottom() - y)});
+        }
+    }
+    return tiles;
+}
+
+// Copy `r` of the RAW frame into `dst` (row stride r.width), subtracting the black level
+void load_raw_region(const Image& raw, const Rect& r, uint16_t black_level, uint16_t* dst) {
+    const uint16_t* src = raw.data().data();
+    const std::size_t stride = static_cast<std::size_t>(raw.width());
+    const std::size_t row_len = static_cast<std::size_t>(r.width);
+    for (int y = r.y; y < r.bottom(); ++y) {
+        const uint16_t* row = src + static_cast<std::size_t>(y) * stride + static_cast<std::size_t>(r.x);
+        std::copy(row, row + row_len, dst + static_cast<std::size_t>(y - r.y) * row_len);
+    }
+    apply_blc(dst, r.area(), black_level);
+}
+
+// Demosaic rows of `out` from a BLC'd RAW buffer covering `src`, which
+// reaches `radius` rows and columns past `out` where the frame allows
+void demosaic_region(DemosaicRowFn demosaic_fn, int radius, const uint16_t* raw_buf, const Rect& src,
+                     const Rect& out, int frame_width, int frame_height, uint16_t max_value, Pixel* dst) {
+    const std::size_t src_stride = static_cast<std::size_t>(src.width);
+    const std::size_t dst_stride = static_cast<std::size_t>(out.width);
+    const uint16_t* rows[5];
+    for (int y = out.y; y < out.bottom(); ++y) {
+        gather_rows(raw_buf, src_stride, src.y, y, radius, frame_height, rows);
+        demosaic_fn(RowWindow<uint16_t>{rows, src.x, frame_width}, y, out.x, out.right(),
+                    dst + static_cast<std::size_t>(y - out.y) * dst_stride, max_value);
+    }
+}
+
+// Grow `r` by `halo`, then out to whole 2x2 quads, clipped to the frame.
+// Frames are at least one quad wherever this matters, so an odd edge
+// only arises at the frame boundary.
+Rect expand_to_quads(const Rect& r, int halo, int frame_width, int frame_height) {
+    const Rect grown = expand_clamped(r, halo, frame_width, frame_height);
+    const int x0 = grown.x & ~1;
+    const int y0 = grown.y & ~1;
+    const int x1 = std::min(frame_width, (grown.right() + 1) & ~1);
+    const int y1 = std::min(frame_height, (grown.bottom() + 1) & ~1);
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
+
+// Everything fixed for one frame size and config
+struct Chain {
+    DemosaicRowFn demosaic_fn;
+    int demosaic_halo;
+    DenoiseKernel denoise_kernel;
+    int radius;
+    int sharpen_gain;
+    int sharpen_halo;
+    bool do_sharpen;
+    bool do_gamma;
+    int halo;
+
+    Chain(const Image& raw, const TiledPipelineConfig& config)
+        : demosaic_fn(demosaic_row_for(raw.pattern(), config.demosaic)),
+          demosaic_halo(demosaic_radius(config.demosaic)),
+          denoise_kernel(config.sigma_spatial, config.sigma_range),
+          radius(denoise_kernel.radius()),
+          sharpen_gain(isp::sharpen_gain(config.sharpen_strength)),
+          // Sharpen reads 1 pixel, denoise `radius`, demosaic 1 or 2
+          sharpen_halo(raw.width() >= 3 && raw.height() >= 3 ? 1 : 0),
+          do_sharpen(sharpen_halo > 0),
+          do_gamma(config.gamma > 0),
+          halo(sharpen_halo + radius + demosaic_halo) {}
+};
+
+// Gray World channel sums over the whole demosaiced frame, tile by tile.
+// Integer sums are exact, so the gains match apply_awb's double sums.
+ChannelSums measure_frame(const Image& raw, const TiledPipelineConfig& config, const Chain& chain, int tile) {
+    const int w = raw.width();
+    const int h = raw.height();
+    const uint16_t max_val = raw.max_value();
+    const std::vector<Rect> tiles = make_tiles(Rect{0, 0, w, h}, tile);
+    const int num_tiles = static_cast<int>(tiles.size());
+    const std::size_t max_haloed = static_cast<std::size_t>(tile + 2 * chain.demosaic_halo) *
+                                   static_cast<std::size_t>(tile + 2 * chain.demosaic_halo);
+    const auto trace_frame = ISP_TRACE_CURRENT_FRAME;
+
+    // Per-worker tile buffers, sized by the worker on its first tile so
+    // their pages are local to it
+    struct Scratch {
+        std::vector<uint16_t> raw_buf;
+        std::vector<Pixel> row;
+        ChannelSums sums;
+    };
+    ExecContext& context = ExecContext::current();
+    std::vector<Scratch> scratch(static_cast<std::size_t>(context.threads()));
+
+    context.run(num_tiles, 1, [&](int first, int last, int worker) {
+        Scratch& s = scratch[static_cast<std::size_t>(worker)];
+        if (s.raw_buf.empty()) {
+            s.raw_buf.resize(max_haloed);
+            s.row.resize(static_cast<std::size_t>(tile));
+        }
+        for (int t = first; t < last; ++t) {
+            ISP_TRACE_SCOPE_IN_FRAME("Measure tile", "tile", trace_frame);
+            const Rect& out = tiles[static_cast<std::size_t>(t)];
+            const Rect src = expand_clamped(out, chain.demosaic_halo, w, h);
+            load_raw_region(raw, src, config.black_level, s.raw_buf.data());
+
+            for (int y = out.y; y < out.bottom(); ++y) {
+                demosaic_region(chain.demosaic_fn, chain.demosaic_halo, s.raw_buf.data(), src,
+                                Rect{out.x, y, out.width, 1}, w, h, max_val, s.row.data());
+                add_channel_sums(s.row.data(), static_cast<std::size_t>(out.width), s.sums);
+            }
+        }
+    });
+
+    ChannelSums sums;
+    for (const Scratch& part : scratch) sums += part.sums;
+    return sums;
+}
+
+// The whole chain over `area`, one tile at a time, into `dst`, which
+// holds `area` with row stride area.width. With `sums`, also adds up the
+// demosaiced pixels of `area` (not the halos) for the next frame's gains.
+void run_chain(const Image& raw, const TiledPipelineConfig& config, const Chain& chain, const Rect& area, int tile,
+               const AwbGains& gains, Pixel* dst, ChannelSums* sums) {
+    const int w = raw.width();
+    const int h = raw.height();
+    const uint16_t max_val = raw.max_value();
+    const std::vector<Rect> tiles = make_tiles(area, tile);
+    const int num_tiles = static_cast<int>(tiles.size());
+    // Quad alignment adds at most one sample on each side
+    const std::size_t max_haloed = static_cast<std::size_t>(tile + 2 * chain.halo + 2) *
+                                   static_cast<std::size_t>(tile + 2 * chain.halo + 2);
+    const std::vector<uint16_t> gamma_lut =
+        chain.do_gamma ? build_gamma_lut(max_val, config.gamma) : std::vector<uint16_t>{};
+    const int radius = chain.radius;
+    const std::size_t dst_stride = static_cast<std::size_t>(area.width);
+    auto dst_at = [&](int x, int y) {
+        return dst + static_cast<std::size_t>(y - area.y) * dst_stride + static_cast<std::size_t>(x - area.x);
+    };
+    const auto trace_frame = ISP_TRACE_CURRENT_FRAME;
+
+    // Per-worker tile buffers, sized by the worker on its first tile so
+    // their pages are local to it
+    struct Scratch {
+        std::vector<uint16_t> raw_buf;
+        std::vector<Pixel> color_buf;
+        std::vector<Pixel> denoised_buf;
+        std::vector<const Pixel*> rows;
+        ChannelSums sums;
+    };
+    ExecContext& context = ExecContext::current();
+    std::vector<Scratch> scratch(static_cast<std::size_t>(context.threads()));
+
+    // One tile per task: tiles at the frame edge are smaller
+    context.run(num_tiles, 1, [&](int first, int last, int worker) {
+        Scratch& s = scratch[static_cast<std::size_t>(worker)];
+        if (s.raw_buf.empty()) {
+            s.raw_buf.resize(max_haloed);
+            s.color_buf.resize(max_haloed);
+            s.denoised_buf.resize(chain.do_sharpen ? max_haloed : 0);
+            s.rows.resize(static_cast<std::size_t>(std::max(3, 2 * radius + 1)));
+        }
+        for (int t = first; t < last; ++t) {
+            ISP_TRACE_SCOPE_IN_FRAME("Tile", "tile", trace_frame);
+            const Rect& out = tiles[static_cast<std::size_t>(t)];
+            const Rect denoised = expand_clamped(out, chain.sharpen_halo, w, h);
+            const Rect color = expand_clamped(denoised, radius, w, h);
+            const Rect src = expand_to_quads(color, chain.demosaic_halo, w, h);
+
+            // BLC + Demosaic
+            load_raw_region(raw, src, config.black_level, s.raw_buf.data());
+            demosaic_region(chain.demosaic_fn, chain.demosaic_halo, s.raw_buf.data(), src, color, w, h, max_val,
+                            s.color_buf.data());
+            if (sums) {
+                ChannelSums tile_sums;
+                for (int y = out.y; y < out.bottom(); ++y) {
+                    const std::size_t offset = static_cast<std::size_t>(y - color.y) *
+                                               static_cast<std::size_t>(color.width) +
+                                               static_cast<std::size_t>(out.x - color.x);
+                    add_channel_sums(s.color_buf.data() + offset, static_cast<std::size_t>(out.width), tile_sums);
+                }
+                s.sums += tile_sums;
+            }
+
+            // AWB + Gamma (point operations, applied to the haloed tile)
+            apply_awb_gains(s.color_buf.data(), color.area(), gains, max_val);
+            if (chain.do_gamma) {
+                apply_gamma_lut(s.color_buf.data(), color.area(), gamma_lut);
+            }
+
+            // Denoise: into scratch when sharpen follows, else straight to the output
+            for (int y = denoised.y; y < denoised.bottom(); ++y) {
+                gather_rows(static_cast<const Pixel*>(s.color_buf.data()), static_cast<std::size_t>(color.width),
+                            color.y, y, radius, h, s.rows.data());
+                Pixel* row_dst = chain.do_sharpen
+                    ? s.denoised_buf.data() + static_cast<std::size_t>(y - denoised.y) *
+                                              static_cast<std::size_t>(denoised.width)
+                    : dst_at(out.x, y);
+                denoise_row(RowWindow<Pixel>{s.rows.data(), color.x, w}, denoised.x, denoised.right(), row_dst,
+                            chain.denoise_kernel, max_val);
+            }
+
+            // Sharpen
+            if (chain.do_sharpen) {
+                for (int y = out.y; y < out.bottom(); ++y) {
+                    gather_rows(static_cast<const Pixel*>(s.denoised_buf.data()),
+                                static_cast<std::size_t>(denoised.width), denoised.y, y, 1, h, s.rows.data());
+                    sharpen_row(RowWindow<Pixel>{s.rows.data(), denoised.x, w}, out.x, out.right(), dst_at(out.x, y),
+                                max_val, chain.sharpen_gain);
+                }
+            }
+        }
+    });
+
+    if (sums) {
+        ChannelSums area_sums;
+        for (const Scratch& part : scratch) area_sums += part.sums;
+        *sums += area_sums;
+    }
+}
+
+AwbGains gains_from(const ChannelSums& sums) {
+    return compute_awb_gains(static_cast<double>(sums.r), static_cast<double>(sums.g), static_cast<double>(sums.b),
+                             static_cast<double>(sums.count));
+}
+
+int tile_size_for(const TiledPipelineConfig& config, const Chain& chain) {
+    return config.tile_size > 0 ? config.tile_size : choose_tile_size(chain.halo);
+}
+
+// `awb` null: measure this frame in a first pass. Otherwise use its gains
+// when it has any, and fold in this frame's sums from the main pass.
+RgbImage run_tiled(const Image& raw, const TiledPipelineConfig& config, TemporalAwb* awb) {
+    const Chain chain(raw, config);
+    const int tile = tile_size_for(config, chain);
+    RgbImage rgb(raw.width(), raw.height(), raw.bit_depth());
+
+    // A video stream skips the measuring pass once it has gains from
+    // earlier frames, and takes the next frame's from the main pass
+    const bool measure_first = !awb || !awb->has_gains();
+    AwbGains gains;
+    if (measure_first) {
+        gains = gains_from(measure_frame(raw, config, chain, tile));
+        if (awb) awb->update(gains);
+    } else {
+        gains = awb->gains();
+    }
+
+    ChannelSums sums;
+    run_chain(raw, config, chain, Rect{0, 0, raw.width(), raw.height()}, tile, gains, rgb.data().data(),
+              measure_first ? nullptr : &sums);
+    if (!measure_first) {
+        awb->update(gains_from(sums));
+    }
+    return rgb;
+}
+
+RgbImage run_roi(const Image& raw, const Rect& roi, const TiledPipelineConfig& config, const AwbGains* gains) {
+    if (roi.empty() || roi.x < 0 || roi.y < 0 || roi.right() > raw.width() || roi.bottom() > raw.height()) {
+        throw std::invalid_argument("ROI must be a non-empty rectangle inside the frame");
+    }
+    const Chain chain(raw, config);
+    const int tile = tile_size_for(config, chain);
+    const AwbGains frame_gains = gains ? *gains : gains_from(measure_frame(raw, config, chain, tile));
+    RgbImage rgb(roi.width, roi.height, raw.bit_depth());
+    run_chain(raw, config, chain, roi, tile, frame_gains, rgb.data().data(), nullptr);
+    return rgb;
+}
+
+} // anonymous namespace
+
+RgbImage run_tiled_pipeline(const Image& raw, const TiledPipelineConfig& config) {
+    return run_tiled(raw, config, nullptr);
+}
+
+RgbImage run_tiled_pipeline(const Image& raw, const TiledPipelineConfig& config, TemporalAwb& awb) {
+    return run_tiled(raw, config, &awb);
+}
+
+Rect roi_input_region(const Rect& roi, int frame_width, int frame_height, const TiledPipelineConfig& config) {
+    const int demosaic_halo = demosaic_radius(config.demosaic);
+    const int radius = DenoiseKernel(config.sigma_spatial, config.sigma_range).radius();
+    const int sharpen_halo = frame_width >= 3 && frame_height >= 3 ? 1 : 0;
+    return expand_to_quads(roi, sharpen_halo + radius + demosaic_halo, frame_width, frame_height);
+}
+
+RgbImage run_roi_pipeline(const Image& raw, const Rect& roi, const TiledPipelineConfig& config) {
+    return run_roi(raw, roi, config, nullptr);
+}
+
+RgbImage run_roi_pipeline(const Image& raw, const Rect& roi, const TiledPipelineConfig& config,
+                          const AwbGains& gains) {
+    return run_roi(raw, roi, config, &gains);
+}
+
+} // namespace isp
\ No newline at end of file
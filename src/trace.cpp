@@ -0,0 +1,214 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace isp::trace {
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+    std::uint32_t frame;
+};
+
+// Written only by its owner thread. `head` counts every span ever written;
+// span i lives in events[i % kEventsPerThread].
+struct ThreadBuffer {
+    explicit ThreadBuffer(std::uint32_t id) : tid(id), events(kEventsPerThread) {}
+
+    std::uint32_t tid;
+    std::vector<Event> events;
+    std::atomic<std::uint64_t> head{0};
+};
+
+// Buffers outlive their threads so a trace still shows threads that have
+// exited; a new thread takes over a buffer an exited one left behind.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<ThreadBuffer*> free;
+    std::unordered_set<std::string> names;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+std::atomic<bool> g_enabled{false};
+const auto g_origin = std::chrono::steady_clock::now();
+
+thread_local std::uint32_t t_frame = 0;
+
+// Hands the thread's buffer back to the registry when the thread exits
+struct BufferLease {
+    ThreadBuffer* buffer = nullptr;
+
+    ~BufferLease() {
+        if (!buffer) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.free.push_back(buffer);
+    }
+};
+
+thread_local BufferLease t_lease;
+
+ThreadBuffer& thread_buffer() {
+    if (!t_lease.buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.free.empty()) {
+            t_lease.buffer = r.free.back();
+            r.free.pop_back();
+        } else {
+            r.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<std::uint32_t>(r.buffers.size() + 1)));
+            t_lease.buffer = r.buffers.back().get();
+        }
+    }
+    return *t_lease.buffer;
+}
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_origin).count());
+}
+
+// The spans of `buffer` still in its ring, oldest first
+void collect(const ThreadBuffer& buffer, std::vector<Event>& out) {
+    const std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+    const std::uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+    const std::size_t start = out.size();
+    for (std::uint64_t i = first; i < head; ++i) {
+        out.push_back(buffer.events[static_cast<std::size_t>(i % kEventsPerThread)]);
+    }
+    // Drop slots the owner reused, or may be writing, while they were copied
+    const std::uint64_t after = buffer.head.load(std::memory_order_acquire) + 1;
+    if (after > first + kEventsPerThread) {
+        const std::uint64_t overwritten = std::min(after - kEventsPerThread - first, head - first);
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(start),
+                  out.begin() + static_cast<std::ptrdiff_t>(start + overwritten));
+    }
+}
+
+void write_json_string(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') out += '\\';
+        out += *s;
+    }
+    out += '"';
+}
+
+} // anonymous namespace
+
+void set_enabled(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+const char* intern(const std::string& name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.names.insert(name).first->c_str();
+}
+
+std::uint32_t current_frame() {
+    return t_frame;
+}
+
+FrameScope::FrameScope(std::uint32_t frame) : previous_(t_frame) {
+    t_frame = frame;
+}
+
+FrameScope::~FrameScope() {
+    t_frame = previous_;
+}
+
+Span::Span(const char* name, const char* category) : Span(name, category, t_frame) {}
+
+Span::Span(const char* name, const char* category, std::uint32_t frame)
+    : name_(enabled() ? name : nullptr), category_(category), frame_(frame), begin_ns_(name_ ? now_ns() : 0) {}
+
+Span::~Span() {
+    if (!name_) return;
+    const std::uint64_t end_ns = now_ns();
+    ThreadBuffer& buffer = thread_buffer();
+    const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[static_cast<std::size_t>(head % kEventsPerThread)] = Event{name_, category_, begin_ns_, end_ns, frame_};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+std::size_t event_count() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::size_t count = 0;
+    for (const auto& buffer : r.buffers) {
+        count += static_cast<std::size_t>(
+            std::min<std::uint64_t>(buffer->head.load(std::memory_order_acquire), kEventsPerThread));
+    }
+    return count;
+}
+
+void clear() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& buffer : r.buffers) buffer->head.store(0, std::memory_order_release);
+}
+
+bool write_chrome_trace(const std::string& path) {
+    std::string json = "[\n";
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::vector<Event> events;
+        char number[160];
+        for (const auto& buffer : r.buffers) {
+            events.clear();
+            collect(*buffer, events);
+            if (events.empty()) continue;
+
+            std::snprintf(number, sizeof(number),
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}},\n",
+                          buffer->tid, buffer->tid);
+            json += number;
+            for (const Event& e : events) {
+                json += "{\"name\":";
+                write_json_string(json, e.name);
+                json += ",\"cat\":";
+                write_json_string(json, e.category);
+                std::snprintf(number, sizeof(number),
+                              ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%u}},\n",
+                              static_cast<double>(e.begin_ns) / 1000.0,
+                              static_cast<double>(e.end_ns - e.begin_ns) / 1000.0, buffer->tid, e.frame);
+                json += number;
+            }
+        }
+    }
+    // Chrome accepts a trailing comma, but other JSON readers do not
+    if (json.size() > 2) json.erase(json.size() - 2, 1);
+    json += "]\n";
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+        std::cerr << "Failed to create: " << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+} // namespace isp::trace
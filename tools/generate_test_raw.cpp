@@ -1,47 +1,54 @@
+// Write a synthetic Bayer frame as little-endian 16-bit RAW.
+// Usage: generate_test_raw [--width W] [--height H] [--bit-depth B]
+//                          [--scene flat|chart] [--pattern rggb|bggr|grbg|gbrg] [output]
+// The defaults reproduce data/test.raw: 640x480, 12-bit, flat RGGB.
+#include "test_raw.hpp"
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
-#include <cstdint>
-
-int main() {
-    const int width = 640;
-    const int height = 480;
-    const uint16_t R_val = 3000;
-    const uint16_t G_val = 2000;
-    const uint16_t B_val = 1000;
-
-    std::vector<uint16_t> data(width * height);
-
-    // Fill with RGGB pattern
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            bool even_row = (y % 2 == 0);
-            bool even_col = (x % 2 == 0);
 
-            uint16_t val;
-            if (even_row && even_col)       val = R_val;  // R
-            else if (even_row && !even_col) val = G_val;  // G (on R row)
-            else if (!even_row && even_col) val = G_val;  // G (on B row)
-            else                            val = B_val;  // B
-
-            data[static_cast<std::size_t>(y * width + x)] = val;
+int main(int argc, char* argv[]) {
+    int width = 640;
+    int height = 480;
+    int bit_depth = 12;
+    isp::tools::TestScene scene = isp::tools::TestScene::Flat;
+    isp::BayerPattern pattern = isp::BayerPattern::RGGB;
+    std::string path = "data/test.raw";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc) width = std::stoi(argv[++i]);
+        else if (arg == "--height" && i + 1 < argc) height = std::stoi(argv[++i]);
+        else if (arg == "--bit-depth" && i + 1 < argc) bit_depth = std::stoi(argv[++i]);
+        else if (arg == "--scene" && i + 1 < argc && isp::tools::parse_test_scene(argv[i + 1], scene)) ++i;
+        else if (arg == "--pattern" && i + 1 < argc && isp::parse_bayer_pattern(argv[i + 1], pattern)) ++i;
+        else if (!arg.empty() && arg[0] != '-') path = arg;
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--width W] [--height H] [--bit-depth B] [--scene flat|chart]"
+                      << " [--pattern rggb|bggr|grbg|gbrg] [output]\n";
+            return 1;
         }
     }
 
+    const isp::Image raw = isp::tools::make_test_raw(width, height, bit_depth, scene, pattern);
+
     // Write as little-endian 16-bit raw
-    std::ofstream file("data/test.raw", std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to create file\n";
-        return 1;
+    std::vector<char> bytes(raw.size() * 2);
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        const uint16_t pixel = raw.data()[i];
+        bytes[2 * i] = static_cast<char>(pixel & 0xFF);
+        bytes[2 * i + 1] = static_cast<char>((pixel >> 8) & 0xFF);
     }
 
-    for (uint16_t pixel : data) {
-        uint8_t low = pixel & 0xFF;
-        uint8_t high = (pixel >> 8) & 0xFF;
-        file.put(static_cast<char>(low));
-        file.put(static_cast<char>(high));
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+        std::cerr << "Failed to create: " << path << "\n";
+        return 1;
     }
 
-    std::cout << "Generated: data/test.raw (" << width << "x" << height << ", 12-bit)\n";
+    std::cout << "Generated: " << path << " (" << width << "x" << height << ", " << bit_depth << "-bit)\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,313 @@
+// Benchmark suite: every stage of the default pipeline on its own and the
+// whole chain, over synthetic frames at several resolutions and thread
+// counts (ExecContext sizes). Each case gets warm-up runs and then repetitions until
+// --reps or the --max-seconds budget is reached (at least 3), and reports
+// median and p99 wall time, MP/s and GB/s. --json writes the same results
+// for comparing builds.
+//
+// Usage: isp_bench [--resolutions vga,720p,1080p,4k,12mp,50mp|WxH,...]
+//                  [--threads 1,2,...] [--stages blc,stats,...,pipeline]
+//                  [--reps N] [--warmup N] [--max-seconds S]
+//                  [--bit-depth B] [--pattern rggb|bggr|grbg|gbrg] [--json path]
+//
+// GB/s counts the bytes a stage has to read and write once per pixel
+// (e.g. 2 B in and 6 B out for demosaic); scratch traffic is not counted.
+#include "test_raw.hpp"
+#include "exec_context.hpp"
+#include "pipeline.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Resolution {
+    std::string name;
+    int width;
+    int height;
+};
+
+const Resolution kPresets[] = {
+    {"vga", 640, 480},      {"720p", 1280, 720},   {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},     {"12mp", 4000, 3000},  {"50mp", 8160, 6144},
+};
+
+struct Result {
+    std::string stage;
+    Resolution resolution;
+    int threads;
+    std::size_t reps;
+    double median_ms;
+    double p99_ms;
+    double mp_per_s;
+    double gb_per_s;
+};
+
+struct Options {
+    std::vector<Resolution> resolutions;
+    std::vector<int> threads;
+    std::vector<std::string> stages;  // lower case; empty = all
+    int reps = 10;
+    int warmup = 1;
+    double max_seconds = 2.0;
+    int bit_depth = 12;
+    isp::BayerPattern pattern = isp::BayerPattern::RGGB;
+    std::string json_path;
+};
+
+constexpr std::size_t kMinReps = 3;
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parse_resolution(const std::string& text, Resolution& out) {
+    for (const Resolution& preset : kPresets) {
+        if (lower(text) == preset.name) {
+            out = preset;
+            return true;
+        }
+    }
+    int w = 0, h = 0;
+    char x = 0;
+    std::stringstream stream(text);
+    if (stream >> w >> x >> h && (x == 'x' || x == 'X') && w > 0 && h > 0) {
+        out = Resolution{text, w, h};
+        return true;
+    }
+    return false;
+}
+
+// Bytes read plus written once per pixel
+double bytes_per_pixel(const std::string& stage) {
+    if (stage == "BLC") return 2 + 2;
+    if (stage == "Stats") return 2;
+    if (stage == "Demosaic") return 2 + 6;
+    if (stage == "Pipeline") return 2 + 6;
+    return 6 + 6;  // RGB in place
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const std::size_t index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+    return values[index];
+}
+
+bool selected(const Options& options, const std::string& stage) {
+    return options.stages.empty() ||
+           std::find(options.stages.begin(), options.stages.end(), lower(stage)) != options.stages.end();
+}
+
+// Times `body`, calling `prepare` untimed before every run
+template <typename Prepare, typename Body>
+std::vector<double> measure(const Options& options, Prepare&& prepare, Body&& body) {
+    using Clock = std::chrono::steady_clock;
+    for (int i = 0; i < options.warmup; ++i) {
+        prepare();
+        body();
+    }
+    std::vector<double> times;
+    double total = 0.0;
+    while (times.size() < static_cast<std::size_t>(options.reps)) {
+        prepare();
+        const auto start = Clock::now();
+        body();
+        const auto end = Clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        total += times.back() / 1000.0;
+        if (times.size() >= kMinReps && total > options.max_seconds) break;
+    }
+    return times;
+}
+
+Result summarize(const std::string& stage, const Resolution& resolution, int threads,
+                 const std::vector<double>& times) {
+    const double pixels = static_cast<double>(resolution.width) * resolution.height;
+    const double median = percentile(times, 0.5);
+    return Result{stage,
+                  resolution,
+                  threads,
+                  times.size(),
+                  median,
+                  percentile(times, 0.99),
+                  pixels / 1e6 / (median / 1000.0),
+                  pixels * bytes_per_pixel(stage) / 1e9 / (median / 1000.0)};
+}
+
+void print_header() {
+    std::printf("%-10s %-7s %11s %4s %5s %10s %10s %9s %7s\n", "Stage", "Res", "Size", "Thr", "Reps", "Median ms",
+                "p99 ms", "MP/s", "GB/s");
+}
+
+void print_result(const Result& r) {
+    const std::string size = std::to_string(r.resolution.width) + "x" + std::to_string(r.resolution.height);
+    std::printf("%-10s %-7s %11s %4d %5zu %10.2f %10.2f %9.1f %7.2f\n", r.stage.c_str(), r.resolution.name.c_str(),
+                size.c_str(), r.threads, r.reps, r.median_ms, r.p99_ms, r.mp_per_s, r.gb_per_s);
+    std::fflush(stdout);
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+bool write_json(const std::string& path, const Options& options, const std::vector<Result>& results) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to create: " << path << "\n";
+        return false;
+    }
+    file << "{\n";
+    file << "  \"simd\": \"" << isp::simd_level_name(isp::active_simd_level()) << "\",\n";
+    file << "  \"max_threads\": " << isp::ExecContext::default_threads() << ",\n";
+    file << "  \"bit_depth\": " << options.bit_depth << ",\n";
+    file << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        file << "    {\"stage\": \"" << json_escape(r.stage) << "\", \"resolution\": \"" << json_escape(r.resolution.name)
+             << "\", \"width\": " << r.resolution.width << ", \"height\": " << r.resolution.height
+             << ", \"threads\": " << r.threads << ", \"reps\": " << r.reps << ", \"median_ms\": " << r.median_ms
+             << ", \"p99_ms\": " << r.p99_ms << ", \"mp_per_s\": " << r.mp_per_s << ", \"gb_per_s\": " << r.gb_per_s
+             << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+// Each stage of the default pipeline on the previous stage's output, then
+// the whole chain
+void bench_resolution(const Options& options, const Resolution& resolution, std::vector<Result>& results) {
+    const isp::Image input = isp::tools::make_test_raw(resolution.width, resolution.height, options.bit_depth,
+                                                              isp::tools::TestScene::Chart, options.pattern);
+    isp::Pipeline pipeline = isp::make_default_pipeline();
+    pipeline.plan({resolution.width, resolution.height, options.bit_depth, input.pattern()});
+
+    for (int threads : options.threads) {
+        isp::ExecContext context(threads);
+        isp::ExecScope scope(context);
+
+        isp::Image raw = input;
+        isp::RgbImage rgb;
+        isp::FrameArena arena;
+        isp::Frame frame{raw, rgb, arena};
+
+        isp::Image raw_in;
+        isp::RgbImage rgb_in;
+        for (const auto& stage : pipeline.stages()) {
+            if (!selected(options, stage->name())) {
+                // Still needed as input for the stages after it
+                stage->run(frame);
+                arena.reset();
+                continue;
+            }
+            raw_in = raw;
+            rgb_in = rgb;
+            auto prepare = [&] {
+                raw.data() = raw_in.data();
+                if (rgb_in.size() > 0) rgb.data() = rgb_in.data();
+                arena.reset();
+            };
+            const std::vector<double> times = measure(options, prepare, [&] { stage->run(frame); });
+            results.push_back(summarize(stage->name(), resolution, threads, times));
+            print_result(results.back());
+        }
+
+        if (selected(options, "Pipeline")) {
+            isp::RgbImage out;
+            const std::vector<double> times = measure(options, [] {}, [&] { pipeline.process(input, out); });
+            results.push_back(summarize("Pipeline", resolution, threads, times));
+            print_result(results.back());
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--resolutions" && has_value) {
+            for (const std::string& item : split(argv[++i])) {
+                Resolution resolution;
+                if (!parse_resolution(item, resolution)) {
+                    std::cerr << "Unknown resolution: " << item << " (vga, 720p, 1080p, 4k, 12mp, 50mp or WxH)\n";
+                    return 1;
+                }
+                options.resolutions.push_back(resolution);
+            }
+        } else if (arg == "--threads" && has_value) {
+            for (const std::string& item : split(argv[++i])) options.threads.push_back(std::max(1, std::stoi(item)));
+        } else if (arg == "--stages" && has_value) {
+            for (const std::string& item : split(argv[++i])) options.stages.push_back(lower(item));
+        } else if (arg == "--reps" && has_value) {
+            options.reps = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--max-seconds" && has_value) {
+            options.max_seconds = std::stod(argv[++i]);
+        } else if (arg == "--bit-depth" && has_value) {
+            options.bit_depth = std::stoi(argv[++i]);
+        } else if (arg == "--pattern" && has_value && isp::parse_bayer_pattern(argv[i + 1], options.pattern)) {
+            ++i;
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--resolutions vga,720p,1080p,4k,12mp,50mp|WxH,...] [--threads 1,2,...]"
+                      << " [--stages blc,stats,demosaic,awb,gamma,denoise,sharpen,pipeline]"
+                      << " [--reps N] [--warmup N] [--max-seconds S] [--bit-depth B]"
+                      << " [--pattern rggb|bggr|grbg|gbrg] [--json path]\n";
+            return 1;
+        }
+    }
+
+    if (options.resolutions.empty()) {
+        options.resolutions.assign(std::begin(kPresets), std::end(kPresets));
+    }
+    if (options.threads.empty()) {
+        // Powers of two up to the default thread count, and the default itself
+        const int max_threads = isp::ExecContext::default_threads();
+        for (int t = 1; t < max_threads; t *= 2) options.threads.push_back(t);
+        options.threads.push_back(max_threads);
+    }
+
+    std::printf("isp_bench: %s, %d-bit, up to %d threads\n", isp::simd_level_name(isp::active_simd_level()),
+                options.bit_depth, isp::ExecContext::default_threads());
+    print_header();
+
+    std::vector<Result> results;
+    for (const Resolution& resolution : options.resolutions) {
+        bench_resolution(options, resolution, results);
+    }
+
+    if (!options.json_path.empty()) {
+        if (!write_json(options.json_path, options, results)) return 1;
+        std::printf("Wrote %s\n", options.json_path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef ISP_PIPELINE_TOOLS_TEST_RAW_HPP
+#define ISP_PIPELINE_TOOLS_TEST_RAW_HPP
+
+// Synthetic Bayer frames for generate_test_raw and isp_bench
+
+#include "exec_context.hpp"
+#include "image.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+namespace isp::tools {
+
+enum class TestScene {
+    // Constant R, G and B (3000 / 2000 / 1000 at 12 bits), the original data/test.raw
+    Flat,
+    // Brightness ramp, colour patches, fine stripes and sensor noise above a
+    // black level of 64, so no kernel sees flat or trivially predictable input
+    Chart,
+};
+
+inline bool parse_test_scene(const std::string& name, TestScene& scene) {
+    if (name == "flat") scene = TestScene::Flat;
+    else if (name == "chart") scene = TestScene::Chart;
+    else return false;
+    return true;
+}
+
+inline Image make_test_raw(int width, int height, int bit_depth = 12, TestScene scene = TestScene::Chart,
+                           BayerPattern pattern = BayerPattern::RGGB, uint32_t seed = 42) {
+    Image raw(width, height, bit_depth, pattern);
+    const double max_val = raw.max_value();
+    const double scale = max_val / 4095.0;
+
+    if (scene == TestScene::Flat) {
+        const uint16_t values[3] = {static_cast<uint16_t>(3000 * scale), static_cast<uint16_t>(2000 * scale),
+                                    static_cast<uint16_t>(1000 * scale)};
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                raw.data()[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) +
+                           static_cast<std::size_t>(x)] = values[bayer_channel(pattern, x, y)];
+            }
+        }
+        return raw;
+    }
+
+    // Patch colours as R, G, B reflectances
+    static constexpr double kPatches[6][3] = {
+        {0.80, 0.25, 0.20}, {0.30, 0.70, 0.25}, {0.20, 0.30, 0.85},
+        {0.85, 0.80, 0.20}, {0.75, 0.30, 0.75}, {0.55, 0.55, 0.55},
+    };
+    const double black = 64.0 * scale;
+    const double noise = 0.01 * max_val;
+
+    parallel_for(height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            // Per-row xorshift so rows can be filled in parallel and reproducibly
+            uint32_t state = seed ^ (static_cast<uint32_t>(y) * 0x9E3779B9u) ^ 0xA511E9B3u;
+            auto uniform = [&state] {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return static_cast<double>(state) / 4294967296.0;
+            };
+            const double v = static_cast<double>(y) / height;
+
+            for (int x = 0; x < width; ++x) {
+                const double u = static_cast<double>(x) / width;
+                const int c = bayer_channel(pattern, x, y);
+
+                // Warm-tinted ramp, with patches in the middle band and stripes
+                // of rising frequency along the bottom
+                double level = (0.1 + 0.8 * u) * (c == 0 ? 1.0 : c == 1 ? 0.8 : 0.6);
+                if (v > 0.3 && v < 0.7) {
+                    const int patch = std::min(5, static_cast<int>(u * 6.0));
+                    level *= kPatches[patch][c] * 1.2;
+                } else if (v >= 0.8) {
+                    const int period = 2 + static_cast<int>(u * 30.0);
+                    level = ((x / period) % 2 == 0) ? 0.15 : 0.75;
+                }
+
+                // Triangular noise, roughly Gaussian with sigma ~ 0.4 * `noise`
+                const double sample = black + level * (max_val - black) + (uniform() + uniform() - 1.0) * noise;
+                raw.data()[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)] =
+                    static_cast<uint16_t>(std::clamp(sample, 0.0, max_val));
+            }
+        }
+    });
+    return raw;
+}
+
+} // namespace isp::tools
+
+#endif